@@ -0,0 +1,72 @@
+/*
+ * Config file benchmark: a large xpad_devices.txt read and added to the
+ * device table, and a large xpad_remap.txt read and compiled into its
+ * profiles, the work done at every plugin load.
+ */
+#include "harness.h"
+
+#define BENCH_LINES 250 // fits the device table with the built in entries
+#define BENCH_RUNS 2000
+#define BENCH_REMAP_LINES 10000 // every profile over and over, no limit on lines
+#define BENCH_REMAP_RUNS 100
+
+static void report(const char *name, uint32_t lines, uint32_t runs, size_t bytes, uint64_t t, uint64_t allocs) {
+  printf("%-16s %10.0f lines/s %8.1f ns/line %6.3f allocs/load %8.1f KB/s\n", name,
+         (double)lines * runs * 1e9 / t, (double)t / lines / runs, (double)allocs / runs, bytes * (double)runs * 1e6 / t);
+}
+
+int main(void) {
+  static char text[BENCH_REMAP_LINES * 32];
+  static const char *buttons[] = {"CROSS", "CIRCLE", "SQUARE", "TRIANGLE", "L1", "R1", "L2", "R2", "START", "SELECT", "NONE"};
+  static const char *axes[] = {"LX", "LY", "RX", "RY"};
+  char *p = text;
+  uint64_t t0, t1, m0;
+  uint32_t i;
+
+  for (i = 0; i < BENCH_LINES; i++) {
+    p += sprintf(p, "0x%04x, 0x%04x, Bench pad %u, XTYPE_XBOX360%s\r\n", 0x2000 + i % 7, i, i, (i & 3) ? "" : ", REPORT_MODE_QUEUE");
+  }
+  host_setup(NULL);
+  host_fs_put(DEVICES_FILE, text);
+  m0 = host_mallocs;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_RUNS; i++) {
+    device_load();
+  }
+  t1 = host_now_ns();
+  if (config_errors > 0) {
+    fprintf(stderr, "%s\n", config_msg);
+    return(1);
+  }
+  report("xpad_devices.txt", BENCH_LINES, BENCH_RUNS, p - text, t1 - t0, host_mallocs - m0);
+
+  // a profile every 100 lines with comments, button and stick lines
+  p = text;
+  for (i = 0; i < BENCH_REMAP_LINES; i++) {
+    if (i % 100 == 0) {
+      p += sprintf(p, "remap_setting = %u\n", (i / 100) % MAX_REMAP + 1);
+    } else if (i % 10 == 0) {
+      p += sprintf(p, "# profile %u\r\n", i / 100);
+    } else if (i % 10 == 1) {
+      p += sprintf(p, "%s = %s%s\n", axes[(i / 10) % 4], (i & 32) ? "-" : "", axes[(i / 100) % 4]);
+    } else {
+      p += sprintf(p, "%s = %s # %u\n", buttons[i % 10], buttons[(i * 7) % 11], i);
+    }
+  }
+  host_fs_put(REMAP_FILE, text);
+  config_errors = 0;
+  m0 = host_mallocs;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_REMAP_RUNS; i++) {
+    remap_load();
+    remap_free();
+  }
+  t1 = host_now_ns();
+  if (config_errors > 0) {
+    fprintf(stderr, "%s\n", config_msg);
+    return(1);
+  }
+  report("xpad_remap.txt", BENCH_REMAP_LINES, BENCH_REMAP_RUNS, p - text, t1 - t0, host_mallocs - m0);
+  host_rmroot();
+  return(0);
+}
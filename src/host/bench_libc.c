@@ -0,0 +1,66 @@
+/*
+ * libc.c against the system's memcpy, memset and memcmp at the sizes the
+ * plugin moves: reports, pad data, unit memory and file chunks.
+ */
+#include <dlfcn.h>
+#include "harness.h"
+
+#define BENCH_BYTES (256 << 20) // per size and function
+
+typedef void *(*MEMCPY_t)(void *, const void *, size_t);
+typedef void *(*MEMSET_t)(void *, int, size_t);
+typedef int (*MEMCMP_t)(const void *, const void *, size_t);
+
+static MEMCPY_t volatile cpy[2];
+static MEMSET_t volatile set[2];
+static MEMCMP_t volatile cmp[2];
+static volatile int32_t sink;
+
+static double run(int32_t f, int32_t which, uint8_t *a, uint8_t *b, size_t n) {
+  uint64_t t0, t1;
+  size_t i, loops = BENCH_BYTES / n;
+
+  t0 = host_now_ns();
+  for (i = 0; i < loops; i++) {
+    if (f == 0) {
+      cpy[which](a, b, n);
+    } else if (f == 1) {
+      set[which](a, (int)i, n);
+    } else {
+      sink += cmp[which](a, b, n);
+    }
+  }
+  t1 = host_now_ns();
+  return((double)(t1 - t0) / loops);
+}
+
+int main(void) {
+  static const size_t sizes[] = {8, 32, 64, 148, 512, 4096};
+  static const char *names[] = {"memcpy", "memset", "memcmp"};
+  static uint8_t a[4096 + 16], b[4096 + 16];
+  double ours, sys;
+  uint32_t f, i;
+
+  cpy[0] = memcpy;
+  set[0] = memset;
+  cmp[0] = memcmp;
+  cpy[1] = (MEMCPY_t)dlsym(RTLD_NEXT, "memcpy");
+  set[1] = (MEMSET_t)dlsym(RTLD_NEXT, "memset");
+  cmp[1] = (MEMCMP_t)dlsym(RTLD_NEXT, "memcmp");
+  if (cpy[1] == NULL || set[1] == NULL || cmp[1] == NULL) {
+    fprintf(stderr, "system libc not found\n");
+    return(1);
+  }
+  memset(b, 0x5A, sizeof(b));
+
+  // compares run over equal buffers, their worst case
+  for (f = 0; f < 3; f++) {
+    memcpy(a, b, sizeof(a));
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      ours = run(f, 0, a, b, sizes[i]);
+      sys = run(f, 1, a, b, sizes[i]);
+      printf("%-8s %5u bytes %8.1f ns libc.c %8.1f ns system %6.2fx\n", names[f], (uint32_t)sizes[i], ours, sys, ours / sys);
+    }
+  }
+  return(0);
+}
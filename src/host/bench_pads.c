@@ -0,0 +1,86 @@
+/*
+ * Input loop benchmark at 1 and 7 pads: each round every pad sends a report
+ * and the live slots are walked and read the way the input thread does,
+ * so per pad cost and the cost of the walk itself show up together. The
+ * walk over every slot number the loop used before is timed as a baseline.
+ */
+#include "harness.h"
+
+#define BENCH_ROUNDS 200000
+
+// the live slots, lowest first, or -1 once done, as a bitmask walk or the way the
+// loop did before by testing every slot number against the connected mask
+static inline int32_t walk_next(uint32_t *live, int32_t *i, int32_t every) {
+  if (!every) {
+    return((*live != 0) ? slot_next(live) : -1);
+  }
+  for (; *i < MAX_XPAD_NUM; (*i)++) {
+    if (*live & (1 << *i)) {
+      return((*i)++);
+    }
+  }
+  return(-1);
+}
+
+static void bench(int32_t pads, int32_t every) {
+  static uint8_t r[64][HOST_REPORT_LEN];
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  int32_t dev_id[MAX_XPAD_NUM], i, j, k;
+  uint32_t live, x;
+  uint64_t t0, t1, walk;
+
+  for (i = 0; i < 64; i++) {
+    x = i * 2654435761U;
+    host_report(r[i], (uint16_t)x, x >> 8, x >> 16, (int16_t)(x >> 3), (int16_t)(x >> 7), (int16_t)(x >> 11), (int16_t)(x >> 13));
+  }
+  for (i = 0; i < pads; i++) {
+    dev_id[i] = host_plug_xbox360(1);
+    host_register(host_number(dev_id[i]));
+  }
+
+  t0 = host_now_ns();
+  for (k = 0; k < BENCH_ROUNDS; k++) {
+    for (i = 0; i < pads; i++) {
+      host_usb_in(dev_id[i], 0x81, r[(k + i) & 63], HOST_REPORT_LEN);
+      host_usb_pump_one();
+    }
+    live = XPAD.connected;
+    j = 0;
+    while ((i = walk_next(&live, &j, every)) >= 0) {
+      while (XPAD.con_unit[i]->read_input(i, data) > 0);
+    }
+  }
+  t1 = host_now_ns();
+
+  // the walk alone, nothing queued
+  walk = host_now_ns();
+  for (k = 0; k < BENCH_ROUNDS; k++) {
+    live = XPAD.connected;
+    j = 0;
+    while ((i = walk_next(&live, &j, every)) >= 0) {
+      XPAD.con_unit[i]->read_input(i, data);
+    }
+  }
+  walk = host_now_ns() - walk;
+  printf("%d pad%s %-10s %10.1f ns/round %8.1f ns/report %8.1f ns/idle round\n", pads, (pads > 1) ? "s" : " ", every ? "every slot" : "live",
+         (double)(t1 - t0) / BENCH_ROUNDS, (double)(t1 - t0) / BENCH_ROUNDS / pads, (double)walk / BENCH_ROUNDS);
+
+  for (i = 0; i < pads; i++) {
+    host_usb_unplug(dev_id[i]);
+  }
+  host_usb_pump();
+}
+
+int main(void) {
+  host_setup("insert_keepalive = 0\n");
+  if (init_usb() != CELL_OK) {
+    fprintf(stderr, "init_usb failed\n");
+    return(1);
+  }
+  bench(1, 1);
+  bench(1, 0);
+  bench(MAX_XPAD_NUM, 1);
+  bench(MAX_XPAD_NUM, 0);
+  host_teardown();
+  return(host_finish("bench_pads"));
+}
@@ -0,0 +1,91 @@
+/*
+ * Title profile benchmark: a 10000 line xpad_titles.txt read and sorted,
+ * lookups of titles in the file and of titles missing from it, and the
+ * profile applied at a game boot.
+ */
+#include "harness.h"
+
+#define BENCH_TITLES 10000
+#define BENCH_LOADS 50
+#define BENCH_FINDS 1000000
+#define BENCH_APPLIES 20000
+
+static const char *prefix[4] = {"BLUS", "BLES", "NPUB", "BCUS"};
+
+// title i of the file, written out of order so the load has to sort
+static void title_id(char *id, uint32_t i, const char *pre) {
+  sprintf(id, "%s%05u", (pre != NULL) ? pre : prefix[i % 4], (i * 7919) % BENCH_TITLES);
+}
+
+int main(void) {
+  static char text[BENCH_TITLES * 64];
+  static uint64_t keys[BENCH_TITLES];
+  char *p = text, id[16];
+  uint64_t t0, t1, m0;
+  uint32_t i, found;
+
+  for (i = 0; i < BENCH_TITLES; i++) {
+    title_id(id, i, NULL);
+    p += sprintf(p, "%s, stick_deadzone = %u, remap = %u # %u\n", id, i % 50, i % (MAX_REMAP + 1), i);
+  }
+  host_setup(NULL);
+  host_fs_put(TITLES_FILE, text);
+  config_errors = 0;
+  m0 = host_mallocs;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_LOADS; i++) {
+    title_free();
+    title_load();
+  }
+  t1 = host_now_ns();
+  if (config_errors > 0 || title_count != BENCH_TITLES) {
+    fprintf(stderr, "%u titles: %s\n", title_count, config_msg);
+    return(1);
+  }
+  printf("%-16s %10.0f titles/s %8.1f ns/title %6.3f allocs/load %8.1f ms/load\n", "title_load",
+         (double)BENCH_TITLES * BENCH_LOADS * 1e9 / (t1 - t0), (double)(t1 - t0) / BENCH_TITLES / BENCH_LOADS,
+         (double)(host_mallocs - m0) / BENCH_LOADS, (double)(t1 - t0) / BENCH_LOADS / 1e6);
+
+  // every title in the file, then each number with another title's prefix
+  for (i = 0; i < BENCH_TITLES; i++) {
+    title_id(id, i, NULL);
+    keys[i] = title_key(id);
+  }
+  found = 0;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_FINDS; i++) {
+    found += (title_find(keys[(i * 31) % BENCH_TITLES]) != NULL);
+  }
+  t1 = host_now_ns();
+  if (found != BENCH_FINDS) {
+    fprintf(stderr, "%u of %u titles found\n", found, BENCH_FINDS);
+    return(1);
+  }
+  printf("%-16s %10.0f finds/s %9.1f ns/find\n", "title_find hit", BENCH_FINDS * 1e9 / (t1 - t0), (double)(t1 - t0) / BENCH_FINDS);
+  for (i = 0; i < BENCH_TITLES; i++) {
+    title_id(id, i, prefix[(i + 1) % 4]);
+    keys[i] = title_key(id);
+  }
+  found = 0;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_FINDS; i++) {
+    found += (title_find(keys[(i * 31) % BENCH_TITLES]) != NULL);
+  }
+  t1 = host_now_ns();
+  if (found != 0) {
+    fprintf(stderr, "%u missing titles found\n", found);
+    return(1);
+  }
+  printf("%-16s %10.0f finds/s %9.1f ns/find\n", "title_find miss", BENCH_FINDS * 1e9 / (t1 - t0), (double)(t1 - t0) / BENCH_FINDS);
+
+  // a game boot and exit, the tables are rebuilt each time
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_APPLIES; i++) {
+    title_apply((i & 1) ? NULL : &titles[i % title_count]);
+  }
+  t1 = host_now_ns();
+  printf("%-16s %10.0f applies/s %7.1f ns/apply\n", "title_apply", BENCH_APPLIES * 1e9 / (t1 - t0), (double)(t1 - t0) / BENCH_APPLIES);
+  title_free();
+  host_rmroot();
+  return(0);
+}
@@ -0,0 +1,283 @@
+/*
+ * Report translation benchmark: each report goes through the usb completion,
+ * the unit's report queue or slot, translation and the pad insert, the path
+ * every hot path change in the plugin is measured against. The decoders
+ * alone are timed too, so a HID plan can be held against the Xbox one and
+ * the Xbox one against the per XTYPE translation it replaced.
+ */
+#include "harness.h"
+#include "hid_corpus.h"
+
+#define BENCH_REPORTS 1000000
+
+typedef void (*BENCH_FILL_t)(uint8_t *r, uint32_t i);
+typedef void (*BENCH_DECODE_t)(int32_t n, HID_PLAN_t *plan, uint8_t *r);
+
+// xpad_read_report before the translation tables, kept as the baseline,
+// buttons read as the big endian word the console sees
+static void old_read_report(int32_t id, uint8_t *readBuf) {
+  uint16_t *digit0, *digit1, *digit2,
+           *analog_rx, *analog_ry, *analog_lx, *analog_ly,
+           *press_l2, *press_r2, *press_l1, *press_r1,
+           *press_up, *press_down, *press_left, *press_right,
+           *press_cross, *press_square, *press_circle, *press_triangle;
+  XBOX360_IN_REPORT *report;
+  CellPadData data;
+  uint16_t buttons;
+
+  report = (XBOX360_IN_REPORT *)readBuf;
+  buttons = (readBuf[2] << 8) | readBuf[3];
+  memset(&data, 0, sizeof(CellPadData));
+  data.len = 24;
+
+  // map location of each button in virtual pad's data
+  digit0 = &data.button[0];
+  digit1 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL1];
+  digit2 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL2];
+  analog_rx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X];
+  analog_ry = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y];
+  analog_lx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X];
+  analog_ly = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y];
+  press_l2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L2];
+  press_r2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R2];
+  press_l1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L1];
+  press_r1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R1];
+  press_right = &data.button[CELL_PAD_BTN_OFFSET_PRESS_RIGHT];
+  press_left = &data.button[CELL_PAD_BTN_OFFSET_PRESS_LEFT];
+  press_up = &data.button[CELL_PAD_BTN_OFFSET_PRESS_UP];
+  press_down = &data.button[CELL_PAD_BTN_OFFSET_PRESS_DOWN];
+  press_cross = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CROSS];
+  press_square = &data.button[CELL_PAD_BTN_OFFSET_PRESS_SQUARE];
+  press_circle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CIRCLE];
+  press_triangle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_TRIANGLE];
+
+  // set default controller values
+  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X] = 0x0080;
+  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y] = 0x0080;
+  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] = 0x0080;
+  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] = 0x0080;
+  data.button[CELL_PAD_BTN_OFFSET_SENSOR_X] = 0x0200;
+  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Y] = 0x0200;
+  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Z] = 0x0200;
+  data.button[CELL_PAD_BTN_OFFSET_SENSOR_G] = 0x0200;
+
+  // read values from Xbox controller and map it to the virtual pad
+  *digit0 = (buttons & btnXbox) ? *digit0 | CELL_PAD_CTRL_LDD_PS : *digit0 & ~CELL_PAD_CTRL_LDD_PS;
+  *digit1 = (buttons & btnDigiLeft) ? *digit1 | CELL_PAD_CTRL_LEFT : *digit1 & ~CELL_PAD_CTRL_LEFT;
+  *digit1 = (buttons & btnDigiDown) ? *digit1 | CELL_PAD_CTRL_DOWN : *digit1 & ~CELL_PAD_CTRL_DOWN;
+  *digit1 = (buttons & btnDigiRight) ? *digit1 | CELL_PAD_CTRL_RIGHT : *digit1 & ~CELL_PAD_CTRL_RIGHT;
+  *digit1 = (buttons & btnDigiUp) ? *digit1 | CELL_PAD_CTRL_UP : *digit1 & ~CELL_PAD_CTRL_UP;
+  *digit1 = (buttons & btnStart) ? *digit1 | CELL_PAD_CTRL_START : *digit1 & ~CELL_PAD_CTRL_START;
+  *digit1 = (buttons & btnHatRight) ? *digit1 | CELL_PAD_CTRL_R3 : *digit1 & ~CELL_PAD_CTRL_R3;
+  *digit1 = (buttons & btnHatLeft) ? *digit1 | CELL_PAD_CTRL_L3 : *digit1 & ~CELL_PAD_CTRL_L3;
+  *digit1 = (buttons & btnBack) ? *digit1 | CELL_PAD_CTRL_SELECT : *digit1 & ~CELL_PAD_CTRL_SELECT;
+  *digit2 = (buttons & btnX) ? *digit2 | CELL_PAD_CTRL_SQUARE : *digit2 & ~CELL_PAD_CTRL_SQUARE;
+  *digit2 = (buttons & btnA) ? *digit2 | CELL_PAD_CTRL_CROSS : *digit2 & ~CELL_PAD_CTRL_CROSS;
+  *digit2 = (buttons & btnB) ? *digit2 | CELL_PAD_CTRL_CIRCLE : *digit2 & ~CELL_PAD_CTRL_CIRCLE;
+  *digit2 = (buttons & btnY) ? *digit2 | CELL_PAD_CTRL_TRIANGLE : *digit2 & ~CELL_PAD_CTRL_TRIANGLE;
+  *digit2 = (buttons & btnShoulderRight) ? *digit2 | CELL_PAD_CTRL_R1 : *digit2 & ~CELL_PAD_CTRL_R1;
+  *digit2 = (buttons & btnShoulderLeft) ? *digit2 | CELL_PAD_CTRL_L1 : *digit2 & ~CELL_PAD_CTRL_L1;
+  *digit2 = (report->trigL > 0) ? *digit2 | CELL_PAD_CTRL_L2 : *digit2 & ~CELL_PAD_CTRL_L2;
+  *digit2 = (report->trigR > 0) ? *digit2 | CELL_PAD_CTRL_R2 : *digit2 & ~CELL_PAD_CTRL_R2;
+
+  // emulate pressure values except for L2 and R2, button presses correspond to max sensitivity value
+  *press_l2 = (report->trigL);
+  *press_r2 = (report->trigR);
+  *press_l1 = (buttons & btnShoulderLeft) ? 0xFF : 0;
+  *press_r1 = (buttons & btnShoulderRight) ? 0xFF : 0;
+  *press_up = (buttons & btnDigiUp) ? 0xFF : 0;
+  *press_down = (buttons & btnDigiDown) ? 0xFF : 0;
+  *press_left = (buttons & btnDigiLeft) ? 0xFF : 0;
+  *press_right = (buttons & btnDigiRight) ? 0xFF : 0;
+  *press_square = (buttons & btnX) ? 0xFF : 0;
+  *press_circle = (buttons & btnB) ? 0xFF : 0;
+  *press_cross = (buttons & btnA) ? 0xFF : 0;
+  *press_triangle = (buttons & btnY) ? 0xFF : 0;
+
+  // PS3 pads use 8 bit values for each axis while Xbox pads use 16 bit
+  // convert Xbox analog values for PS3 compatibility
+  *analog_rx = (readBuf[11] - 0x80) & 0x00FF;
+  *analog_ry = ((readBuf[13] ^ 0xFF) - 0x80) & 0x00FF;
+  *analog_lx = (readBuf[7] - 0x80) & 0x00FF;
+  *analog_ly = ((readBuf[9] ^ 0xFF) - 0x80) & 0x00FF;
+
+  // send pad data to virtual pad
+  cellPadLddDataInsert(handle[id], &data);
+}
+
+static void decode_old(int32_t n, HID_PLAN_t *plan, uint8_t *r) {
+  (void)plan;
+  old_read_report(n, r);
+}
+
+static void decode_xbox(int32_t n, HID_PLAN_t *plan, uint8_t *r) {
+  (void)plan;
+  xbox_read_report(n, (XBOX360_IN_REPORT *)r);
+}
+
+static void decode_hid(int32_t n, HID_PLAN_t *plan, uint8_t *r) {
+  hid_read_report(n, plan, r + (plan->report_id != 0));
+}
+
+static void fill_wired(uint8_t *r, uint32_t i) {
+  uint32_t x = i * 2654435761U;
+
+  host_report(r, (uint16_t)x, x >> 8, x >> 16, (int16_t)(x >> 3), (int16_t)(x >> 7), (int16_t)(x >> 11), (int16_t)(x >> 13));
+}
+
+static void fill_idle(uint8_t *r, uint32_t i) {
+  (void)i;
+  host_report(r, 0, 0, 0, 0, 0, 0, 0);
+}
+
+static void fill_wireless(uint8_t *r, uint32_t i) {
+  uint32_t x = i * 2654435761U;
+
+  host_report_w(r, (uint16_t)x, x >> 8, x >> 16, (int16_t)(x >> 3), (int16_t)(x >> 7), (int16_t)(x >> 11), (int16_t)(x >> 13));
+}
+
+static const HID_CORPUS_t *bench_hid; /* Pad the HID reports are made for */
+
+static void fill_hid(uint8_t *r, uint32_t i) {
+  uint32_t x = i * 2654435761U, j;
+
+  r[0] = bench_hid->report_id;
+  for (j = (bench_hid->report_id != 0); j < 64; j++) {
+    r[j] = x >> (j & 15);
+  }
+}
+
+static void bench(const char *name, int32_t dev_id, int32_t n, int32_t len, BENCH_FILL_t fill) {
+  static uint8_t r[64 * 64];
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint64_t t0, t1, m0, inserts;
+  uint32_t i;
+  XPAD_UNIT_t *unit = XPAD.con_unit[n];
+
+  // reports are made up front so only the plugin's work is timed
+  for (i = 0; i < 64; i++) {
+    fill(r + i * 64, i);
+  }
+  m0 = host_mallocs;
+  inserts = host_pad[handle[n]].inserts;
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_REPORTS; i++) {
+    host_usb_in(dev_id, 0x81, r + (i & 63) * 64, len);
+    host_usb_pump_one();
+    unit->read_input(n, data);
+  }
+  t1 = host_now_ns();
+  printf("%-16s %10.0f reports/s %8.1f ns/report %6.3f allocs/report %5.1f%% inserted\n", name,
+         BENCH_REPORTS * 1e9 / (t1 - t0), (double)(t1 - t0) / BENCH_REPORTS,
+         (double)(host_mallocs - m0) / BENCH_REPORTS,
+         100.0 * (host_pad[handle[n]].inserts - inserts) / BENCH_REPORTS);
+}
+
+// the decoder and the insert only, returns ns per report
+static double bench_decode(const char *name, int32_t n, BENCH_DECODE_t decode, HID_PLAN_t *plan, int32_t len, BENCH_FILL_t fill) {
+  static uint8_t r[64 * (MAX_XPAD_PAYLOAD + HID_READ_PAD)];
+  uint64_t t0, t1;
+  uint32_t i;
+  double ns;
+
+  for (i = 0; i < 64; i++) {
+    fill(r + i * (MAX_XPAD_PAYLOAD + HID_READ_PAD), i);
+  }
+  t0 = host_now_ns();
+  for (i = 0; i < BENCH_REPORTS; i++) {
+    decode(n, plan, r + (i & 63) * (MAX_XPAD_PAYLOAD + HID_READ_PAD));
+  }
+  t1 = host_now_ns();
+  ns = (double)(t1 - t0) / BENCH_REPORTS;
+  printf("%-16s %10.0f reports/s %8.1f ns/report %2d plan steps %3d bytes\n", name, BENCH_REPORTS * 1e9 / (t1 - t0), ns,
+         (plan != NULL) ? plan->n : 0, len);
+  return(ns);
+}
+
+int main(void) {
+  uint8_t desc[64], link[2] = {0x08, 0x80}, r[HOST_REPORT_LEN];
+  uint16_t old[CELL_PAD_BTN_OFFSET_PRESS_R2 + 1], *now;
+  int32_t wired, rx, len, hid[HID_CORPUS_SIZE], n;
+  uint32_t i;
+  double xbox, ns;
+
+  host_setup(NULL);
+  host_fs_put(DEVICES_FILE, "0x0079, 0x0006, Generic HID, XTYPE_HID\n");
+  if (init_usb() != CELL_OK) {
+    fprintf(stderr, "init_usb failed\n");
+    return(1);
+  }
+  wired = host_plug_xbox360(4);
+  host_register(0);
+
+  // a receiver's controller gets its port from the link report
+  len = host_desc(desc, 0x045e, 0x0719, 0xFF, 0x5D, 0x81, 0x81, 0x01, 32, 1);
+  rx = host_usb_plug(desc, len);
+  host_usb_pump();
+  host_usb_in(rx, 0x81, link, sizeof(link));
+  host_usb_pump();
+  xpadw_links();
+  host_register(1);
+  if (reg_state[0] != REG_READY || reg_state[1] != REG_READY) {
+    fprintf(stderr, "pads did not register\n");
+    return(1);
+  }
+
+  bench("wired", wired, 0, HOST_REPORT_LEN, fill_wired);
+  bench("wired idle", wired, 0, HOST_REPORT_LEN, fill_idle);
+  bench("wireless", rx, 1, HOST_REPORT_W_LEN, fill_wireless);
+
+  // real pads' descriptors through their plans, one at a time in the same port
+  for (i = 0; i < HID_CORPUS_SIZE; i++) {
+    bench_hid = &hid_corpus[i];
+    len = host_desc_hid(desc, 0x0079, 0x0006, bench_hid->len, 64, 4);
+    hid[i] = host_usb_plug(desc, len);
+    host_usb_set_control(hid[i], bench_hid->desc, bench_hid->len);
+    host_usb_pump();
+    if ((n = host_number(hid[i])) < 0) {
+      fprintf(stderr, "%s did not attach\n", bench_hid->name);
+      return(1);
+    }
+    host_register(n);
+    bench(bench_hid->name, hid[i], n, bench_hid->report_len + (bench_hid->report_id != 0), fill_hid);
+    host_usb_unplug(hid[i]);
+    host_usb_pump();
+  }
+
+  // the baseline gives the same buttons and pressures for every button word,
+  // but the ones where PS starts a combo the baseline never had
+  now = host_pad[handle[0]].data.button;
+  for (i = 0; i < 0x10000; i++) {
+    if ((i & btnXbox) && i != btnXbox) {
+      continue;
+    }
+    host_report(r, (uint16_t)i, i & 0xFF, i >> 8, 0, 0, 0, 0);
+    old_read_report(0, r);
+    memcpy(old, now, sizeof(old));
+    xbox_read_report(0, (XBOX360_IN_REPORT *)r);
+    if (memcmp(old, now, sizeof(old)) != 0) {
+      break;
+    }
+  }
+  CHECK(i == 0x10000);
+
+  // decoders alone, a plan should stay within twice the hand written Xbox decoder
+  printf("\ndecode and insert only\n");
+  ns = bench_decode("xbox per XTYPE", 0, decode_old, NULL, HOST_REPORT_LEN, fill_wired);
+  xbox = bench_decode("xbox", 0, decode_xbox, NULL, HOST_REPORT_LEN, fill_wired);
+  printf("%-16s %10.2fx per XTYPE\n", "", xbox / ns);
+  for (i = 0; i < HID_CORPUS_SIZE; i++) {
+    bench_hid = &hid_corpus[i];
+    hid[i] = host_usb_plug(desc, host_desc_hid(desc, 0x0079, 0x0006, bench_hid->len, 64, 4));
+    host_usb_set_control(hid[i], bench_hid->desc, bench_hid->len);
+    host_usb_pump();
+    n = host_number(hid[i]);
+    host_register(n);
+    ns = bench_decode(bench_hid->name, n, decode_hid, &hid_plan[n], bench_hid->report_len, fill_hid);
+    printf("%-16s %10.2fx xbox\n", "", ns / xbox);
+    host_usb_unplug(hid[i]);
+    host_usb_pump();
+  }
+  host_teardown();
+  return(host_finish("bench_translate"));
+}
@@ -0,0 +1,267 @@
+/*
+ * Shared setup for the host tests and benchmarks. Each one includes the
+ * plugin source through this header so it can reach its static functions,
+ * and drives it through the simulated usb bus and pad driver in host.c.
+ */
+#ifndef __XPAD_HARNESS_H__
+#define __XPAD_HARNESS_H__
+
+#include <time.h>
+#include <unistd.h>
+#include "main.c"
+
+#define HOST_REPORT_LEN 20 // wired Xbox 360 input report
+#define HOST_REPORT_W_LEN 29 // wireless receiver input report as sent by the receiver
+
+static int host_checks, host_failed;
+static char host_root[64];
+static uint32_t host_game; /* Process id vsh_game_pid returns, 0 in the xmb */
+
+#define CHECK(cond) do { \
+  host_checks++; \
+  if (!(cond)) { \
+    host_failed++; \
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+  } \
+} while (0)
+
+static inline uint32_t host_game_pid(void) {
+  return(host_game);
+}
+
+static inline uint64_t host_now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static inline void host_rmroot(void) {
+  char cmd[96];
+
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", host_root);
+  if (host_root[0] && system(cmd) != 0) {
+    fprintf(stderr, "could not remove %s\n", host_root);
+  }
+  host_root[0] = 0;
+}
+
+// fresh root directory, settings file and vsh exports, call before init_usb
+static inline void host_setup(const char *settings) {
+  host_rmroot();
+  strcpy(host_root, "/tmp/xpadhostXXXXXX");
+  if (mkdtemp(host_root) == NULL) {
+    perror("mkdtemp");
+    exit(2);
+  }
+  host_fs_root = host_root;
+  if (settings != NULL) {
+    host_fs_put(SETTINGS_FILE, settings);
+  }
+  vshtask_notify = host_notify;
+  vsh_malloc = host_malloc;
+  vsh_free = host_free;
+  vsh_game_pid = host_game_pid;
+  vsh_resolved = VSH_RESOLVE_PASSES;
+}
+
+// the input thread's exit path, for tests that call init_usb themselves
+static inline void host_teardown(void) {
+  xpad_detach_all();
+  xpadw_detach_all();
+  hid_detach_all();
+  shutdown_usb();
+  unit_pool_destroy();
+  remap_free();
+  title_free();
+}
+
+static inline int host_finish(const char *name) {
+  host_rmroot();
+  printf("%s: %d checks, %d failed\n", name, host_checks, host_failed);
+  return(host_failed ? 1 : 0);
+}
+
+// runs xpadd_thread like module start does, returns once it is in its loop
+static inline int32_t host_start(void) {
+  int32_t i;
+
+  if (sys_ppu_thread_create(&thread_id, xpadd_thread, NULL, -0x1d8, 0x2000, SYS_PPU_THREAD_CREATE_JOINABLE, THREAD_NAME) != CELL_OK) {
+    return(-1);
+  }
+  for (i = 0; i < 2000 && !running; i++) {
+    usleep(1000);
+  }
+  return(running ? 0 : -1);
+}
+
+static inline void host_stop(void) {
+  uint64_t exit_code;
+
+  running = 0;
+  sys_event_flag_set(xpad_event, XPAD_EVENT_WAKE);
+  sys_ppu_thread_join(thread_id, &exit_code);
+}
+
+// spins until cond holds or ms pass, for state the input thread changes
+#define HOST_WAIT(cond, ms) do { \
+  int32_t _w; \
+  for (_w = 0; _w < (ms) && !(cond); _w++) { \
+    usleep(1000); \
+  } \
+} while (0)
+
+// device, configuration, interface and endpoint descriptors, out_ep 0 for none
+static inline int32_t host_desc(uint8_t *p, uint16_t vid, uint16_t pid, uint8_t cls, uint8_t sub, uint8_t proto, uint8_t in_ep, uint8_t out_ep, uint16_t payload, uint8_t interval) {
+  uint8_t *q = p;
+  int32_t neps = out_ep ? 2 : 1;
+
+  memset(q, 0, 18);
+  q[0] = 18;
+  q[1] = USB_DESCRIPTOR_TYPE_DEVICE;
+  q[2] = 0x00;
+  q[3] = 0x02;
+  q[7] = 64;
+  q[8] = vid & 0xFF;
+  q[9] = vid >> 8;
+  q[10] = pid & 0xFF;
+  q[11] = pid >> 8;
+  q[17] = 1;
+  q += 18;
+  memset(q, 0, 9);
+  q[0] = 9;
+  q[1] = USB_DESCRIPTOR_TYPE_CONFIGURATION;
+  q[2] = 9 + 9 + 7 * neps;
+  q[4] = 1;
+  q[5] = 1;
+  q += 9;
+  memset(q, 0, 9);
+  q[0] = 9;
+  q[1] = USB_DESCRIPTOR_TYPE_INTERFACE;
+  q[4] = neps;
+  q[5] = cls;
+  q[6] = sub;
+  q[7] = proto;
+  q += 9;
+  q[0] = 7;
+  q[1] = USB_DESCRIPTOR_TYPE_ENDPOINT;
+  q[2] = in_ep;
+  q[3] = 0x03;
+  q[4] = payload & 0xFF;
+  q[5] = payload >> 8;
+  q[6] = interval;
+  q += 7;
+  if (out_ep) {
+    q[0] = 7;
+    q[1] = USB_DESCRIPTOR_TYPE_ENDPOINT;
+    q[2] = out_ep;
+    q[3] = 0x03;
+    q[4] = payload & 0xFF;
+    q[5] = payload >> 8;
+    q[6] = interval;
+    q += 7;
+  }
+  return(q - p);
+}
+
+// HID interface with a class descriptor announcing a desc_len byte report descriptor
+static inline int32_t host_desc_hid(uint8_t *p, uint16_t vid, uint16_t pid, uint16_t desc_len, uint16_t payload, uint8_t interval) {
+  uint8_t *q = p + host_desc(p, vid, pid, 0x03, 0x00, 0x00, 0x81, 0, payload, interval) - 7;
+  uint8_t ep[7];
+
+  // the class descriptor goes between the interface and its endpoint
+  memcpy(ep, q, 7);
+  q[0] = 9;
+  q[1] = 0x21;
+  q[2] = 0x11;
+  q[3] = 0x01;
+  q[4] = 0x00;
+  q[5] = 1;
+  q[6] = 0x22;
+  q[7] = desc_len & 0xFF;
+  q[8] = desc_len >> 8;
+  memcpy(q + 9, ep, 7);
+  p[18 + 2] += 9;
+  return(q + 16 - p);
+}
+
+// receiver with one interface and an in and out endpoint per controller
+static inline int32_t host_desc_receiver(uint8_t *p, uint16_t pid) {
+  uint8_t *q;
+  int32_t i;
+
+  q = p + host_desc(p, 0x045e, pid, 0xFF, 0x5D, 0x81, 0x81, 0x01, 32, 1);
+  for (i = 1; i < MAX_XPADW_NUM; i++) {
+    memcpy(q, p + 18 + 9, 9 + 7 + 7);
+    q[2] = i * 2;
+    q[9 + 2] = 0x81 + i * 2;
+    q[16 + 2] = 0x01 + i * 2;
+    q += 9 + 7 + 7;
+  }
+  p[18 + 2] = (q - p - 18) & 0xFF;
+  p[18 + 3] = (q - p - 18) >> 8;
+  p[18 + 4] = MAX_XPADW_NUM;
+  return(q - p);
+}
+
+// plugs a wired Xbox 360 type device and runs its configuration, returns the dev_id
+static inline int32_t host_plug_wired(uint16_t vid, uint16_t pid, uint8_t interval) {
+  uint8_t desc[64];
+  int32_t dev_id;
+
+  dev_id = host_usb_plug(desc, host_desc(desc, vid, pid, 0xFF, 0x5D, 0x01, 0x81, 0x01, 32, interval));
+  host_usb_pump();
+  return(dev_id);
+}
+
+static inline int32_t host_plug_xbox360(uint8_t interval) {
+  return(host_plug_wired(0x045e, 0x028e, interval));
+}
+
+// controller number of a wired device, -1 if it has none
+static inline int32_t host_number(int32_t dev_id) {
+  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(dev_id);
+
+  return((unit != NULL) ? unit->number : -1);
+}
+
+// wired report, buttons as the btn values in ControlStruct.h and sticks as signed 16 bit values
+static inline void host_report(uint8_t *r, uint16_t buttons, uint8_t trigL, uint8_t trigR, int16_t lx, int16_t ly, int16_t rx, int16_t ry) {
+  memset(r, 0, HOST_REPORT_LEN);
+  r[0] = 0x00;
+  r[1] = HOST_REPORT_LEN;
+  r[2] = buttons >> 8;
+  r[3] = buttons & 0xFF;
+  r[4] = trigL;
+  r[5] = trigR;
+  r[6] = lx & 0xFF;
+  r[7] = (uint16_t)lx >> 8;
+  r[8] = ly & 0xFF;
+  r[9] = (uint16_t)ly >> 8;
+  r[10] = rx & 0xFF;
+  r[11] = (uint16_t)rx >> 8;
+  r[12] = ry & 0xFF;
+  r[13] = (uint16_t)ry >> 8;
+}
+
+// the same report behind the receiver's 4 byte data header
+static inline void host_report_w(uint8_t *r, uint16_t buttons, uint8_t trigL, uint8_t trigR, int16_t lx, int16_t ly, int16_t rx, int16_t ry) {
+  memset(r, 0, HOST_REPORT_W_LEN);
+  host_report(r + 4, buttons, trigL, trigR, lx, ly, rx, ry);
+  r[0] = 0x00;
+  r[1] = 0x01;
+  r[2] = 0x00;
+  r[3] = 0xF0;
+  r[5] = sizeof(XBOX360W_IN_REPORT);
+}
+
+// finishes a pending registration on the calling thread, for tests without the input thread
+static inline void host_register(int32_t n) {
+  host_reg_deliver();
+  if (reg_pending & (1 << n)) {
+    register_poll(n, XPAD.con_unit[n]);
+  }
+  host_usb_pump();
+}
+
+#endif // __XPAD_HARNESS_H__
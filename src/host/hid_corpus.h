@@ -0,0 +1,78 @@
+/*
+ * Report descriptors of real pads for the HID plan tests and benchmark,
+ * transcribed from published dumps of the devices. The DualShock 4 one
+ * stops after its input and output reports, its feature reports carry
+ * nothing a plan reads.
+ */
+#ifndef __XPAD_HID_CORPUS_H__
+#define __XPAD_HID_CORPUS_H__
+
+typedef struct {
+  const char *name;
+  const uint8_t *desc;
+  int32_t len;
+  uint8_t report_id; /* Input report the plan reads, 0 for none */
+  uint8_t report_len; /* Input report length without the id */
+  uint16_t button_bit; /* Bit of button 1 */
+  uint16_t hat_bit; /* Bit of the hat, 0xFFFF for none */
+  uint8_t axis_byte[4]; /* Bytes of X, Y, Z and Rz */
+} HID_CORPUS_t;
+
+// Sony DualShock 3 (054c:0268), report 1 with 19 buttons and 4 sticks
+static const uint8_t hid_ds3[] = {
+  0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0xA1, 0x02, 0x85, 0x01, 0x75, 0x08, 0x95, 0x01, 0x15, 0x00,
+  0x26, 0xFF, 0x00, 0x81, 0x03, 0x75, 0x01, 0x95, 0x13, 0x15, 0x00, 0x25, 0x01, 0x35, 0x00, 0x45,
+  0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x13, 0x81, 0x02, 0x75, 0x01, 0x95, 0x0D, 0x06, 0x00, 0xFF,
+  0x81, 0x03, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x05, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x75, 0x08, 0x95,
+  0x04, 0x35, 0x00, 0x46, 0xFF, 0x00, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x81, 0x02,
+  0xC0, 0x05, 0x01, 0x95, 0x13, 0x09, 0x01, 0x81, 0x02, 0x95, 0x0C, 0x81, 0x01, 0x75, 0x10, 0x95,
+  0x04, 0x26, 0xFF, 0x03, 0x46, 0xFF, 0x03, 0x09, 0x01, 0x81, 0x02, 0xC0, 0xA1, 0x02, 0x85, 0x02,
+  0x75, 0x08, 0x95, 0x30, 0x09, 0x01, 0xB1, 0x02, 0xC0, 0xA1, 0x02, 0x85, 0xEE, 0x75, 0x08, 0x95,
+  0x30, 0x09, 0x01, 0xB1, 0x02, 0xC0, 0xA1, 0x02, 0x85, 0xEF, 0x75, 0x08, 0x95, 0x30, 0x09, 0x01,
+  0xB1, 0x02, 0xC0, 0xC0
+};
+
+// Sony DualShock 4 (054c:05c4), report 1 with sticks, hat, 14 buttons and triggers
+static const uint8_t hid_ds4[] = {
+  0x05, 0x01, 0x09, 0x05, 0xA1, 0x01, 0x85, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35,
+  0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, 0x09, 0x39, 0x15, 0x00, 0x25,
+  0x07, 0x35, 0x00, 0x46, 0x3B, 0x01, 0x65, 0x14, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x65, 0x00,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x0E, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0E, 0x81, 0x02,
+  0x06, 0x00, 0xFF, 0x09, 0x20, 0x75, 0x06, 0x95, 0x01, 0x15, 0x00, 0x25, 0x7F, 0x81, 0x02, 0x05,
+  0x01, 0x09, 0x33, 0x09, 0x34, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x02, 0x81, 0x02,
+  0x06, 0x00, 0xFF, 0x09, 0x21, 0x95, 0x36, 0x81, 0x02, 0x85, 0x05, 0x09, 0x22, 0x95, 0x1F, 0x91,
+  0x02, 0xC0
+};
+
+// DragonRise generic USB gamepad (0079:0006), X Y Z Z Rz, hat and 12 buttons
+static const uint8_t hid_generic[] = {
+  0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0xA1, 0x02, 0x75, 0x08, 0x95, 0x05, 0x15, 0x00, 0x26, 0xFF,
+  0x00, 0x35, 0x00, 0x46, 0xFF, 0x00, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x32, 0x09, 0x35,
+  0x81, 0x02, 0x75, 0x04, 0x95, 0x01, 0x25, 0x07, 0x46, 0x3B, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81,
+  0x42, 0x65, 0x00, 0x75, 0x01, 0x95, 0x0C, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29,
+  0x0C, 0x81, 0x02, 0x06, 0x00, 0xFF, 0x75, 0x01, 0x95, 0x08, 0x25, 0x01, 0x45, 0x01, 0x09, 0x01,
+  0x81, 0x02, 0xC0, 0xA1, 0x02, 0x75, 0x08, 0x95, 0x07, 0x46, 0xFF, 0x00, 0x26, 0xFF, 0x00, 0x09,
+  0x02, 0x91, 0x02, 0xC0, 0xC0
+};
+
+// Logitech Dual Action (046d:c216), sticks, hat, 12 buttons and a vendor byte
+static const uint8_t hid_dual_action[] = {
+  0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0xA1, 0x02, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x35, 0x00, 0x46,
+  0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x81, 0x02,
+  0x25, 0x07, 0x46, 0x3B, 0x01, 0x75, 0x04, 0x95, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65,
+  0x00, 0x75, 0x01, 0x95, 0x0C, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0C, 0x25, 0x01, 0x45, 0x01, 0x81,
+  0x02, 0x06, 0x00, 0xFF, 0x75, 0x01, 0x95, 0x08, 0x25, 0x01, 0x45, 0x01, 0x09, 0x01, 0x81, 0x02,
+  0xC0, 0xA1, 0x02, 0x26, 0xFF, 0x00, 0x46, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x07, 0x09, 0x02, 0x91,
+  0x02, 0xC0, 0xC0
+};
+
+static const HID_CORPUS_t hid_corpus[] = {
+  {"DualShock 3", hid_ds3, sizeof(hid_ds3), 0x01, 48, 8, 0xFFFF, {5, 6, 7, 8}},
+  {"DualShock 4", hid_ds4, sizeof(hid_ds4), 0x01, 63, 36, 32, {0, 1, 2, 3}},
+  {"DragonRise", hid_generic, sizeof(hid_generic), 0x00, 8, 44, 40, {0, 1, 2, 4}},
+  {"Dual Action", hid_dual_action, sizeof(hid_dual_action), 0x00, 7, 36, 32, {0, 1, 2, 3}},
+};
+
+#define HID_CORPUS_SIZE (sizeof(hid_corpus) / sizeof(hid_corpus[0]))
+
+#endif // __XPAD_HID_CORPUS_H__
@@ -0,0 +1,875 @@
+/*
+ * Host implementation of the Cell SDK calls main.c makes: lv2 threads, mutexes
+ * and event flags over pthreads, libfs over the host file system, and a small
+ * simulated usb bus and pad driver that tests plug devices into and feed.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "host.h"
+
+#define HOST_MAX_THREADS 16
+#define HOST_MAX_MUTEXES 64
+#define HOST_MAX_EVENTS 16
+#define HOST_MAX_PIPES 64
+#define HOST_MAX_LDDS 128
+#define HOST_MAX_QUEUED 8 // interrupt IN transfers queued per pipe
+#define HOST_MAX_DONE 256 // completions waiting for host_usb_pump
+#define HOST_DESC_MAX 512
+#define HOST_CONTROL_MAX 1024
+#define HOST_ETIMEDOUT 0x8001000B
+
+typedef struct {
+  pthread_t thread;
+  void (*entry)(uint64_t arg);
+  uint64_t arg;
+  uint8_t used;
+} HOST_THREAD_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint64_t bits;
+  uint8_t used;
+} HOST_EVENT_t;
+
+typedef struct {
+  CellUsbdDoneCallback cb;
+  void *arg;
+  void *buf;
+  int32_t len;
+} HOST_XFER_t;
+
+typedef struct {
+  int32_t dev_id;
+  uint8_t ep; /* Endpoint address, 0 for the control pipe */
+  uint8_t used;
+  uint32_t queued; /* Interrupt IN transfers waiting for data */
+  HOST_XFER_t xfer[HOST_MAX_QUEUED];
+} HOST_PIPE_t;
+
+typedef struct {
+  CellUsbdDoneCallback cb;
+  int32_t result;
+  int32_t count;
+  void *arg;
+} HOST_DONE_t;
+
+typedef struct {
+  uint8_t used;
+  uint8_t desc[HOST_DESC_MAX];
+  int32_t len;
+  void *priv;
+  CellUsbdLddOps *ops; /* Driver that attached */
+  uint8_t control[HOST_CONTROL_MAX];
+  int32_t control_len;
+  uint8_t out[64];
+  int32_t out_len;
+} HOST_DEVICE_t;
+
+typedef struct {
+  CellUsbdLddOps *ops;
+  uint16_t vid, lo, hi;
+} HOST_LDD_t;
+
+typedef struct {
+  int32_t *handle;
+  int32_t id;
+  uint64_t due;
+} HOST_REG_t;
+
+const char *host_fs_root = ".";
+volatile uint64_t host_mallocs;
+volatile uint64_t host_frees;
+HOST_PAD_t host_pad[HOST_MAX_PORTS];
+uint32_t host_reg_delay_us;
+uint8_t host_port_missing;
+uint32_t host_sleep_scale = 1000;
+char host_last_msg[256];
+void (*host_insert_hook)(int32_t handle, const CellPadData *data);
+
+static HOST_THREAD_t threads[HOST_MAX_THREADS];
+static pthread_mutex_t mutexes[HOST_MAX_MUTEXES];
+static uint8_t mutex_used[HOST_MAX_MUTEXES];
+static HOST_EVENT_t events[HOST_MAX_EVENTS];
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t usb_lock = PTHREAD_MUTEX_INITIALIZER;
+static HOST_DEVICE_t devices[HOST_MAX_DEVICES];
+static HOST_PIPE_t pipes[HOST_MAX_PIPES];
+static HOST_LDD_t ldds[HOST_MAX_LDDS];
+static int32_t ldd_count;
+static HOST_DONE_t done[HOST_MAX_DONE];
+static uint32_t done_head, done_tail;
+static HOST_REG_t regs[HOST_MAX_PORTS];
+static pthread_mutex_t pad_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// start of lv2 methods
+static void *thread_start(void *p) {
+  HOST_THREAD_t *t = (HOST_THREAD_t *)p;
+
+  t->entry(t->arg);
+  return(NULL);
+}
+
+int host_thread_create(sys_ppu_thread_t *id, void *entry, uint64_t arg, const char *name) {
+  int32_t i;
+  (void)name;
+
+  pthread_mutex_lock(&table_lock);
+  for (i = 0; i < HOST_MAX_THREADS && threads[i].used; i++);
+  if (i == HOST_MAX_THREADS) {
+    pthread_mutex_unlock(&table_lock);
+    return(-1);
+  }
+  threads[i].used = 1;
+  pthread_mutex_unlock(&table_lock);
+  threads[i].entry = (void (*)(uint64_t))entry;
+  threads[i].arg = arg;
+  *id = i;
+  return(pthread_create(&threads[i].thread, NULL, thread_start, &threads[i]) == 0 ? CELL_OK : -1);
+}
+
+int sys_ppu_thread_join(sys_ppu_thread_t id, uint64_t *exit_code) {
+  if (id >= HOST_MAX_THREADS || !threads[id].used) {
+    return(-1);
+  }
+  pthread_join(threads[id].thread, NULL);
+  threads[id].used = 0;
+  *exit_code = 0;
+  return(CELL_OK);
+}
+
+void sys_ppu_thread_exit(uint64_t val) {
+  (void)val;
+  pthread_exit(NULL);
+}
+
+int sys_mutex_create(sys_mutex_t *id, sys_mutex_attribute_t *attr) {
+  int32_t i;
+  (void)attr;
+
+  pthread_mutex_lock(&table_lock);
+  for (i = 0; i < HOST_MAX_MUTEXES && mutex_used[i]; i++);
+  if (i == HOST_MAX_MUTEXES) {
+    pthread_mutex_unlock(&table_lock);
+    return(-1);
+  }
+  mutex_used[i] = 1;
+  pthread_mutex_init(&mutexes[i], NULL);
+  pthread_mutex_unlock(&table_lock);
+  *id = i + 1;
+  return(CELL_OK);
+}
+
+int sys_mutex_destroy(sys_mutex_t id) {
+  if (id == 0 || id > HOST_MAX_MUTEXES || !mutex_used[id - 1]) {
+    return(-1);
+  }
+  pthread_mutex_destroy(&mutexes[id - 1]);
+  mutex_used[id - 1] = 0;
+  return(CELL_OK);
+}
+
+int sys_mutex_lock(sys_mutex_t id, usecond_t timeout) {
+  (void)timeout;
+  if (id == 0 || id > HOST_MAX_MUTEXES || !mutex_used[id - 1]) {
+    return(-1);
+  }
+  return(pthread_mutex_lock(&mutexes[id - 1]) == 0 ? CELL_OK : -1);
+}
+
+int sys_mutex_unlock(sys_mutex_t id) {
+  if (id == 0 || id > HOST_MAX_MUTEXES || !mutex_used[id - 1]) {
+    return(-1);
+  }
+  return(pthread_mutex_unlock(&mutexes[id - 1]) == 0 ? CELL_OK : -1);
+}
+
+int sys_event_flag_create(sys_event_flag_t *id, sys_event_flag_attribute_t *attr, uint64_t init) {
+  int32_t i;
+  (void)attr;
+
+  pthread_mutex_lock(&table_lock);
+  for (i = 0; i < HOST_MAX_EVENTS && events[i].used; i++);
+  if (i == HOST_MAX_EVENTS) {
+    pthread_mutex_unlock(&table_lock);
+    return(-1);
+  }
+  events[i].used = 1;
+  events[i].bits = init;
+  pthread_mutex_init(&events[i].lock, NULL);
+  pthread_cond_init(&events[i].cond, NULL);
+  pthread_mutex_unlock(&table_lock);
+  *id = i + 1;
+  return(CELL_OK);
+}
+
+int sys_event_flag_destroy(sys_event_flag_t id) {
+  if (id == 0 || id > HOST_MAX_EVENTS || !events[id - 1].used) {
+    return(-1);
+  }
+  pthread_mutex_destroy(&events[id - 1].lock);
+  pthread_cond_destroy(&events[id - 1].cond);
+  events[id - 1].used = 0;
+  return(CELL_OK);
+}
+
+int sys_event_flag_wait(sys_event_flag_t id, uint64_t bitptn, uint32_t mode, uint64_t *result, usecond_t timeout) {
+  HOST_EVENT_t *e;
+  struct timespec ts;
+  int r = 0;
+
+  if (id == 0 || id > HOST_MAX_EVENTS || !events[id - 1].used) {
+    return(-1);
+  }
+  host_reg_deliver();
+  e = &events[id - 1];
+  if (timeout) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000000;
+    ts.tv_nsec += (timeout % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+  }
+  pthread_mutex_lock(&e->lock);
+  while (r == 0 && ((mode & SYS_EVENT_FLAG_WAIT_AND) ? (e->bits & bitptn) != bitptn : (e->bits & bitptn) == 0)) {
+    r = timeout ? pthread_cond_timedwait(&e->cond, &e->lock, &ts) : pthread_cond_wait(&e->cond, &e->lock);
+  }
+  if (r != 0) {
+    pthread_mutex_unlock(&e->lock);
+    host_reg_deliver();
+    return(HOST_ETIMEDOUT);
+  }
+  if (result) {
+    *result = e->bits;
+  }
+  if (mode & SYS_EVENT_FLAG_WAIT_CLEAR) {
+    e->bits &= ~bitptn;
+  }
+  pthread_mutex_unlock(&e->lock);
+  return(CELL_OK);
+}
+
+int sys_event_flag_set(sys_event_flag_t id, uint64_t bitptn) {
+  HOST_EVENT_t *e;
+
+  if (id == 0 || id > HOST_MAX_EVENTS || !events[id - 1].used) {
+    return(-1);
+  }
+  e = &events[id - 1];
+  pthread_mutex_lock(&e->lock);
+  e->bits |= bitptn;
+  pthread_cond_broadcast(&e->cond);
+  pthread_mutex_unlock(&e->lock);
+  return(CELL_OK);
+}
+
+int sys_timer_usleep(usecond_t us) {
+  host_reg_deliver();
+  usleep(us);
+  host_reg_deliver();
+  return(CELL_OK);
+}
+
+int sys_timer_sleep(uint32_t sec) {
+  usleep((useconds_t)((uint64_t)sec * 1000000 / (host_sleep_scale ? host_sleep_scale : 1)));
+  return(CELL_OK);
+}
+
+static uint64_t host_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+system_time_t sys_time_get_system_time(void) {
+  return(host_ns() / 1000);
+}
+
+uint64_t sys_time_get_timebase_frequency(void) {
+  return(HOST_TIMEBASE);
+}
+
+uint64_t __mftb(void) {
+  uint64_t ns = host_ns();
+
+  return((ns / 1000000000ULL) * HOST_TIMEBASE + (ns % 1000000000ULL) * HOST_TIMEBASE / 1000000000ULL);
+}
+
+uint64_t host_syscall(int n, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4) {
+  int32_t i;
+  (void)a3;
+  (void)a4;
+
+  switch (n) {
+  case 41: // ppu thread exit
+    pthread_exit(NULL);
+  case 574: // register a virtual controller, the handle is written later
+
+    pthread_mutex_lock(&pad_lock);
+    for (i = 0; i < HOST_MAX_PORTS && (host_pad[i].registered || regs[i].handle != NULL); i++);
+    if (i < HOST_MAX_PORTS) {
+      regs[i].handle = (int32_t *)(uintptr_t)a2;
+      regs[i].id = i;
+      regs[i].due = sys_time_get_system_time() + host_reg_delay_us;
+      (void)a1;
+    }
+    pthread_mutex_unlock(&pad_lock);
+    if (host_reg_delay_us == 0) {
+      host_reg_deliver();
+    }
+    return(0);
+  default:
+    return(0);
+  }
+}
+// end of lv2 methods
+
+// start of vsh methods
+void *host_malloc(unsigned int size) {
+  __atomic_fetch_add(&host_mallocs, 1, __ATOMIC_RELAXED);
+  return(malloc(size));
+}
+
+int host_free(void *ptr) {
+  __atomic_fetch_add(&host_frees, 1, __ATOMIC_RELAXED);
+  free(ptr);
+  return(0);
+}
+
+int host_notify(int unk, const char *msg) {
+  (void)unk;
+  snprintf(host_last_msg, sizeof(host_last_msg), "%s", msg);
+  return(0);
+}
+// end of vsh methods
+
+// start of libfs methods
+static void fs_path(char *out, size_t len, const char *path) {
+  snprintf(out, len, "%s%s", host_fs_root, path);
+}
+
+int cellFsOpen(const char *path, int flags, int *fd, const void *arg, uint64_t size) {
+  char p[512];
+  (void)arg;
+  (void)size;
+
+  fs_path(p, sizeof(p), path);
+  *fd = open(p, flags & (O_ACCMODE | O_CREAT | O_TRUNC | O_APPEND), 0644);
+  return((*fd < 0) ? CELL_FS_ENOENT : CELL_FS_SUCCEEDED);
+}
+
+int cellFsRead(int fd, void *buf, uint64_t nbytes, uint64_t *nread) {
+  ssize_t n = read(fd, buf, nbytes);
+
+  if (n < 0) {
+    return(-1);
+  }
+  if (nread) {
+    *nread = n;
+  }
+  return(CELL_FS_SUCCEEDED);
+}
+
+int cellFsWrite(int fd, const void *buf, uint64_t nbytes, uint64_t *nwrite) {
+  ssize_t n = write(fd, buf, nbytes);
+
+  if (n < 0) {
+    return(-1);
+  }
+  if (nwrite) {
+    *nwrite = n;
+  }
+  return(CELL_FS_SUCCEEDED);
+}
+
+int cellFsClose(int fd) {
+  return(close(fd) == 0 ? CELL_FS_SUCCEEDED : -1);
+}
+
+int cellFsStat(const char *path, CellFsStat *sb) {
+  char p[512];
+  struct stat st;
+
+  fs_path(p, sizeof(p), path);
+  if (stat(p, &st) != 0) {
+    return(CELL_FS_ENOENT);
+  }
+  sb->st_mode = st.st_mode;
+  sb->st_size = st.st_size;
+  return(CELL_FS_SUCCEEDED);
+}
+
+int32_t host_fs_put(const char *path, const char *data) {
+  char p[512], *s;
+  FILE *f;
+
+  // create the directories leading to the file first
+  fs_path(p, sizeof(p), path);
+  for (s = p + 1; *s; s++) {
+    if (*s == '/') {
+      *s = 0;
+      mkdir(p, 0755);
+      *s = '/';
+    }
+  }
+  if ((f = fopen(p, "wb")) == NULL) {
+    return(-1);
+  }
+  fputs(data, f);
+  fclose(f);
+  return(0);
+}
+
+void host_fs_remove(const char *path) {
+  char p[512];
+
+  fs_path(p, sizeof(p), path);
+  unlink(p);
+}
+// end of libfs methods
+
+// start of libpad methods
+void host_reg_deliver(void) {
+  int32_t i;
+  uint64_t now = sys_time_get_system_time();
+
+  pthread_mutex_lock(&pad_lock);
+  for (i = 0; i < HOST_MAX_PORTS; i++) {
+    if (regs[i].handle != NULL && now >= regs[i].due) {
+      memset(&host_pad[i], 0, sizeof(HOST_PAD_t));
+      host_pad[i].registered = 1;
+      __atomic_store_n(regs[i].handle, regs[i].id, __ATOMIC_SEQ_CST);
+      regs[i].handle = NULL;
+    }
+  }
+  pthread_mutex_unlock(&pad_lock);
+}
+
+int32_t cellPadGetInfo2(CellPadInfo2 *info) {
+  memset(info, 0, sizeof(CellPadInfo2));
+  return(CELL_PAD_OK);
+}
+
+int32_t cellPadSetPortSetting(uint32_t port_no, uint32_t port_setting) {
+  (void)port_no;
+  (void)port_setting;
+  return(CELL_PAD_OK);
+}
+
+int32_t cellPadLddRegisterController(void) {
+  return(-1);
+}
+
+int32_t cellPadLddUnregisterController(int32_t handle) {
+  if (handle < 0 || handle >= HOST_MAX_PORTS || !host_pad[handle].registered) {
+    return(-1);
+  }
+  host_pad[handle].registered = 0;
+  return(CELL_PAD_OK);
+}
+
+int32_t cellPadLddDataInsert(int32_t handle, CellPadData *data) {
+  HOST_PAD_t *pad;
+
+  if (handle < 0 || handle >= HOST_MAX_PORTS || !host_pad[handle].registered) {
+    return(-1);
+  }
+  pad = &host_pad[handle];
+  pad->data = *data;
+  if (host_insert_hook != NULL) {
+    host_insert_hook(handle, data);
+  }
+  __atomic_store_n(&pad->last_tb, __mftb(), __ATOMIC_RELEASE);
+  __atomic_fetch_add(&pad->inserts, 1, __ATOMIC_RELEASE);
+  return(CELL_PAD_OK);
+}
+
+int32_t cellPadLddGetPortNo(int32_t handle) {
+  if (handle < 0 || handle >= HOST_MAX_PORTS || !host_pad[handle].registered || host_port_missing) {
+    return(-1);
+  }
+  return(handle);
+}
+// end of libpad methods
+
+// start of libusbd methods
+static HOST_DEVICE_t *usb_device(int32_t dev_id) {
+  if (dev_id < 1 || dev_id > HOST_MAX_DEVICES || !devices[dev_id - 1].used) {
+    return(NULL);
+  }
+  return(&devices[dev_id - 1]);
+}
+
+static HOST_PIPE_t *usb_pipe(int32_t pipe_id) {
+  if (pipe_id < 1 || pipe_id > HOST_MAX_PIPES || !pipes[pipe_id - 1].used || usb_device(pipes[pipe_id - 1].dev_id) == NULL) {
+    return(NULL);
+  }
+  return(&pipes[pipe_id - 1]);
+}
+
+static void usb_done(CellUsbdDoneCallback cb, int32_t result, int32_t count, void *arg) {
+
+  // called with usb_lock held
+  if (done_tail - done_head >= HOST_MAX_DONE) {
+    fprintf(stderr, "host: completion queue full\n");
+    abort();
+  }
+  done[done_tail % HOST_MAX_DONE].cb = cb;
+  done[done_tail % HOST_MAX_DONE].result = result;
+  done[done_tail % HOST_MAX_DONE].count = count;
+  done[done_tail % HOST_MAX_DONE].arg = arg;
+  done_tail++;
+}
+
+int32_t cellUsbdRegisterExtraLdd2(CellUsbdLddOps *lddops, uint16_t idVendor, uint16_t idProductMin, uint16_t idProductMax) {
+  if (ldd_count >= HOST_MAX_LDDS) {
+    return(-1);
+  }
+  ldds[ldd_count].ops = lddops;
+  ldds[ldd_count].vid = idVendor;
+  ldds[ldd_count].lo = idProductMin;
+  ldds[ldd_count].hi = idProductMax;
+  ldd_count++;
+  return(CELL_OK);
+}
+
+int32_t cellUsbdUnregisterExtraLdd(CellUsbdLddOps *lddops) {
+  int32_t i, j, found = 0;
+
+  for (i = 0, j = 0; i < ldd_count; i++) {
+    if (ldds[i].ops == lddops) {
+      found = 1;
+    } else {
+      ldds[j++] = ldds[i];
+    }
+  }
+  ldd_count = j;
+  return(found ? CELL_OK : -1);
+}
+
+void *cellUsbdScanStaticDescriptor(int32_t dev_id, void *ptr, unsigned char type) {
+  HOST_DEVICE_t *dev;
+  uint8_t *p, *end;
+
+  if ((dev = usb_device(dev_id)) == NULL) {
+    return(NULL);
+  }
+  end = dev->desc + dev->len;
+  p = (ptr == NULL) ? dev->desc : (uint8_t *)ptr + ((uint8_t *)ptr)[0];
+  while (p + 2 <= end && p[0] >= 2) {
+    if (type == 0 || p[1] == type) {
+      return(p);
+    }
+    p += p[0];
+  }
+  return(NULL);
+}
+
+int32_t cellUsbdOpenPipe(int32_t dev_id, UsbEndpointDescriptor *ed) {
+  int32_t i;
+  uint8_t *p, ep = 0;
+
+  // an endpoint the device doesn't have can't be opened
+  if (ed != NULL) {
+    ep = ed->bEndpointAddress;
+    for (p = NULL; (p = cellUsbdScanStaticDescriptor(dev_id, p, USB_DESCRIPTOR_TYPE_ENDPOINT)) != NULL && p[2] != ep;);
+    if (p == NULL) {
+      return(-1);
+    }
+  }
+  pthread_mutex_lock(&usb_lock);
+  if (usb_device(dev_id) == NULL) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+  for (i = 0; i < HOST_MAX_PIPES && pipes[i].used; i++);
+  if (i == HOST_MAX_PIPES) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+  memset(&pipes[i], 0, sizeof(HOST_PIPE_t));
+  pipes[i].used = 1;
+  pipes[i].dev_id = dev_id;
+  pipes[i].ep = ep;
+  pthread_mutex_unlock(&usb_lock);
+  return(i + 1);
+}
+
+int32_t cellUsbdSetPrivateData(int32_t dev_id, void *priv) {
+  HOST_DEVICE_t *dev;
+
+  if ((dev = usb_device(dev_id)) == NULL) {
+    return(-1);
+  }
+  dev->priv = priv;
+  return(CELL_OK);
+}
+
+void *cellUsbdGetPrivateData(int32_t dev_id) {
+  HOST_DEVICE_t *dev;
+
+  if ((dev = usb_device(dev_id)) == NULL) {
+    return(NULL);
+  }
+  return(dev->priv);
+}
+
+int32_t cellUsbdSetConfiguration(int32_t pipe_id, uint8_t config, CellUsbdDoneCallback cb, void *arg) {
+  (void)config;
+  pthread_mutex_lock(&usb_lock);
+  if (usb_pipe(pipe_id) == NULL) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+  usb_done(cb, HC_CC_NOERR, 0, arg);
+  pthread_mutex_unlock(&usb_lock);
+  return(CELL_OK);
+}
+
+int32_t cellUsbdSetInterface(int32_t pipe_id, uint8_t ifnum, uint8_t as, CellUsbdDoneCallback cb, void *arg) {
+  (void)ifnum;
+  return(cellUsbdSetConfiguration(pipe_id, as, cb, arg));
+}
+
+int32_t cellUsbdControlTransfer(int32_t pipe_id, UsbDeviceRequest *req, void *buf, CellUsbdDoneCallback cb, void *arg) {
+  HOST_PIPE_t *pipe;
+  HOST_DEVICE_t *dev;
+  int32_t count = 0;
+  uint16_t len;
+
+  // device to host requests get the reply set with host_usb_set_control
+  pthread_mutex_lock(&usb_lock);
+  if ((pipe = usb_pipe(pipe_id)) == NULL) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+  dev = usb_device(pipe->dev_id);
+  memcpy(&len, &req->wLength, sizeof(len));
+  if (req->bmRequestType & 0x80) {
+    count = (dev->control_len < len) ? dev->control_len : len;
+    memcpy(buf, dev->control, count);
+  }
+  usb_done(cb, HC_CC_NOERR, count, arg);
+  pthread_mutex_unlock(&usb_lock);
+  return(CELL_OK);
+}
+
+int32_t cellUsbdInterruptTransfer(int32_t pipe_id, void *buf, int32_t len, CellUsbdDoneCallback cb, void *arg) {
+  HOST_PIPE_t *pipe;
+  HOST_DEVICE_t *dev;
+  HOST_XFER_t *x;
+
+  pthread_mutex_lock(&usb_lock);
+  if ((pipe = usb_pipe(pipe_id)) == NULL) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+
+  // IN transfers wait for host_usb_in, OUT ones are taken right away
+  if (pipe->ep & 0x80) {
+    if (pipe->queued >= HOST_MAX_QUEUED) {
+      pthread_mutex_unlock(&usb_lock);
+      return(-1);
+    }
+    x = &pipe->xfer[pipe->queued++];
+    x->cb = cb;
+    x->arg = arg;
+    x->buf = buf;
+    x->len = len;
+  } else {
+    dev = usb_device(pipe->dev_id);
+    dev->out_len = (len < (int32_t)sizeof(dev->out)) ? len : (int32_t)sizeof(dev->out);
+    memcpy(dev->out, buf, dev->out_len);
+    usb_done(cb, HC_CC_NOERR, len, arg);
+  }
+  pthread_mutex_unlock(&usb_lock);
+  return(CELL_OK);
+}
+
+int32_t host_usb_plug(const uint8_t *desc, int32_t len) {
+  int32_t i, dev_id;
+  uint16_t vid, pid;
+  HOST_DEVICE_t *dev;
+
+  if (len > HOST_DESC_MAX || len < (int32_t)sizeof(UsbDeviceDescriptor)) {
+    return(-1);
+  }
+  pthread_mutex_lock(&usb_lock);
+  for (i = 0; i < HOST_MAX_DEVICES && devices[i].used; i++);
+  if (i == HOST_MAX_DEVICES) {
+    pthread_mutex_unlock(&usb_lock);
+    return(-1);
+  }
+  dev = &devices[i];
+  memset(dev, 0, sizeof(HOST_DEVICE_t));
+  memcpy(dev->desc, desc, len);
+  dev->len = len;
+  dev->used = 1;
+  dev_id = i + 1;
+  pthread_mutex_unlock(&usb_lock);
+
+  // offer the device to each driver registered for its ids until one takes it
+  vid = desc[8] | (desc[9] << 8);
+  pid = desc[10] | (desc[11] << 8);
+  for (i = 0; i < ldd_count; i++) {
+    if (ldds[i].vid != vid || pid < ldds[i].lo || pid > ldds[i].hi) {
+      continue;
+    }
+    if (ldds[i].ops->probe(dev_id) != CELL_USBD_PROBE_SUCCEEDED) {
+      continue;
+    }
+    if (ldds[i].ops->attach(dev_id) == CELL_USBD_ATTACH_SUCCEEDED) {
+      dev->ops = ldds[i].ops;
+    }
+    break;
+  }
+  return(dev_id);
+}
+
+void host_usb_unplug(int32_t dev_id) {
+  int32_t i;
+  HOST_DEVICE_t *dev;
+
+  if ((dev = usb_device(dev_id)) == NULL) {
+    return;
+  }
+  if (dev->ops != NULL) {
+    dev->ops->detach(dev_id);
+  }
+
+  // transfers still queued are dropped, completions already made still run
+  pthread_mutex_lock(&usb_lock);
+  for (i = 0; i < HOST_MAX_PIPES; i++) {
+    if (pipes[i].used && pipes[i].dev_id == dev_id) {
+      pipes[i].used = 0;
+    }
+  }
+  dev->used = 0;
+  pthread_mutex_unlock(&usb_lock);
+}
+
+void host_usb_set_control(int32_t dev_id, const uint8_t *data, int32_t len) {
+  HOST_DEVICE_t *dev;
+
+  if ((dev = usb_device(dev_id)) == NULL || len > HOST_CONTROL_MAX) {
+    return;
+  }
+  memcpy(dev->control, data, len);
+  dev->control_len = len;
+}
+
+static HOST_PIPE_t *usb_find_pipe(int32_t dev_id, uint8_t ep) {
+  int32_t i;
+
+  for (i = 0; i < HOST_MAX_PIPES; i++) {
+    if (pipes[i].used && pipes[i].dev_id == dev_id && pipes[i].ep == ep) {
+      return(&pipes[i]);
+    }
+  }
+  return(NULL);
+}
+
+int32_t host_usb_in(int32_t dev_id, uint8_t ep, const void *data, int32_t len) {
+  HOST_PIPE_t *pipe;
+  HOST_XFER_t x;
+  int32_t count;
+
+  pthread_mutex_lock(&usb_lock);
+  if ((pipe = usb_find_pipe(dev_id, ep)) == NULL || pipe->queued == 0) {
+    pthread_mutex_unlock(&usb_lock);
+    return(0);
+  }
+  x = pipe->xfer[0];
+  memmove(&pipe->xfer[0], &pipe->xfer[1], (pipe->queued - 1) * sizeof(HOST_XFER_t));
+  pipe->queued--;
+  count = (len < x.len) ? len : x.len;
+  memcpy(x.buf, data, count);
+  usb_done(x.cb, HC_CC_NOERR, count, x.arg);
+  pthread_mutex_unlock(&usb_lock);
+  return(1);
+}
+
+int32_t host_usb_in_queued(int32_t dev_id, uint8_t ep) {
+  HOST_PIPE_t *pipe;
+  int32_t n;
+
+  pthread_mutex_lock(&usb_lock);
+  n = ((pipe = usb_find_pipe(dev_id, ep)) != NULL) ? (int32_t)pipe->queued : 0;
+  pthread_mutex_unlock(&usb_lock);
+  return(n);
+}
+
+int32_t host_usb_ldds(uint16_t vid, uint16_t pid, CellUsbdLddOps **ops) {
+  int32_t i, n = 0;
+
+  *ops = NULL;
+  for (i = 0; i < ldd_count; i++) {
+    if (ldds[i].vid == vid && pid >= ldds[i].lo && pid <= ldds[i].hi) {
+      *ops = (n++ == 0) ? ldds[i].ops : *ops;
+    }
+  }
+  return(n);
+}
+
+int32_t host_usb_out(int32_t dev_id, uint8_t *buf, int32_t max) {
+  HOST_DEVICE_t *dev;
+  int32_t n;
+
+  if ((dev = usb_device(dev_id)) == NULL) {
+    return(0);
+  }
+  n = (dev->out_len < max) ? dev->out_len : max;
+  memcpy(buf, dev->out, n);
+  return(n);
+}
+
+int32_t host_usb_pump_one(void) {
+  HOST_DONE_t d;
+
+  pthread_mutex_lock(&usb_lock);
+  if (done_head == done_tail) {
+    pthread_mutex_unlock(&usb_lock);
+    return(0);
+  }
+  d = done[done_head % HOST_MAX_DONE];
+  done_head++;
+  pthread_mutex_unlock(&usb_lock);
+  d.cb(d.result, d.count, d.arg);
+  return(1);
+}
+
+int32_t host_usb_pump_newest(void) {
+  HOST_DONE_t d;
+
+  pthread_mutex_lock(&usb_lock);
+  if (done_head == done_tail) {
+    pthread_mutex_unlock(&usb_lock);
+    return(0);
+  }
+  done_tail--;
+  d = done[done_tail % HOST_MAX_DONE];
+  pthread_mutex_unlock(&usb_lock);
+  d.cb(d.result, d.count, d.arg);
+  return(1);
+}
+
+int32_t host_usb_pump(void) {
+  int32_t n = 0;
+
+  while (host_usb_pump_one()) {
+    n++;
+  }
+  return(n);
+}
+// end of libusbd methods
@@ -0,0 +1,333 @@
+/*
+ * Host stand-ins for the Cell SDK headers main.c includes, just enough of
+ * lv2, libpad, libusbd and libfs to build the plugin on Linux. The calls are
+ * implemented in host.c on top of pthreads and the host file system, with a
+ * simulated usb bus and pad driver the tests and benchmarks drive.
+ */
+#ifndef __XPAD_HOST_H__
+#define __XPAD_HOST_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// lv2
+#define CELL_OK 0
+#define SYS_PPU_THREAD_CREATE_JOINABLE 0x1
+#define SYS_PRX_RESIDENT 0
+#define SYS_PRX_STOP_OK 0
+#define SYS_EVENT_FLAG_WAIT_AND 0x01
+#define SYS_EVENT_FLAG_WAIT_OR 0x02
+#define SYS_EVENT_FLAG_WAIT_CLEAR 0x10
+#define SYS_MODULE_INFO(name, attr, major, minor)
+#define SYS_MODULE_START(func)
+#define SYS_MODULE_STOP(func)
+
+typedef uint64_t sys_ppu_thread_t;
+typedef int32_t sys_prx_id_t;
+typedef uint32_t sys_mutex_t;
+typedef uint32_t sys_event_flag_t;
+typedef uint64_t usecond_t;
+typedef uint64_t system_time_t;
+
+typedef struct {
+  uint32_t attr_protocol;
+  uint32_t attr_recursive;
+} sys_mutex_attribute_t;
+
+typedef struct {
+  uint32_t attr_protocol;
+  int type;
+} sys_event_flag_attribute_t;
+
+#define sys_mutex_attribute_initialize(x) ((x).attr_protocol = 0, (x).attr_recursive = 0)
+#define sys_event_flag_attribute_initialize(x) ((x).attr_protocol = 0, (x).type = 0)
+
+int host_thread_create(sys_ppu_thread_t *id, void *entry, uint64_t arg, const char *name);
+#define sys_ppu_thread_create(id, entry, arg, prio, stack, flags, name) host_thread_create((id), (void *)(entry), (uint64_t)(uintptr_t)(arg), (name))
+int sys_ppu_thread_join(sys_ppu_thread_t id, uint64_t *exit_code);
+void sys_ppu_thread_exit(uint64_t val) __attribute__((noreturn));
+
+int sys_mutex_create(sys_mutex_t *id, sys_mutex_attribute_t *attr);
+int sys_mutex_destroy(sys_mutex_t id);
+int sys_mutex_lock(sys_mutex_t id, usecond_t timeout);
+int sys_mutex_unlock(sys_mutex_t id);
+
+int sys_event_flag_create(sys_event_flag_t *id, sys_event_flag_attribute_t *attr, uint64_t init);
+int sys_event_flag_destroy(sys_event_flag_t id);
+int sys_event_flag_wait(sys_event_flag_t id, uint64_t bitptn, uint32_t mode, uint64_t *result, usecond_t timeout);
+int sys_event_flag_set(sys_event_flag_t id, uint64_t bitptn);
+
+int sys_timer_usleep(usecond_t us);
+int sys_timer_sleep(uint32_t sec);
+system_time_t sys_time_get_system_time(void);
+uint64_t sys_time_get_timebase_frequency(void);
+
+// lv2 syscalls, p1 holds the result like the SDK macros
+uint64_t host_syscall(int n, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4);
+#define system_call_1(n, a1) uint64_t p1 = host_syscall((n), (uint64_t)(a1), 0, 0, 0); (void)p1
+#define system_call_4(n, a1, a2, a3, a4) host_syscall((n), (uint64_t)(uintptr_t)(a1), (uint64_t)(uintptr_t)(a2), (uint64_t)(uintptr_t)(a3), (uint64_t)(uintptr_t)(a4))
+
+// ppu intrinsics, the timebase runs at the console's 79.8 MHz
+#define HOST_TIMEBASE 79800000ULL
+uint64_t __mftb(void);
+#define __lwsync() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __cntlzw(x) host_cntlzw((uint32_t)(x))
+#define __cntlzd(x) host_cntlzd((uint64_t)(x))
+
+static inline uint32_t host_cntlzw(uint32_t x) {
+  return(x ? (uint32_t)__builtin_clz(x) : 32);
+}
+
+static inline uint32_t host_cntlzd(uint64_t x) {
+  return(x ? (uint32_t)__builtin_clzll(x) : 64);
+}
+
+// atomics, each returns the value before the update
+static inline uint32_t cellAtomicStore32(uint32_t *ea, uint32_t value) {
+  return(__atomic_exchange_n(ea, value, __ATOMIC_SEQ_CST));
+}
+
+static inline uint32_t cellAtomicOr32(uint32_t *ea, uint32_t value) {
+  return(__atomic_fetch_or(ea, value, __ATOMIC_SEQ_CST));
+}
+
+static inline uint32_t cellAtomicAnd32(uint32_t *ea, uint32_t value) {
+  return(__atomic_fetch_and(ea, value, __ATOMIC_SEQ_CST));
+}
+
+static inline uint32_t cellAtomicCompareAndSwap32(uint32_t *ea, uint32_t old, uint32_t value) {
+  __atomic_compare_exchange_n(ea, &old, value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return(old);
+}
+
+// libfs, paths are looked up under host_fs_root
+#define CELL_FS_SUCCEEDED 0
+#define CELL_FS_ENOENT -1
+#define CELL_FS_O_RDONLY 000000
+#define CELL_FS_O_WRONLY 000001
+#define CELL_FS_O_RDWR 000002
+#define CELL_FS_O_CREAT 000100
+#define CELL_FS_O_TRUNC 001000
+#define CELL_FS_O_APPEND 002000
+
+typedef struct {
+  uint32_t st_mode;
+  uint64_t st_size;
+} CellFsStat;
+
+int cellFsOpen(const char *path, int flags, int *fd, const void *arg, uint64_t size);
+int cellFsRead(int fd, void *buf, uint64_t nbytes, uint64_t *nread);
+int cellFsWrite(int fd, const void *buf, uint64_t nbytes, uint64_t *nwrite);
+int cellFsClose(int fd);
+int cellFsStat(const char *path, CellFsStat *sb);
+
+// libpad
+#define CELL_PAD_OK 0
+#define CELL_PAD_MAX_PORT_NUM 7
+#define CELL_PAD_MAX_CODES 64
+#define CELL_PAD_STATUS_ASSIGN_CHANGES 0x2
+#define CELL_PAD_SETTING_PRESS_ON 0x2
+#define CELL_PAD_SETTING_SENSOR_ON 0x4
+#define CELL_PAD_CAPABILITY_PS3_CONFORMITY 0x1
+#define CELL_PAD_CAPABILITY_PRESS_MODE 0x2
+#define CELL_PAD_CAPABILITY_SENSOR_MODE 0x4
+#define CELL_PAD_CAPABILITY_HP_ANALOG_STICK 0x8
+#define CELL_PAD_CAPABILITY_ACTUATOR 0x10
+#define CELL_PAD_LDD_INSERT_DATA_INTO_GAME_MODE_ON 1
+
+#define CELL_PAD_BTN_OFFSET_DIGITAL1 2
+#define CELL_PAD_BTN_OFFSET_DIGITAL2 3
+#define CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X 4
+#define CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y 5
+#define CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X 6
+#define CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y 7
+#define CELL_PAD_BTN_OFFSET_PRESS_RIGHT 8
+#define CELL_PAD_BTN_OFFSET_PRESS_LEFT 9
+#define CELL_PAD_BTN_OFFSET_PRESS_UP 10
+#define CELL_PAD_BTN_OFFSET_PRESS_DOWN 11
+#define CELL_PAD_BTN_OFFSET_PRESS_TRIANGLE 12
+#define CELL_PAD_BTN_OFFSET_PRESS_CIRCLE 13
+#define CELL_PAD_BTN_OFFSET_PRESS_CROSS 14
+#define CELL_PAD_BTN_OFFSET_PRESS_SQUARE 15
+#define CELL_PAD_BTN_OFFSET_PRESS_L1 16
+#define CELL_PAD_BTN_OFFSET_PRESS_R1 17
+#define CELL_PAD_BTN_OFFSET_PRESS_L2 18
+#define CELL_PAD_BTN_OFFSET_PRESS_R2 19
+#define CELL_PAD_BTN_OFFSET_SENSOR_X 20
+#define CELL_PAD_BTN_OFFSET_SENSOR_Y 21
+#define CELL_PAD_BTN_OFFSET_SENSOR_Z 22
+#define CELL_PAD_BTN_OFFSET_SENSOR_G 23
+
+#define CELL_PAD_CTRL_LEFT (1 << 7)
+#define CELL_PAD_CTRL_DOWN (1 << 6)
+#define CELL_PAD_CTRL_RIGHT (1 << 5)
+#define CELL_PAD_CTRL_UP (1 << 4)
+#define CELL_PAD_CTRL_START (1 << 3)
+#define CELL_PAD_CTRL_R3 (1 << 2)
+#define CELL_PAD_CTRL_L3 (1 << 1)
+#define CELL_PAD_CTRL_SELECT (1 << 0)
+#define CELL_PAD_CTRL_SQUARE (1 << 7)
+#define CELL_PAD_CTRL_CROSS (1 << 6)
+#define CELL_PAD_CTRL_CIRCLE (1 << 5)
+#define CELL_PAD_CTRL_TRIANGLE (1 << 4)
+#define CELL_PAD_CTRL_R1 (1 << 3)
+#define CELL_PAD_CTRL_L1 (1 << 2)
+#define CELL_PAD_CTRL_R2 (1 << 1)
+#define CELL_PAD_CTRL_L2 (1 << 0)
+#define CELL_PAD_CTRL_LDD_PS (1 << 0)
+
+typedef struct {
+  int32_t len;
+  uint16_t button[CELL_PAD_MAX_CODES];
+} CellPadData;
+
+typedef struct {
+  uint32_t max_connect;
+  uint32_t now_connect;
+  uint32_t system_info;
+  uint32_t port_status[CELL_PAD_MAX_PORT_NUM];
+  uint32_t port_setting[CELL_PAD_MAX_PORT_NUM];
+  uint32_t device_capability[CELL_PAD_MAX_PORT_NUM];
+  uint32_t device_type[CELL_PAD_MAX_PORT_NUM];
+} CellPadInfo2;
+
+int32_t cellPadGetInfo2(CellPadInfo2 *info);
+int32_t cellPadSetPortSetting(uint32_t port_no, uint32_t port_setting);
+int32_t cellPadLddRegisterController(void);
+int32_t cellPadLddUnregisterController(int32_t handle);
+int32_t cellPadLddDataInsert(int32_t handle, CellPadData *data);
+int32_t cellPadLddGetPortNo(int32_t handle);
+
+// libusbd, multi byte descriptor fields are little endian like on the wire
+#define CELL_USBD_PROBE_SUCCEEDED 0
+#define CELL_USBD_PROBE_FAILED -1
+#define CELL_USBD_ATTACH_SUCCEEDED 0
+#define CELL_USBD_ATTACH_FAILED -1
+#define CELL_USBD_DETACH_SUCCEEDED 0
+#define CELL_USBD_DETACH_FAILED -1
+#define HC_CC_NOERR 0
+#define EHCI_CC_XACT 0x10 // transfer cancelled by a detach
+#define USB_DESCRIPTOR_TYPE_DEVICE 0x01
+#define USB_DESCRIPTOR_TYPE_CONFIGURATION 0x02
+#define USB_DESCRIPTOR_TYPE_INTERFACE 0x04
+#define USB_DESCRIPTOR_TYPE_ENDPOINT 0x05
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t bcdUSB;
+  uint8_t bDeviceClass;
+  uint8_t bDeviceSubClass;
+  uint8_t bDeviceProtocol;
+  uint8_t bMaxPacketSize0;
+  uint16_t idVendor;
+  uint16_t idProduct;
+  uint16_t bcdDevice;
+  uint8_t iManufacturer;
+  uint8_t iProduct;
+  uint8_t iSerialNumber;
+  uint8_t bNumConfigurations;
+} __attribute__((__packed__)) UsbDeviceDescriptor;
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t wTotalLength;
+  uint8_t bNumInterfaces;
+  uint8_t bConfigurationValue;
+  uint8_t iConfiguration;
+  uint8_t bmAttributes;
+  uint8_t bMaxPower;
+} __attribute__((__packed__)) UsbConfigurationDescriptor;
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bInterfaceNumber;
+  uint8_t bAlternateSetting;
+  uint8_t bNumEndpoints;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t iInterface;
+} __attribute__((__packed__)) UsbInterfaceDescriptor;
+
+typedef struct {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bEndpointAddress;
+  uint8_t bmAttributes;
+  uint16_t wMaxPacketSize;
+  uint8_t bInterval;
+} __attribute__((__packed__)) UsbEndpointDescriptor;
+
+typedef struct {
+  uint8_t bmRequestType;
+  uint8_t bRequest;
+  uint16_t wValue;
+  uint16_t wIndex;
+  uint16_t wLength;
+} __attribute__((__packed__)) UsbDeviceRequest;
+
+typedef struct {
+  const char *name;
+  int32_t (*probe)(int32_t dev_id);
+  int32_t (*attach)(int32_t dev_id);
+  int32_t (*detach)(int32_t dev_id);
+} CellUsbdLddOps;
+
+typedef void (*CellUsbdDoneCallback)(int32_t result, int32_t count, void *arg);
+
+int32_t cellUsbdRegisterExtraLdd2(CellUsbdLddOps *lddops, uint16_t idVendor, uint16_t idProductMin, uint16_t idProductMax);
+int32_t cellUsbdUnregisterExtraLdd(CellUsbdLddOps *lddops);
+void *cellUsbdScanStaticDescriptor(int32_t dev_id, void *ptr, unsigned char type);
+int32_t cellUsbdOpenPipe(int32_t dev_id, UsbEndpointDescriptor *ed);
+int32_t cellUsbdSetPrivateData(int32_t dev_id, void *priv);
+void *cellUsbdGetPrivateData(int32_t dev_id);
+int32_t cellUsbdSetConfiguration(int32_t pipe_id, uint8_t config, CellUsbdDoneCallback cb, void *arg);
+int32_t cellUsbdSetInterface(int32_t pipe_id, uint8_t ifnum, uint8_t as, CellUsbdDoneCallback cb, void *arg);
+int32_t cellUsbdControlTransfer(int32_t pipe_id, UsbDeviceRequest *req, void *buf, CellUsbdDoneCallback cb, void *arg);
+int32_t cellUsbdInterruptTransfer(int32_t pipe_id, void *buf, int32_t len, CellUsbdDoneCallback cb, void *arg);
+
+/*
+ * Simulation side, used by the tests and benchmarks
+ */
+#define HOST_MAX_DEVICES 16
+#define HOST_MAX_PORTS 8 // virtual pad handles
+
+typedef struct {
+  uint64_t inserts; /* cellPadLddDataInsert calls on this handle */
+  uint64_t last_tb; /* Timebase of the last insert */
+  CellPadData data; /* Last inserted pad data */
+  uint8_t registered;
+} HOST_PAD_t;
+
+extern const char *host_fs_root; /* Directory standing in for the console's root */
+extern volatile uint64_t host_mallocs; /* vsh_malloc calls */
+extern volatile uint64_t host_frees;
+extern HOST_PAD_t host_pad[HOST_MAX_PORTS];
+extern uint32_t host_reg_delay_us; /* Registration handles show up this long after the syscall */
+extern uint8_t host_port_missing; /* cellPadLddGetPortNo fails while set */
+extern uint32_t host_sleep_scale; /* Divides sys_timer_sleep so the xmb wait doesn't stall tests */
+extern char host_last_msg[256]; /* Last vshtask notification */
+extern void (*host_insert_hook)(int32_t handle, const CellPadData *data); /* Sees every pad insert when set */
+
+void *host_malloc(unsigned int size);
+int host_free(void *ptr);
+int host_notify(int unk, const char *msg);
+
+int32_t host_usb_plug(const uint8_t *desc, int32_t len); /* Descriptors from the device one on, returns dev_id or -1 */
+void host_usb_unplug(int32_t dev_id); /* Detach, queued transfers are dropped, finished ones still complete */
+void host_usb_set_control(int32_t dev_id, const uint8_t *data, int32_t len); /* Reply to control reads */
+int32_t host_usb_in(int32_t dev_id, uint8_t ep, const void *data, int32_t len); /* 1 if a transfer was queued to take it */
+int32_t host_usb_in_queued(int32_t dev_id, uint8_t ep); /* Interrupt IN transfers waiting on the endpoint */
+int32_t host_usb_ldds(uint16_t vid, uint16_t pid, CellUsbdLddOps **ops); /* Registrations covering the id, ops of the first */
+int32_t host_usb_out(int32_t dev_id, uint8_t *buf, int32_t max); /* Last out report, its length */
+int32_t host_usb_pump(void); /* Runs every pending completion, returns how many */
+int32_t host_usb_pump_one(void); /* Runs the oldest pending completion */
+int32_t host_usb_pump_newest(void); /* Runs the newest pending completion, out of order like a busy host controller */
+void host_reg_deliver(void); /* Publishes registration handles whose delay has passed */
+int32_t host_fs_put(const char *path, const char *data); /* Writes a file under host_fs_root */
+void host_fs_remove(const char *path);
+
+#endif // __XPAD_HOST_H__
@@ -0,0 +1,2 @@
+// host build stand-in, see host.h
+#include "host.h"
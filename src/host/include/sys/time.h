@@ -0,0 +1,3 @@
+// host build stand-in, the system header plus the lv2 types from host.h
+#include_next <sys/time.h>
+#include "host.h"
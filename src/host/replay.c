@@ -0,0 +1,88 @@
+/*
+ * Replays a capture.bin through the plugin on the host.
+ *
+ *   replay [-t] [-s settings.txt] [-r report_descriptor.bin] capture.bin
+ *
+ * -t keeps the original timing and runs the input thread, otherwise every
+ * report is read as soon as it arrives and the output only depends on the
+ * trace. -s uses a settings file, -r gives the report descriptor for
+ * generic HID devices, which the trace doesn't hold.
+ */
+#include "replay.h"
+
+static uint8_t *load(const char *path, int32_t *len) {
+  FILE *f;
+  uint8_t *buf;
+
+  if ((f = fopen(path, "rb")) == NULL) {
+    return(NULL);
+  }
+  fseek(f, 0, SEEK_END);
+  *len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if ((buf = (uint8_t *)malloc(*len + 1)) != NULL && fread(buf, 1, *len, f) != (size_t)*len) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+  if (buf != NULL) {
+    buf[*len] = 0;
+  }
+  return(buf);
+}
+
+int main(int argc, char **argv) {
+  REPLAY_t r;
+  REPLAY_RESULT_t res;
+  int32_t i, timed = 0, len, k;
+  char *settings = NULL;
+  const char *path = NULL;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0) {
+      timed = 1;
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      if ((settings = (char *)load(argv[++i], &len)) == NULL) {
+        fprintf(stderr, "replay: can't read %s\n", argv[i]);
+        return(2);
+      }
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      if ((replay_hid_desc = load(argv[++i], &replay_hid_len)) == NULL || replay_hid_len > HID_DESC_MAX) {
+        fprintf(stderr, "replay: can't use %s\n", argv[i]);
+        return(2);
+      }
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == NULL) {
+    fprintf(stderr, "usage: replay [-t] [-s settings.txt] [-r report_descriptor.bin] capture.bin\n");
+    return(2);
+  }
+  if (replay_open(&r, path) < 0) {
+    fprintf(stderr, "replay: %s is not a capture file\n", path);
+    return(2);
+  }
+  host_setup(settings);
+  host_fs_put(DEVICES_FILE, replay_devices);
+  if (timed ? host_start() < 0 : init_usb() != CELL_OK) {
+    fprintf(stderr, "replay: plugin did not start\n");
+    return(1);
+  }
+  k = replay_run(&r, &res, timed);
+  if (timed) {
+    host_stop();
+  } else {
+    host_teardown();
+  }
+  printf("%u records, %u not played%s\n", res.records, res.unplayed, (k < 0) ? ", trace cut short" : "");
+  for (i = 0; i < HOST_MAX_PORTS; i++) {
+    if (res.inserts[i] > 0) {
+      printf("pad %d: %u inserts, digest %016llx\n", i, res.inserts[i], (unsigned long long)res.digest[i]);
+    }
+  }
+  printf("%u skipped, %u dropped, %u unchanged\n", res.skipped, res.dropped, res.suppressed);
+  replay_close(&r);
+  host_rmroot();
+  return(0);
+}
@@ -0,0 +1,282 @@
+/*
+ * Capture trace reader and replay driver. Records are fed back through the
+ * simulated usb bus, so each one reaches data_transfer_done like it did on
+ * the console. Without timing the reports are read right after each record
+ * on the calling thread and the result only depends on the trace, with
+ * timing the input thread runs and the original gaps between records are
+ * kept so skipped and dropped reports and latency show up as they did.
+ */
+#ifndef __XPAD_REPLAY_H__
+#define __XPAD_REPLAY_H__
+
+#include "harness.h"
+
+#define REPLAY_DEVICES 8
+
+typedef struct {
+  uint64_t tb; /* Timebase from the start of the capture */
+  uint32_t dev_id;
+  uint8_t ifnum;
+  uint8_t xtype;
+  uint8_t count;
+  const uint8_t *payload;
+} REPLAY_RECORD_t;
+
+typedef struct {
+  uint8_t *buf;
+  size_t len;
+  size_t pos;
+  uint64_t freq; /* Timebase frequency of the console that captured */
+  uint64_t tb;
+} REPLAY_t;
+
+typedef struct {
+  uint32_t dev_id; /* Device id in the trace */
+  uint8_t xtype;
+  int32_t sim_id; /* Device id on the simulated bus */
+} REPLAY_DEVICE_t;
+
+typedef struct {
+  uint32_t records;
+  uint32_t unplayed; /* Records of devices that could not be plugged */
+  uint32_t skipped; /* Reports replaced in a unit's latest report slot before being read */
+  uint32_t dropped; /* Reports lost to a full queue */
+  uint32_t suppressed; /* Reports that left the pad data unchanged */
+  uint32_t inserts[HOST_MAX_PORTS];
+  uint64_t digest[HOST_MAX_PORTS]; /* FNV-1a over every inserted pad data */
+} REPLAY_RESULT_t;
+
+static REPLAY_RESULT_t *replay_result;
+
+// stand-ins the built in device table doesn't list, put in xpad_devices.txt before init_usb
+static const char replay_devices[] =
+  "0x054c, 0x0268, Replay DualShock 3, PTYPE_PS3\n"
+  "0x054c, 0x05c4, Replay DualShock 4, PTYPE_PS4\n"
+  "0x0079, 0x0006, Replay HID, XTYPE_HID\n";
+static unsigned char replay_settle_buf[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+static const uint8_t *replay_hid_desc; /* Report descriptor for XTYPE_HID devices */
+static int32_t replay_hid_len;
+
+static int32_t replay_open(REPLAY_t *r, const char *path) {
+  FILE *f;
+  long len;
+  uint32_t i;
+
+  memset(r, 0, sizeof(REPLAY_t));
+  if ((f = fopen(path, "rb")) == NULL) {
+    return(-1);
+  }
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (len < 13 || (r->buf = (uint8_t *)malloc(len)) == NULL || fread(r->buf, 1, len, f) != (size_t)len) {
+    fclose(f);
+    free(r->buf);
+    r->buf = NULL;
+    return(-1);
+  }
+  fclose(f);
+  r->len = len;
+  if (((uint32_t)r->buf[0] << 24 | r->buf[1] << 16 | r->buf[2] << 8 | r->buf[3]) != CAPTURE_MAGIC || r->buf[4] != CAPTURE_VERSION) {
+    free(r->buf);
+    r->buf = NULL;
+    return(-1);
+  }
+  for (i = 0; i < 8; i++) {
+    r->freq = (r->freq << 8) | r->buf[5 + i];
+  }
+  r->pos = 13;
+  return(0);
+}
+
+static void replay_close(REPLAY_t *r) {
+  free(r->buf);
+  r->buf = NULL;
+}
+
+static int32_t replay_varint(REPLAY_t *r, uint64_t *v) {
+  uint32_t shift = 0;
+
+  *v = 0;
+  while (r->pos < r->len && shift < 64) {
+    *v |= (uint64_t)(r->buf[r->pos] & 0x7F) << shift;
+    if (!(r->buf[r->pos++] & 0x80)) {
+      return(0);
+    }
+    shift += 7;
+  }
+  return(-1);
+}
+
+// 1 for a record, 0 at the end of the trace, -1 if it is cut short
+static int32_t replay_next(REPLAY_t *r, REPLAY_RECORD_t *rec) {
+  uint64_t delta, dev_id;
+
+  if (r->pos == r->len) {
+    return(0);
+  }
+  if (replay_varint(r, &delta) < 0 || replay_varint(r, &dev_id) < 0 || r->pos + 3 > r->len) {
+    return(-1);
+  }
+  r->tb += delta;
+  rec->tb = r->tb;
+  rec->dev_id = (uint32_t)dev_id;
+  rec->ifnum = r->buf[r->pos++];
+  rec->xtype = r->buf[r->pos++];
+  rec->count = r->buf[r->pos++];
+  if (r->pos + rec->count > r->len) {
+    return(-1);
+  }
+  rec->payload = r->buf + r->pos;
+  r->pos += rec->count;
+  return(1);
+}
+
+static void replay_insert(int32_t h, const CellPadData *data) {
+  uint64_t d;
+  uint32_t i;
+
+  // only the fields the plugin sets, in a fixed byte order
+  d = replay_result->digest[h];
+  for (i = 0; i <= CELL_PAD_BTN_OFFSET_SENSOR_G; i++) {
+    d = (d ^ (data->button[i] & 0xFF)) * 0x100000001B3ULL;
+    d = (d ^ (data->button[i] >> 8)) * 0x100000001B3ULL;
+  }
+  replay_result->digest[h] = d;
+  replay_result->inserts[h]++;
+}
+
+static int32_t replay_plug(REPLAY_DEVICE_t *d) {
+  uint8_t desc[256];
+  int32_t len;
+
+  // the trace has no descriptors, a known device of the same type stands in
+  switch (d->xtype) {
+  case XTYPE_XBOX360:
+    d->sim_id = host_plug_xbox360(4);
+    break;
+  case XTYPE_XBOX360W:
+    d->sim_id = host_usb_plug(desc, host_desc_receiver(desc, 0x0719));
+    host_usb_pump();
+    break;
+  case PTYPE_PS3:
+  case PTYPE_PS4:
+    len = host_desc_hid(desc, 0x054c, (d->xtype == PTYPE_PS3) ? 0x0268 : 0x05c4, 148, 64, 1);
+    d->sim_id = host_usb_plug(desc, len);
+    host_usb_pump();
+    break;
+  case XTYPE_HID:
+    if (replay_hid_desc == NULL) {
+      return(-1);
+    }
+    len = host_desc_hid(desc, 0x0079, 0x0006, replay_hid_len, 64, 4);
+    d->sim_id = host_usb_plug(desc, len);
+    host_usb_set_control(d->sim_id, replay_hid_desc, replay_hid_len);
+    host_usb_pump();
+    break;
+  default:
+    return(-1);
+  }
+  return((d->sim_id > 0 && host_usb_in_queued(d->sim_id, 0x81) > 0) ? 0 : -1);
+}
+
+static void replay_settle(void) {
+  uint32_t bits;
+  int32_t i;
+
+  // registrations finish and queued reports are read on this thread
+  xpadw_links();
+  bits = XPAD.connected;
+  while (bits) {
+    i = slot_next(&bits);
+    if (reg_state[i] != REG_READY) {
+      host_register(i);
+    }
+    while (reg_state[i] == REG_READY && XPAD.con_unit[i]->read_input(i, replay_settle_buf) > 0);
+  }
+}
+
+// feeds a whole trace, timed keeps the gaps and lets the input thread read
+static int32_t replay_run(REPLAY_t *r, REPLAY_RESULT_t *res, int32_t timed) {
+  REPLAY_DEVICE_t dev[REPLAY_DEVICES];
+  REPLAY_RECORD_t rec;
+  int32_t ndev = 0, i, k;
+  uint64_t start, first = 0, at;
+  uint32_t bits;
+  XPAD_UNIT_t *unit;
+
+  memset(res, 0, sizeof(REPLAY_RESULT_t));
+  for (i = 0; i < HOST_MAX_PORTS; i++) {
+    res->digest[i] = 0xCBF29CE484222325ULL;
+  }
+  replay_result = res;
+  host_insert_hook = replay_insert;
+  start = host_now_ns();
+  while ((k = replay_next(r, &rec)) > 0) {
+    if (res->records++ == 0) {
+      first = rec.tb;
+    }
+    for (i = 0; i < ndev && dev[i].dev_id != rec.dev_id; i++);
+    if (i == ndev) {
+      if (ndev == REPLAY_DEVICES) {
+        res->unplayed++;
+        continue;
+      }
+      dev[ndev].dev_id = rec.dev_id;
+      dev[ndev].xtype = rec.xtype;
+      if (replay_plug(&dev[ndev]) < 0) {
+        dev[ndev].sim_id = -1;
+      }
+      ndev++;
+      if (timed) {
+        HOST_WAIT(reg_pending == 0, REG_TIMEOUT);
+      } else {
+        replay_settle();
+      }
+    }
+    if (dev[i].sim_id < 0) {
+      res->unplayed++;
+      continue;
+    }
+    if (timed) {
+      at = rec.tb - first;
+      at = start + (at / r->freq) * 1000000000ULL + (at % r->freq) * 1000000000ULL / r->freq;
+      while (host_now_ns() < at) {
+        usleep((at - host_now_ns() > 2000000) ? 1000 : 50);
+      }
+    }
+
+    // wireless endpoints take ifnum 0, 2, 4, 6
+    host_usb_in(dev[i].sim_id, 0x81 + rec.ifnum, rec.payload, rec.count);
+    host_usb_pump();
+    if (!timed) {
+      replay_settle();
+    }
+  }
+  if (timed) {
+    usleep(1000 * POLL_IDLE_MAX + 10000);
+  }
+
+  // counters of the units still connected, before they go away
+  bits = XPAD.connected;
+  while (bits) {
+    i = slot_next(&bits);
+    if ((unit = XPAD.con_unit[i]) != NULL) {
+      res->skipped += unit->skipped;
+      res->dropped += unit->dropped;
+    }
+  }
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    res->suppressed += stats.inserts_suppressed[i];
+  }
+  for (i = 0; i < ndev; i++) {
+    if (dev[i].sim_id > 0) {
+      host_usb_unplug(dev[i].sim_id);
+    }
+  }
+  host_usb_pump();
+  host_insert_hook = NULL;
+  return(k);
+}
+
+#endif // __XPAD_REPLAY_H__
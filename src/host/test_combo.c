@@ -0,0 +1,67 @@
+/*
+ * Combos: PS is held back from the pad data while PS + R3 or PS + START
+ * is held and after it until PS is released, the other buttons go through.
+ */
+#include "harness.h"
+
+static uint16_t *pad_after(int32_t dev_id, int32_t n, uint16_t buttons) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[HOST_REPORT_LEN];
+
+  host_report(r, buttons, 0, 0, 0, 0, 0, 0);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  XPAD.con_unit[n]->read_input(n, data);
+  return(host_pad[handle[n]].data.button);
+}
+
+int main(void) {
+  int32_t dev_id, n;
+  uint16_t *b;
+
+  host_setup("insert_keepalive = 0\n");
+  CHECK(init_usb() == CELL_OK);
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  host_register(n);
+  CHECK(reg_state[n] == REG_READY);
+  if (reg_state[n] != REG_READY) {
+    return(host_finish("test_combo"));
+  }
+
+  // PS alone reaches the game
+  b = pad_after(dev_id, n, btnXbox);
+  CHECK(b[0] == CELL_PAD_CTRL_LDD_PS);
+
+  // PS + START asks for the stats once, START still goes through
+  b = pad_after(dev_id, n, btnXbox | btnStart);
+  CHECK(b[0] == 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL1] == CELL_PAD_CTRL_START);
+  CHECK(stats_pending == 1);
+  stats_pending = 0;
+  b = pad_after(dev_id, n, btnXbox | btnStart);
+  CHECK(b[0] == 0);
+  CHECK(stats_pending == 0);
+
+  // START released first, PS stays back until it is released too
+  b = pad_after(dev_id, n, btnXbox);
+  CHECK(b[0] == 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL1] == 0);
+  b = pad_after(dev_id, n, 0);
+  CHECK(b[0] == 0);
+  b = pad_after(dev_id, n, btnXbox);
+  CHECK(b[0] == CELL_PAD_CTRL_LDD_PS);
+
+  // PS + R3 moves to the next remap profile without PS
+  b = pad_after(dev_id, n, btnXbox | btnHatRight);
+  CHECK(b[0] == 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL1] == CELL_PAD_CTRL_R3);
+  CHECK(pad_image[n].combo == (COMBO_REMAP | COMBO_PS));
+  b = pad_after(dev_id, n, btnHatRight);
+  CHECK(b[0] == 0);
+  CHECK(pad_image[n].combo == 0);
+
+  host_usb_unplug(dev_id);
+  host_teardown();
+  return(host_finish("test_combo"));
+}
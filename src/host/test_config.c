@@ -0,0 +1,156 @@
+/*
+ * Config file reader: tokens, numbers, settings lines, and whole files
+ * read in chunks with lines split across them, comments, CRLF and errors,
+ * device lines and remap lines.
+ */
+#include "harness.h"
+
+static int32_t lines;
+static char last[CONFIG_LINE];
+
+static const char *count_line(char *line) {
+  lines++;
+  strcpy(last, line);
+  return((strcmp(line, "bad") == 0) ? "bad line" : NULL);
+}
+
+int main(void) {
+  static char big[CONFIG_CHUNK * 4];
+  char buf[64], *line, *t;
+  uint32_t v, i;
+
+  // tokens are split in place and trimmed, the rest of the line is kept
+  strcpy(buf, "  0x045e , 0x028e,\tpad name \t,TYPE\r");
+  line = buf;
+  CHECK(strcmp(next_token(&line, ','), "0x045e") == 0);
+  CHECK(strcmp(next_token(&line, ','), "0x028e") == 0);
+  CHECK(strcmp(next_token(&line, ','), "pad name") == 0);
+  CHECK(strcmp(next_token(&line, ','), "TYPE") == 0);
+  t = next_token(&line, ',');
+  CHECK(t[0] == 0);
+
+  // decimal and hex, nothing else and nothing that overflows
+  CHECK(parse_number("0", &v) == 0 && v == 0);
+  CHECK(parse_number("4294967295", &v) == 0 && v == 0xFFFFFFFF);
+  CHECK(parse_number("0xFFFFFFFF", &v) == 0 && v == 0xFFFFFFFF);
+  CHECK(parse_number("0XaBc", &v) == 0 && v == 0xABC);
+  CHECK(parse_number("4294967296", &v) < 0);
+  CHECK(parse_number("0x100000000", &v) < 0);
+  CHECK(parse_number("", &v) < 0);
+  CHECK(parse_number("0x", &v) < 0);
+  CHECK(parse_number("12a", &v) < 0);
+  CHECK(parse_number("-1", &v) < 0);
+
+  // settings, with comments and blank lines
+  host_setup("# comment\n\ninput_mode = poll # trailing\r\ninsert_keepalive=250\n  stick_curve = 2\n");
+  config_errors = 0;
+  CHECK(config_read(SETTINGS_FILE, settings_parse_line) == CELL_OK);
+  CHECK(input_mode == INPUT_MODE_POLL);
+  CHECK(insert_keepalive == 250);
+  CHECK(analog.curve == 2);
+  CHECK(config_errors == 0);
+
+  // only the first error is kept, with its file and line
+  host_fs_put(SETTINGS_FILE, "input_mode = event\nstick_curve = 9\nnot_a_setting = 1\n");
+  CHECK(config_read(SETTINGS_FILE, settings_parse_line) < 0);
+  CHECK(config_errors == 2);
+  CHECK(strcmp(config_msg, "xpad_settings.txt line 2: stick_curve must be 1 (linear), 2 or 3") == 0);
+  CHECK(input_mode == INPUT_MODE_EVENT);
+  CHECK(analog.curve == 2);
+  CHECK(config_read("/dev_hdd0/xpad/missing.txt", settings_parse_line) < 0);
+  CHECK(config_errors == 2);
+
+  // lines across chunk boundaries, the last one without a newline
+  t = big;
+  for (i = 0; i < 200; i++) {
+    t += sprintf(t, "line %u\n", i);
+  }
+  strcpy(t, "end");
+  host_fs_put(SETTINGS_FILE, big);
+  lines = 0;
+  config_errors = 0;
+  CHECK(config_read(SETTINGS_FILE, count_line) == CELL_OK);
+  CHECK(lines == 201);
+  CHECK(strcmp(last, "end") == 0);
+
+  // a line longer than the buffer is reported and skipped, the next one still read
+  memset(big, 'x', CONFIG_LINE + 10);
+  strcpy(big + CONFIG_LINE + 10, "\nbad\nok\n");
+  host_fs_put(SETTINGS_FILE, big);
+  lines = 0;
+  config_errors = 0;
+  CHECK(config_read(SETTINGS_FILE, count_line) < 0);
+  CHECK(lines == 2);
+  CHECK(strcmp(last, "ok") == 0);
+  CHECK(config_errors == 2);
+  CHECK(strcmp(config_msg, "xpad_settings.txt line 1: line too long") == 0);
+
+  // device lines
+  strcpy(buf, "0x1234, 0x5678, Name, XTYPE_XBOX360, REPORT_MODE_QUEUE");
+  CHECK(device_parse_line(buf) == NULL);
+  CHECK(device_lookup(0x1234, 0x5678) != NULL && device_lookup(0x1234, 0x5678)->rmode == REPORT_MODE_QUEUE);
+  strcpy(buf, "0x12345, 0x5678, Name, XTYPE_XBOX360");
+  CHECK(strcmp(device_parse_line(buf), "bad vendor id") == 0);
+  strcpy(buf, "0x1234, 0x5679, Name, XTYPE_NONE");
+  CHECK(strcmp(device_parse_line(buf), "unknown type") == 0);
+  strcpy(buf, "0x1234, 0x5679, Name, XTYPE_XBOX360, REPORT_MODE_ALL");
+  CHECK(strcmp(device_parse_line(buf), "unknown report mode") == 0);
+  strcpy(buf, "  # 0x1234, 0x5679");
+  CHECK(device_parse_line(buf) == NULL);
+
+  // remap lines, a profile starts out as the pad's own layout
+  remap_loading = 0;
+  strcpy(buf, "CROSS = CIRCLE");
+  CHECK(strcmp(remap_parse_line(buf), "mapping before the first remap_setting") == 0);
+  strcpy(buf, "remap_setting = 0");
+  CHECK(strcmp(remap_parse_line(buf), "remap_setting must be 1 to 10") == 0);
+  strcpy(buf, "remap_setting = 11");
+  CHECK(strcmp(remap_parse_line(buf), "remap_setting must be 1 to 10") == 0);
+  strcpy(buf, "remap_setting = 3 # swaps");
+  CHECK(remap_parse_line(buf) == NULL);
+  CHECK(remap_loading == 3 && remap_listed[2] == 1);
+  CHECK(remap_target[2][14] == remap_names[14].mask && remap_axis[2][1] == 1);
+
+  // the first line for a source replaces its button, the next ones add to it
+  strcpy(buf, "CROSS = CIRCLE");
+  CHECK(remap_parse_line(buf) == NULL);
+  strcpy(buf, "CROSS=SQUARE");
+  CHECK(remap_parse_line(buf) == NULL);
+  CHECK(remap_target[2][14] == (remap_names[13].mask | remap_names[15].mask));
+  strcpy(buf, "SELECT = NONE");
+  CHECK(remap_parse_line(buf) == NULL);
+  CHECK(remap_target[2][0] == 0);
+  strcpy(buf, "LY = -RY");
+  CHECK(remap_parse_line(buf) == NULL);
+  CHECK(remap_axis[2][3] == (1 | REMAP_INVERT));
+  strcpy(buf, "   # CROSS = NOPE");
+  CHECK(remap_parse_line(buf) == NULL);
+
+  strcpy(buf, "CROSS = -CIRCLE");
+  CHECK(strcmp(remap_parse_line(buf), "only sticks can be inverted") == 0);
+  strcpy(buf, "LX = CROSS");
+  CHECK(strcmp(remap_parse_line(buf), "sticks only map to sticks") == 0);
+  strcpy(buf, "CROSS = RX");
+  CHECK(strcmp(remap_parse_line(buf), "sticks only map to sticks") == 0);
+  strcpy(buf, "X = CROSS");
+  CHECK(strcmp(remap_parse_line(buf), "unknown source button") == 0);
+  strcpy(buf, "CROSS = X");
+  CHECK(strcmp(remap_parse_line(buf), "unknown target button") == 0);
+
+  // remap file errors carry their line, the good profiles still load
+  host_fs_put(REMAP_FILE, "# swap face buttons\nremap_setting = 1\nCROSS = CIRCLE\nCIRCLE = CROSS\r\nL1 = L4\nremap_setting = 12\nSTART = SELECT\n");
+  config_errors = 0;
+  remap_load();
+  CHECK(config_errors == 2);
+  CHECK(strcmp(config_msg, "xpad_remap.txt line 5: unknown target button") == 0);
+  CHECK(remap_profile[0] != NULL && remap_profile[1] == NULL);
+  remap_free();
+  host_fs_put(REMAP_FILE, "\n\n\nLX = RX\n");
+  config_errors = 0;
+  remap_load();
+  CHECK(config_errors == 1);
+  CHECK(strcmp(config_msg, "xpad_remap.txt line 4: mapping before the first remap_setting") == 0);
+  remap_free();
+  host_rmroot();
+  return(host_finish("test_config"));
+}
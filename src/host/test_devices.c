@@ -0,0 +1,46 @@
+/*
+ * Device registration: every product id in the table is covered by one
+ * registration of its own driver, ranges are split around the ids of other
+ * drivers from the same vendor.
+ */
+#include "harness.h"
+
+int main(void) {
+  uint32_t i;
+  uint16_t vid, pid;
+  CellUsbdLddOps *ops;
+
+  // a wireless receiver and a HID pad in between wired pads, HID types share a driver
+  host_setup(NULL);
+  host_fs_put(DEVICES_FILE,
+    "0x1234, 0x0001, Wired, XTYPE_XBOX360\n"
+    "0x1234, 0x0005, Receiver, XTYPE_XBOX360W\n"
+    "0x1234, 0x0009, Wired, XTYPE_XBOX360\n"
+    "0x1234, 0x000a, Generic, XTYPE_HID\n"
+    "0x1234, 0x0010, Wired, XTYPE_XBOX360\n"
+    "0x1234, 0x0014, Wired, XTYPE_XBOX360\n"
+    "0x1234, 0x0020, Sony, PTYPE_PS3\n"
+    "0x1234, 0x0021, Receiver, XTYPE_XBOX360W\n"
+    "0x1234, 0x0030, Sony, PTYPE_PS4\n"
+    "0x1234, 0x0040, Generic, XTYPE_HID\n");
+  CHECK(init_usb() == CELL_OK);
+  CHECK(config_errors == 0);
+  for (i = 0; i < DEVICE_TABLE_SIZE; i++) {
+    if (device_table[i].key == 0 || device_ops(device_table[i].type) == NULL) {
+      continue;
+    }
+    vid = device_table[i].key >> 16;
+    pid = device_table[i].key & 0xFFFF;
+    CHECK(host_usb_ldds(vid, pid, &ops) == 1);
+    CHECK(ops == device_ops(device_table[i].type));
+  }
+
+  // neighbours of one driver still share a registration
+  CHECK(host_usb_ldds(0x1234, 0x0002, &ops) == 0);
+  CHECK(host_usb_ldds(0x1234, 0x0012, &ops) == 1 && ops == &xpad_ops);
+  CHECK(host_usb_ldds(0x1234, 0x0035, &ops) == 1 && ops == &hid_ops);
+  CHECK(host_usb_ldds(0x1234, 0x000f, &ops) == 0);
+  CHECK(host_usb_ldds(0x1234, 0x0041, &ops) == 0);
+  host_teardown();
+  return(host_finish("test_devices"));
+}
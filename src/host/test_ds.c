@@ -0,0 +1,67 @@
+/*
+ * DualShock 4 motion sensors: 1 g and 90 deg/s in DualShock 4 counts come
+ * out as the sixaxis counts pad data uses, 113 per g and 123 per 90 deg/s.
+ */
+#include "harness.h"
+
+static void put16(uint8_t *p, int16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (uint16_t)v >> 8;
+}
+
+static uint16_t *pad_after(int32_t dev_id, int32_t n, int16_t ax, int16_t gy) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[64];
+
+  memset(r, 0, sizeof(r));
+  r[0] = 0x01;
+  r[1] = r[2] = r[3] = r[4] = 0x80;
+  r[5] = 0x08;
+  put16(r + 15, gy);
+  put16(r + 19, ax);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  XPAD.con_unit[n]->read_input(n, data);
+  return(host_pad[handle[n]].data.button);
+}
+
+static int32_t near(uint16_t v, int32_t expect) {
+  return(v + 1 >= expect && v <= expect + 1);
+}
+
+int main(void) {
+  uint8_t desc[64];
+  int32_t dev_id, n;
+  uint16_t *b;
+
+  host_setup("insert_keepalive = 0\n");
+  host_fs_put(DEVICES_FILE, "0x054c, 0x05c4, Sony Playstation DualShock 4, PTYPE_PS4\n");
+  CHECK(init_usb() == CELL_OK);
+  dev_id = host_usb_plug(desc, host_desc_hid(desc, 0x054c, 0x05c4, 400, 64, 4));
+  host_usb_pump();
+  n = host_number(dev_id);
+  CHECK(n >= 0);
+  if (n < 0) {
+    return(host_finish("test_ds"));
+  }
+  host_register(n);
+  CHECK(reg_state[n] == REG_READY);
+
+  // at rest everything sits on the center, the sensors are inverted
+  b = pad_after(dev_id, n, 0, 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_SENSOR_X] == 0x200 && b[CELL_PAD_BTN_OFFSET_SENSOR_G] == 0x200);
+  b = pad_after(dev_id, n, 8192, 0);
+  CHECK(near(b[CELL_PAD_BTN_OFFSET_SENSOR_X], 0x200 - 113));
+  b = pad_after(dev_id, n, -8192, 1475);
+  CHECK(near(b[CELL_PAD_BTN_OFFSET_SENSOR_X], 0x200 + 113));
+  CHECK(near(b[CELL_PAD_BTN_OFFSET_SENSOR_G], 0x200 - 123));
+
+  // 4 g full scale fits the 10 bit range, 2000 deg/s is clamped
+  b = pad_after(dev_id, n, -32768, -32768);
+  CHECK(near(b[CELL_PAD_BTN_OFFSET_SENSOR_X], 0x200 + 4 * 113));
+  CHECK(b[CELL_PAD_BTN_OFFSET_SENSOR_G] == 0x3FF);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_teardown();
+  return(host_finish("test_ds"));
+}
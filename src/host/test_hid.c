@@ -0,0 +1,181 @@
+/*
+ * Generic HID pads: a report descriptor compiles to a plan that decodes
+ * reports, one that maps to nothing gives its unit and slot back, and a
+ * pad unplugged before its descriptor arrives is left alone. The
+ * descriptors of real pads compile to the fields their reports hold.
+ */
+#include "harness.h"
+#include "hid_corpus.h"
+
+// 16 buttons and X, Y, Z, Rz as bytes, no report id
+static const uint8_t gamepad[] = {
+  0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x10, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x10, 0x81, 0x02,
+  0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02,
+  0xC0
+};
+
+// 4 bits of padding then 8 buttons, the buttons end in the second byte
+static const uint8_t padded[] = {
+  0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+  0x75, 0x04, 0x95, 0x01, 0x81, 0x01,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x08, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+  0xC0
+};
+
+// a vendor page only
+static const uint8_t vendor[] = {
+  0x06, 0x00, 0xFF, 0x09, 0x01, 0xA1, 0x01,
+  0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x08, 0x09, 0x01, 0x81, 0x02,
+  0xC0
+};
+
+static int32_t plug_hid(const uint8_t *rdesc, int32_t len, uint16_t payload, int32_t pump) {
+  uint8_t desc[64];
+  int32_t dev_id;
+
+  dev_id = host_usb_plug(desc, host_desc_hid(desc, 0x0079, 0x0006, len, payload, 4));
+  host_usb_set_control(dev_id, rdesc, len);
+  if (pump) {
+    host_usb_pump();
+  }
+  return(dev_id);
+}
+
+static void set_bits(uint8_t *r, uint32_t bit, uint32_t size, uint32_t v) {
+  uint32_t i;
+
+  for (i = 0; i < size; i++, bit++) {
+    r[bit >> 3] = (r[bit >> 3] & ~(1 << (bit & 7))) | (((v >> i) & 1) << (bit & 7));
+  }
+}
+
+// compiles a real pad's descriptor and sends it a report with cross, right and the left stick right and up
+static void corpus_check(const HID_CORPUS_t *c) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[MAX_XPAD_PAYLOAD], *p;
+  int32_t dev_id, n, i, hats = 0, buttons = -1, ok;
+  uint16_t *b;
+  HID_PLAN_t plan;
+
+  ok = hid_compile(&plan, c->desc, c->len) > 0;
+  CHECK(ok);
+  CHECK(plan.report_id == c->report_id);
+  CHECK((plan.axes & 0x0F) == 0x0F);
+  CHECK(plan.len > 0 && plan.len <= c->report_len);
+  for (i = 0; i < plan.n; i++) {
+    hats += (plan.field[i].op == HID_OP_HAT);
+    if (plan.field[i].op == HID_OP_BUTTONS && buttons < 0) {
+      buttons = plan.field[i].byte * 8 + plan.field[i].shift;
+    }
+  }
+  CHECK(hats == (c->hat_bit != 0xFFFF));
+  CHECK(buttons == c->button_bit);
+  if (!ok) {
+    fprintf(stderr, "%s: no plan\n", c->name);
+    return;
+  }
+
+  dev_id = plug_hid(c->desc, c->len, 64, 1);
+  n = host_number(dev_id);
+  CHECK(n >= 0 && (XPAD.connected & (1 << n)));
+  if (n < 0 || !(XPAD.connected & (1 << n))) {
+    host_usb_unplug(dev_id);
+    host_usb_pump();
+    return;
+  }
+  host_register(n);
+  memset(r, 0, sizeof(r));
+  r[0] = c->report_id;
+  p = r + (c->report_id != 0);
+  for (i = 0; i < 4; i++) {
+    p[c->axis_byte[i]] = 0x80;
+  }
+  p[c->axis_byte[0]] = 0xFF;
+  p[c->axis_byte[1]] = 0x00;
+  set_bits(p, c->button_bit + 1, 1, 1);
+  if (c->hat_bit != 0xFFFF) {
+    set_bits(p, c->hat_bit, 4, 2);
+  }
+  host_usb_in(dev_id, 0x81, r, c->report_len + (c->report_id != 0));
+  host_usb_pump();
+  CHECK(XPAD.con_unit[n]->read_input(n, data) > 0);
+  b = host_pad[handle[n]].data.button;
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CROSS);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL1] == ((c->hat_bit != 0xFFFF) ? CELL_PAD_CTRL_RIGHT : 0));
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] == 0xFF);
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] == 0x00);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+}
+
+int main(void) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[6] = {0x02, 0x00, 0xFF, 0x00, 0x80, 0x80};
+  int32_t dev_id, n, i;
+  uint16_t *b;
+  HID_PLAN_t plan;
+
+  // merged buttons count toward the report length
+  CHECK(hid_compile(&plan, padded, sizeof(padded)) > 0);
+  CHECK(plan.n == 1 && plan.field[0].size == 8 && plan.len == 2);
+  CHECK(hid_compile(&plan, gamepad, sizeof(gamepad)) > 0);
+  CHECK(plan.n == 6 && plan.len == 6);
+
+  host_setup("insert_keepalive = 0\n");
+  host_fs_put(DEVICES_FILE, "0x0079, 0x0006, Generic, XTYPE_HID\n");
+  CHECK(init_usb() == CELL_OK);
+
+  // buttons and axes reach the pad
+  dev_id = plug_hid(gamepad, sizeof(gamepad), 8, 1);
+  n = host_number(dev_id);
+  CHECK(n >= 0 && hid_plan[n].n > 0);
+  CHECK(n >= 0 && (XPAD.connected & (1 << n)));
+  if (n >= 0 && (XPAD.connected & (1 << n))) {
+    host_register(n);
+    host_usb_in(dev_id, 0x81, r, sizeof(r));
+    host_usb_pump();
+    CHECK(XPAD.con_unit[n]->read_input(n, data) > 0);
+    b = host_pad[handle[n]].data.button;
+    CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CROSS);
+    CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] == 0xFF);
+    CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] == 0x00);
+
+    // a short report is not decoded
+    r[2] = 0x00;
+    host_usb_in(dev_id, 0x81, r, 5);
+    host_usb_pump();
+    CHECK(XPAD.con_unit[n]->read_input(n, data) > 0);
+    CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CROSS);
+  }
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  CHECK(stats.units_in_use == 0 && XPAD.n == 0);
+
+  // nothing to map, the unit and slot go back at once and detach finds nothing
+  dev_id = plug_hid(vendor, sizeof(vendor), 8, 1);
+  CHECK(stats.hid_failed == 1);
+  CHECK(cellUsbdGetPrivateData(dev_id) == NULL);
+  CHECK(stats.units_in_use == 0 && XPAD.n == 0 && XPAD.connected == 0);
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    CHECK(XPAD.con_unit[i] == NULL);
+  }
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+
+  // unplugged with the descriptor fetch still to complete
+  dev_id = plug_hid(gamepad, sizeof(gamepad), 8, 0);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  CHECK(stats.hid_failed == 1);
+  CHECK(stats.units_in_use == 0 && XPAD.n == 0 && XPAD.connected == 0);
+
+  // pads as they come
+  for (i = 0; i < (int32_t)HID_CORPUS_SIZE; i++) {
+    corpus_check(&hid_corpus[i]);
+  }
+  CHECK(stats.units_in_use == 0 && XPAD.n == 0);
+
+  host_teardown();
+  return(host_finish("test_hid"));
+}
@@ -0,0 +1,76 @@
+/*
+ * Latency simulation for the input thread: a wired pad sends a changing
+ * report every few ms and the time from the usb completion to the pad
+ * insert is measured in event mode and in poll mode.
+ */
+#include "harness.h"
+
+#define LATENCY_REPORTS 200
+#define LATENCY_GAP_US 3000
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return((x > y) - (x < y));
+}
+
+// returns the median latency in us, 0 if a report never reached the pad
+static uint64_t run(const char *settings, const char *name) {
+  static uint64_t lat[LATENCY_REPORTS];
+  uint8_t r[HOST_REPORT_LEN];
+  uint64_t t0, inserts;
+  int32_t dev_id, n, h, i, lost = 0;
+
+  host_setup(settings);
+  if (host_start() < 0) {
+    fprintf(stderr, "%s: input thread did not start\n", name);
+    return(0);
+  }
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  HOST_WAIT(reg_state[n] == REG_READY, 1000);
+  CHECK(reg_state[n] == REG_READY);
+  if ((h = handle[n]) < 0) {
+    host_usb_unplug(dev_id);
+    host_stop();
+    return(0);
+  }
+
+  // each report differs from the last so every one is inserted
+  for (i = 0; i < LATENCY_REPORTS; i++) {
+    host_report(r, 0, 0, 0, (int16_t)(i * 4099), 0, 0, 0);
+    inserts = host_pad[h].inserts;
+    t0 = __mftb();
+    host_usb_in(dev_id, 0x81, r, sizeof(r));
+    host_usb_pump();
+    HOST_WAIT(__atomic_load_n(&host_pad[h].inserts, __ATOMIC_ACQUIRE) != inserts, 100);
+    if (host_pad[h].inserts == inserts) {
+      lost++;
+      lat[i] = 100000;
+    } else {
+      lat[i] = (host_pad[h].last_tb - t0) * 1000000 / HOST_TIMEBASE;
+    }
+    usleep(LATENCY_GAP_US);
+  }
+  qsort(lat, LATENCY_REPORTS, sizeof(lat[0]), cmp_u64);
+  printf("%-6s p50 %5llu us  p90 %5llu us  max %6llu us  lost %d\n", name,
+         (unsigned long long)lat[LATENCY_REPORTS / 2], (unsigned long long)lat[LATENCY_REPORTS * 9 / 10],
+         (unsigned long long)lat[LATENCY_REPORTS - 1], lost);
+  CHECK(lost == 0);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_stop();
+  return(lat[LATENCY_REPORTS / 2]);
+}
+
+int main(void) {
+  uint64_t event, poll;
+
+  event = run("input_mode = event\n", "event");
+  poll = run("input_mode = poll\n", "poll");
+
+  // event mode wakes on the completion, poll mode waits for its next pass
+  CHECK(event < 2000);
+  CHECK(poll < 1000 * POLL_IDLE_MAX + 2000);
+  return(host_finish("test_latency"));
+}
@@ -0,0 +1,67 @@
+/*
+ * Unit and pad image layout: units and port images start on lines of their
+ * own, the per report fields stay ahead of the output scheduler and the
+ * configuration, and the live slot walk visits each connected slot once
+ * in order.
+ */
+#include <stddef.h>
+#include "harness.h"
+
+int main(void) {
+  int32_t dev_id[MAX_XPAD_NUM], n[MAX_XPAD_NUM], i, k, order[MAX_XPAD_NUM];
+  uint32_t bits, want;
+
+  // the fields every report touches come first, configuration last
+  CHECK(offsetof(XPAD_UNIT_t, read_input) < 128);
+  CHECK(offsetof(XPAD_UNIT_t, out_busy) % 128 == 0);
+  CHECK(offsetof(XPAD_UNIT_t, xfer) < offsetof(XPAD_UNIT_t, out_busy));
+  CHECK(offsetof(XPAD_UNIT_t, conf) > offsetof(XPAD_UNIT_t, out));
+  CHECK(sizeof(PAD_IMAGE_t) % 128 == 0);
+  CHECK(((uintptr_t)&pad_image[1] & 127) == 0);
+
+  // lowest bit first, each bit once
+  bits = 0x45;
+  CHECK(slot_next(&bits) == 0 && bits == 0x44);
+  CHECK(slot_next(&bits) == 2 && bits == 0x40);
+  CHECK(slot_next(&bits) == 6 && bits == 0);
+  bits = 1u << 31;
+  CHECK(slot_next(&bits) == 31 && bits == 0);
+
+  host_setup(NULL);
+  CHECK(init_usb() == CELL_OK);
+  CHECK(((uintptr_t)unit_pool & 127) == 0);
+  CHECK(unit_pool_stride % 128 == 0);
+
+  // every port taken, then every other one freed
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    dev_id[i] = host_plug_xbox360(4);
+    n[i] = host_number(dev_id[i]);
+    CHECK(((uintptr_t)XPAD.con_unit[n[i]] & 127) == 0);
+  }
+  CHECK(XPAD.connected == (1u << MAX_XPAD_NUM) - 1);
+  want = 0;
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    if (i & 1) {
+      host_usb_unplug(dev_id[i]);
+    } else {
+      want |= 1u << n[i];
+    }
+  }
+  host_usb_pump();
+  CHECK(XPAD.connected == want);
+  bits = XPAD.connected;
+  for (k = 0; bits; k++) {
+    order[k] = slot_next(&bits);
+    CHECK(XPAD.con_unit[order[k]] != NULL);
+    CHECK(k == 0 || order[k] > order[k - 1]);
+  }
+  CHECK(k == (MAX_XPAD_NUM + 1) / 2);
+
+  for (i = 0; i < MAX_XPAD_NUM; i += 2) {
+    host_usb_unplug(dev_id[i]);
+  }
+  host_usb_pump();
+  CHECK(XPAD.connected == 0);
+  host_teardown();
+  return(host_finish("test_layout"));
+}
@@ -0,0 +1,107 @@
+/*
+ * libc.c word at a time copies, fills and compares: every alignment of
+ * source and destination and every short length against a byte loop, with
+ * the bytes around the destination left alone, and the results against the
+ * system's own functions.
+ */
+#include <dlfcn.h>
+#include "harness.h"
+
+#define LIBC_MAX 160
+#define LIBC_GUARD 16
+
+typedef void *(*MEMCPY_t)(void *, const void *, size_t);
+typedef void *(*MEMSET_t)(void *, int, size_t);
+typedef int (*MEMCMP_t)(const void *, const void *, size_t);
+
+// through volatile pointers so the compiler can't swap in its builtins
+static MEMCPY_t volatile our_memcpy = memcpy;
+static MEMSET_t volatile our_memset = memset;
+static MEMCMP_t volatile our_memcmp = memcmp;
+
+static int32_t sign(int32_t v) {
+  return((v > 0) - (v < 0));
+}
+
+int main(void) {
+  static uint8_t src[LIBC_MAX + 2 * LIBC_GUARD], dst[LIBC_MAX + 2 * LIBC_GUARD], ref[LIBC_MAX + 2 * LIBC_GUARD];
+  uint32_t s, d, n, i, bad = 0;
+  int32_t k, expect;
+  MEMCMP_t sys_memcmp = (MEMCMP_t)dlsym(RTLD_NEXT, "memcmp");
+  char str[32];
+
+  for (i = 0; i < sizeof(src); i++) {
+    src[i] = (uint8_t)(i * 7 + 1);
+  }
+
+  // copies at every alignment pair
+  for (s = 0; s < LIBC_GUARD; s++) {
+    for (d = 0; d < LIBC_GUARD; d++) {
+      for (n = 0; n <= LIBC_MAX - LIBC_GUARD; n++) {
+        for (i = 0; i < sizeof(dst); i++) {
+          dst[i] = ref[i] = 0xEE;
+        }
+        for (i = 0; i < n; i++) {
+          ref[d + LIBC_GUARD + i] = src[s + i];
+        }
+        if (our_memcpy(dst + d + LIBC_GUARD, src + s, n) != dst + d + LIBC_GUARD || memcmp(dst, ref, sizeof(dst)) != 0) {
+          bad++;
+        }
+      }
+    }
+  }
+  CHECK(bad == 0);
+
+  // fills at every alignment, the value is taken as a byte
+  bad = 0;
+  for (d = 0; d < LIBC_GUARD; d++) {
+    for (n = 0; n <= LIBC_MAX - LIBC_GUARD; n++) {
+      for (i = 0; i < sizeof(dst); i++) {
+        dst[i] = ref[i] = 0xEE;
+      }
+      for (i = 0; i < n; i++) {
+        ref[d + LIBC_GUARD + i] = 0xA5;
+      }
+      if (our_memset(dst + d + LIBC_GUARD, 0x1A5, n) != dst + d + LIBC_GUARD || memcmp(dst, ref, sizeof(dst)) != 0) {
+        bad++;
+      }
+    }
+  }
+  CHECK(bad == 0);
+
+  // compares find the first difference at any position, unsigned, like the system's
+  bad = 0;
+  CHECK(sys_memcmp != NULL && sys_memcmp != memcmp);
+  for (s = 0; s < LIBC_GUARD && sys_memcmp != NULL; s++) {
+    for (d = 0; d < LIBC_GUARD; d++) {
+      for (n = 0; n <= 64; n++) {
+        memcpy(dst + d, src + s, n);
+        if (our_memcmp(dst + d, src + s, n) != 0) {
+          bad++;
+        }
+        for (i = 0; i < n; i++) {
+          dst[d + i] = src[s + i] ^ 0x80;
+          expect = sign(sys_memcmp(dst + d, src + s, n));
+          k = sign(our_memcmp(dst + d, src + s, n));
+          if (k != expect || k == 0) {
+            bad++;
+          }
+          dst[d + i] = src[s + i];
+        }
+      }
+    }
+  }
+  CHECK(bad == 0);
+
+  // the string functions the plugin uses
+  CHECK(strlen("") == 0 && strlen("xpad") == 4);
+  CHECK(strcmp("abc", "abd") < 0 && strcmp("abc", "abc") == 0 && strcmp("b", "a\xff") > 0);
+  CHECK(strncmp("abcx", "abcy", 3) == 0);
+  CHECK(strcasecmp("BLUS30443", "blus30443") == 0);
+  CHECK(strchr("a,b", ',') != NULL && strchr("ab", ',') == NULL);
+  CHECK(strstr("Port 1: 0 dropped", "dropped") != NULL);
+  strcpy(str, "xpad");
+  strcat(str, "_settings");
+  CHECK(strcmp(str, "xpad_settings") == 0);
+  return(host_finish("test_libc"));
+}
@@ -0,0 +1,71 @@
+/*
+ * Poll mode: one read pass drains a queue mode unit instead of taking a
+ * single report per polling period, and a wireless link change is handled
+ * once rather than on every pass after it.
+ */
+#include "harness.h"
+
+#define POLL_BURST 8
+
+// link change set and not taken yet by the input thread
+static int32_t link_pending(void) {
+  uint64_t bits = 0;
+
+  return(sys_event_flag_wait(xpad_event, XPAD_EVENT_LINK, SYS_EVENT_FLAG_WAIT_OR, &bits, 1000) == CELL_OK);
+}
+
+int main(void) {
+  uint8_t r[HOST_REPORT_LEN], desc[256], link[2] = {0x08, 0x80};
+  int32_t dev_id, rx, n, h, i;
+  XPAD_UNIT_t *unit;
+
+  host_setup("input_mode = poll\ninsert_keepalive = 0\n");
+  CHECK(host_start() == 0);
+  dev_id = host_plug_wired(0x1bad, 0x0003, 4);
+  n = host_number(dev_id);
+  HOST_WAIT(reg_state[n] == REG_READY, 1000);
+  CHECK(reg_state[n] == REG_READY);
+  unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(dev_id);
+  CHECK(unit != NULL && unit->rmode == REPORT_MODE_QUEUE && unit->depth > POLL_BURST);
+  if ((h = handle[n]) < 0 || unit == NULL) {
+    return(host_finish("test_poll"));
+  }
+
+  // the slot is held so the whole burst is queued before the next pass
+  block(slot_mutex[n]);
+  for (i = 0; i < POLL_BURST; i++) {
+    host_report(r, 0, 0, 0, (int16_t)((i + 1) * 4099), 0, 0, 0);
+    host_usb_in(dev_id, 0x81, r, sizeof(r));
+    host_usb_pump();
+  }
+  CHECK(unit->head - unit->tail == POLL_BURST);
+  unblock(slot_mutex[n]);
+  HOST_WAIT(__atomic_load_n(&host_pad[h].inserts, __ATOMIC_ACQUIRE) > 0, 200);
+  usleep(1000);
+  CHECK(host_pad[h].inserts == POLL_BURST);
+  CHECK(unit->head == unit->tail);
+  CHECK(unit->dropped == 0);
+
+  // a controller links, the input thread gives it a port and clears the change
+  rx = host_usb_plug(desc, host_desc_receiver(desc, 0x0719));
+  host_usb_pump();
+  host_usb_in(rx, 0x81, link, sizeof(link));
+  host_usb_pump();
+  HOST_WAIT(XPAD.n == 2 && !link_pending(), 1000);
+  CHECK(XPAD.n == 2);
+  usleep(4000 * POLL_IDLE_MAX);
+  CHECK(!link_pending());
+
+  // and still sees it unlink
+  link[1] = 0x00;
+  host_usb_in(rx, 0x81, link, sizeof(link));
+  host_usb_pump();
+  HOST_WAIT(XPAD.n == 1, 1000);
+  CHECK(XPAD.n == 1);
+  host_usb_unplug(rx);
+
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_stop();
+  return(host_finish("test_poll"));
+}
@@ -0,0 +1,193 @@
+/*
+ * Per unit report queue: depth against the longest polling period, order
+ * and overflow, then a full port of pads, each sending on its own thread
+ * every millisecond without waiting for room, with the usb thread running
+ * the callbacks and the test reading like the input thread.
+ */
+#include <pthread.h>
+#include <time.h>
+#include "harness.h"
+
+#define QUEUE_REPORTS 1000 // reports per pad, one every ms
+#define QUEUE_WORDS (32 / 4) // payload of the drumkit's endpoint, stamped word by word
+
+static XPAD_UNIT_t *queue_unit;
+static int32_t queue_dev;
+static int32_t queue_pads[MAX_XPAD_NUM];
+static volatile int32_t queue_sending;
+static volatile uint32_t queue_naks; /* Times a device found no transfer queued and retried */
+
+static void queue_push(uint32_t i) {
+  uint8_t r[HOST_REPORT_LEN];
+
+  host_report(r, 0, 0, 0, (int16_t)i, 0, 0, 0);
+  host_usb_in(queue_dev, 0x81, r, sizeof(r));
+  host_usb_pump_one();
+}
+
+// one device, a report every ms whether or not its queue has room,
+// every word of the payload holds the report's count
+static void *producer(void *arg) {
+  uint32_t r[QUEUE_WORDS], i, j;
+  int32_t dev_id = *(int32_t *)arg;
+  struct timespec next;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (i = 0; i < QUEUE_REPORTS; i++) {
+    for (j = 0; j < QUEUE_WORDS; j++) {
+      r[j] = i;
+    }
+
+    // like a device NAKing, the report waits for the next transfer, not for queue room
+    while (host_usb_in(dev_id, 0x81, r, sizeof(r)) == 0) {
+      __sync_fetch_and_add(&queue_naks, 1);
+      sched_yield();
+    }
+    next.tv_nsec += 1000000;
+    if (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+  __sync_fetch_and_sub(&queue_sending, 1);
+  return(NULL);
+}
+
+// the one usb thread every callback runs on, so each queue keeps one writer
+static void *usb_thread(void *arg) {
+  (void)arg;
+
+  while (queue_sending > 0) {
+    if (host_usb_pump_one() == 0) {
+      sched_yield();
+    }
+  }
+  host_usb_pump();
+  return(NULL);
+}
+
+int main(void) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint32_t i, d, n, j, w, got[MAX_XPAD_NUM], total, torn, late, seen;
+  uint8_t tcount[MAX_XPAD_NUM];
+  XPAD_UNIT_t *units[MAX_XPAD_NUM];
+  pthread_t t[MAX_XPAD_NUM], usb;
+  uint64_t idle;
+
+  // every depth covers the longest polling period unless it hit the cap
+  for (i = 1; i <= 64; i++) {
+    d = queue_depth(i);
+    CHECK((d & (d - 1)) == 0);
+    CHECK(d <= MAX_QUEUE_DEPTH);
+    CHECK(d == MAX_QUEUE_DEPTH || i * (d - 2) >= POLL_IDLE_MAX);
+  }
+
+  // the drumkit is listed with REPORT_MODE_QUEUE
+  host_setup("input_mode = poll\nin_transfers = 4\n");
+  CHECK(init_usb() == CELL_OK);
+  queue_dev = host_plug_wired(0x1bad, 0x0003, 4);
+  CHECK((queue_unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(queue_dev)) != NULL);
+  if (queue_unit == NULL) {
+    return(host_finish("test_queue"));
+  }
+  CHECK(queue_unit->rmode == REPORT_MODE_QUEUE);
+  CHECK(queue_unit->depth == queue_depth(4));
+
+  // pool units hold the configured transfers and the deepest queue
+  CHECK(unit_pool_stride % 128 == 0);
+  CHECK(unit_pool_stride >= sizeof(XPAD_UNIT_t) + UNIT_BUFFERS(in_transfers, queue_depth(1)));
+  CHECK(queue_unit->slots + queue_unit->depth * queue_unit->slot_len <= (unsigned char *)queue_unit + unit_pool_stride);
+  CHECK(bit_count(0) == 0 && bit_count(0xFFFFFFFF) == 32 && bit_count(0x80000001) == 2 && bit_count(0xF0F00F0F) == 16);
+
+  // an idle poll period is not cut short by the queue
+  for (i = 0; i < POLL_IDLE_PASSES * 8; i++) {
+    poll_adapt();
+  }
+  CHECK(poll_period == POLL_IDLE_MAX);
+
+  // a whole idle period of reports is kept, in order
+  n = POLL_IDLE_MAX / 4;
+  for (i = 0; i < n; i++) {
+    queue_push(i);
+  }
+  CHECK(queue_unit->dropped == 0);
+  for (i = 0; i < n; i++) {
+    CHECK(report_get(queue_unit, data) == 1);
+    CHECK(data[0] == ((i + 1) & 0xFF));
+  }
+  CHECK(report_get(queue_unit, data) == 0);
+
+  // once full the newest reports are dropped and counted
+  for (i = 0; i < queue_unit->depth + 5; i++) {
+    queue_push(i);
+  }
+  CHECK(queue_unit->dropped == 5);
+  for (i = 0; i < queue_unit->depth; i++) {
+    CHECK(report_get(queue_unit, data) == 1);
+  }
+  CHECK(report_get(queue_unit, data) == 0);
+
+  host_usb_unplug(queue_dev);
+  host_usb_pump();
+
+  // every port sending at 1 ms, nothing lost, torn or reordered
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    queue_pads[i] = host_plug_wired(0x1bad, 0x0003, 1);
+    CHECK((units[i] = (XPAD_UNIT_t *)cellUsbdGetPrivateData(queue_pads[i])) != NULL);
+    if (units[i] == NULL) {
+      return(host_finish("test_queue"));
+    }
+    CHECK(units[i]->payload == sizeof(uint32_t) * QUEUE_WORDS);
+    got[i] = 0;
+    tcount[i] = (uint8_t)(units[i]->tcount + 1);
+  }
+  queue_sending = MAX_XPAD_NUM;
+  pthread_create(&usb, NULL, usb_thread, NULL);
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    pthread_create(&t[i], NULL, producer, &queue_pads[i]);
+  }
+  total = torn = late = 0;
+  idle = host_now_ns();
+  while (total < MAX_XPAD_NUM * QUEUE_REPORTS && (queue_sending > 0 || host_now_ns() - idle < 1000000000ULL)) {
+    for (i = 0, seen = 0; i < MAX_XPAD_NUM; i++) {
+      if (report_get(units[i], data) == 0) {
+        continue;
+      }
+      idle = host_now_ns();
+      seen++;
+
+      // each word has the count of the report it came with, and the counts follow each other
+      for (j = 0; j < QUEUE_WORDS; j++) {
+        memcpy(&w, &data[2 + j * 4], 4);
+        if (w != got[i]) {
+          torn++;
+          break;
+        }
+      }
+      if (data[0] != tcount[i] || data[1] != sizeof(uint32_t) * QUEUE_WORDS) {
+        late++;
+      }
+      tcount[i]++;
+      got[i]++;
+      total++;
+    }
+    if (seen == 0) {
+      sched_yield();
+    }
+  }
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    pthread_join(t[i], NULL);
+  }
+  pthread_join(usb, NULL);
+  printf("%u reports from %d pads, %u naks, %u torn, %u out of order\n", total, MAX_XPAD_NUM, queue_naks, torn, late);
+  CHECK(torn == 0);
+  CHECK(late == 0);
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    CHECK(got[i] == QUEUE_REPORTS);
+    CHECK(units[i]->dropped == 0);
+    host_usb_unplug(queue_pads[i]);
+  }
+  host_teardown();
+  return(host_finish("test_queue"));
+}
@@ -0,0 +1,96 @@
+/*
+ * Wireless receivers: two at once, each controller gets its own port and
+ * reports reach only its pad, and unplugging one receiver only takes its
+ * own controllers and units with it.
+ */
+#include "harness.h"
+
+static int32_t plug_receiver(void) {
+  uint8_t desc[256];
+  int32_t dev_id;
+
+  dev_id = host_usb_plug(desc, host_desc_receiver(desc, 0x0719));
+  host_usb_pump();
+  return(dev_id);
+}
+
+static int32_t rx_link(int32_t dev_id, int32_t ep, uint8_t state) {
+  uint8_t r[2] = {0x08, state};
+  XPADW_RECEIVER_t *rx;
+  int32_t n;
+
+  host_usb_in(dev_id, 0x81 + ep * 2, r, sizeof(r));
+  host_usb_pump();
+  xpadw_links();
+  rx = receiver_find(dev_id);
+  if (rx == NULL || (n = rx->unit[ep]->number) < 0) {
+    return(-1);
+  }
+  host_register(n);
+  return(n);
+}
+
+static uint16_t *pad_after(int32_t dev_id, int32_t ep, int32_t n, uint16_t buttons) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[HOST_REPORT_W_LEN];
+
+  host_report_w(r, buttons, 0, 0, 0, 0, 0, 0);
+  host_usb_in(dev_id, 0x81 + ep * 2, r, sizeof(r));
+  host_usb_pump();
+  XPAD.con_unit[n]->read_input(n, data);
+  return(host_pad[handle[n]].data.button);
+}
+
+int main(void) {
+  int32_t rx1, rx2, rx3, n1, n2;
+  uint16_t *b;
+
+  host_setup("insert_keepalive = 0\n");
+  CHECK(init_usb() == CELL_OK);
+  rx1 = plug_receiver();
+  rx2 = plug_receiver();
+  CHECK(receiver_find(rx1) != NULL && receiver_find(rx2) != NULL);
+  CHECK(receiver_find(rx1)->n == MAX_XPADW_NUM && receiver_find(rx2)->n == MAX_XPADW_NUM);
+  CHECK(stats.units_in_use == 2 * MAX_XPADW_NUM);
+
+  // a third receiver finds no free entry and holds no units
+  rx3 = plug_receiver();
+  CHECK(receiver_find(rx3) == NULL);
+  CHECK(stats.units_in_use == 2 * MAX_XPADW_NUM);
+  host_usb_unplug(rx3);
+
+  // a controller on each, the second on another endpoint
+  n1 = rx_link(rx1, 0, 0x80);
+  n2 = rx_link(rx2, 2, 0x80);
+  CHECK(n1 >= 0 && n2 >= 0 && n1 != n2);
+  if (n1 < 0 || n2 < 0 || reg_state[n1] != REG_READY || reg_state[n2] != REG_READY) {
+    return(host_finish("test_receivers"));
+  }
+  b = pad_after(rx1, 0, n1, btnA);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CROSS);
+  CHECK(host_pad[handle[n2]].inserts == 0);
+  b = pad_after(rx2, 2, n2, btnB);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CIRCLE);
+  CHECK(host_pad[handle[n1]].data.button[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_CROSS);
+
+  // the first receiver goes, the second keeps its controller
+  host_usb_unplug(rx1);
+  host_usb_pump();
+  CHECK(receiver_find(rx1) == NULL);
+  CHECK(XPAD.connected == (1u << n2) && XPAD.n == 1);
+  CHECK(stats.units_in_use == MAX_XPADW_NUM);
+  b = pad_after(rx2, 2, n2, btnX);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_SQUARE);
+
+  // its entry is free for another receiver, an unlinked controller gives its port back
+  rx3 = plug_receiver();
+  CHECK(receiver_find(rx3) != NULL);
+  CHECK(rx_link(rx2, 2, 0x00) < 0);
+  CHECK(XPAD.connected == 0 && XPAD.n == 0);
+  host_usb_unplug(rx2);
+  host_usb_unplug(rx3);
+  host_usb_pump();
+  CHECK(stats.units_in_use == 0);
+  host_teardown();
+  return(host_finish("test_receivers"));
+}
@@ -0,0 +1,77 @@
+/*
+ * Registration past REG_TIMEOUT: it counts as failed but the slot stays
+ * pending, so a late handle is still used by its pad, or released once
+ * it shows up if the pad is gone by then. A handle without a port number
+ * still gets a fresh pad image and a led.
+ */
+#include "harness.h"
+
+#define LATE_US (REG_TIMEOUT * 1000 + 300000)
+
+static int32_t registered(void) {
+  int32_t i, n = 0;
+
+  for (i = 0; i < HOST_MAX_PORTS; i++) {
+    n += host_pad[i].registered;
+  }
+  return(n);
+}
+
+int main(void) {
+  uint8_t r[HOST_REPORT_LEN], out[8];
+  int32_t dev_id, n, h;
+
+  host_setup("input_mode = event\ninsert_keepalive = 0\n");
+  host_reg_delay_us = LATE_US;
+  CHECK(host_start() == 0);
+
+  // the pad still works once its late handle shows up
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  HOST_WAIT(stats.reg_failed == 1, REG_TIMEOUT + 200);
+  CHECK(stats.reg_failed == 1);
+  CHECK(reg_state[n] == REG_PENDING && (reg_pending & (1 << n)) && (reg_late & (1 << n)));
+  HOST_WAIT(reg_state[n] == REG_READY, LATE_US / 1000 + 500);
+  CHECK(reg_state[n] == REG_READY && reg_pending == 0 && reg_late == 0);
+  if ((h = handle[n]) >= 0) {
+    host_report(r, btnA, 0, 0, 0, 0, 0, 0);
+    host_usb_in(dev_id, 0x81, r, sizeof(r));
+    host_usb_pump();
+    HOST_WAIT(host_pad[h].inserts > 0, 200);
+    CHECK(host_pad[h].inserts > 0);
+  }
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  CHECK(registered() == 0);
+
+  // a pad gone before its late handle shows up gives the handle back
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  HOST_WAIT(stats.reg_failed == 2, REG_TIMEOUT + 200);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  CHECK(reg_state[n] == REG_CANCEL && (reg_pending & (1 << n)));
+  HOST_WAIT(reg_pending == 0, LATE_US / 1000 + 500);
+  CHECK(reg_state[n] == REG_IDLE && handle[n] < 0);
+  CHECK(registered() == 0);
+  CHECK(stats.reg_failed == 2);
+
+  // no port number yet, the led follows the slot
+  host_reg_delay_us = 50000;
+  host_port_missing = 1;
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  pad_image[n].valid = 1;
+  pad_image[n].data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] = 0;
+  HOST_WAIT(reg_state[n] == REG_READY, 500);
+  CHECK(reg_state[n] == REG_READY);
+  CHECK(pad_image[n].valid == 0 && pad_image[n].data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] == 0x0080);
+  host_usb_pump();
+  CHECK(host_usb_out(dev_id, out, sizeof(out)) == 3 && out[2] == xpad_led[n % 4]);
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_port_missing = 0;
+
+  host_stop();
+  return(host_finish("test_register"));
+}
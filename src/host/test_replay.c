@@ -0,0 +1,96 @@
+/*
+ * Capture and replay: a live session on the input thread is captured, the
+ * trace must hold every report as sent, and replaying it must give the
+ * same pad data as the live session, the same on every run.
+ */
+#include "replay.h"
+
+#define REPLAY_REPORTS 64
+
+static REPLAY_RESULT_t live;
+
+static int32_t capture_path(char *out, size_t len) {
+  return(snprintf(out, len, "%s%s", host_root, CAPTURE_FILE));
+}
+
+int main(void) {
+  uint8_t r[REPLAY_REPORTS][HOST_REPORT_LEN];
+  char path[256], copy[256], cmd[600];
+  REPLAY_t trace;
+  REPLAY_RECORD_t rec;
+  REPLAY_RESULT_t res[2];
+  int32_t dev_id, n, i, k, h;
+  uint64_t inserts, last = 0;
+  const char *settings = "input_mode = event\ninsert_keepalive = 0\n";
+
+  // live session with capture on, every report is inserted before the next is sent
+  host_setup(settings);
+  host_fs_put(CAPTURE_FLAG, "");
+  for (i = 0; i < HOST_MAX_PORTS; i++) {
+    live.digest[i] = 0xCBF29CE484222325ULL;
+  }
+  replay_result = &live;
+  host_insert_hook = replay_insert;
+  CHECK(host_start() == 0);
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  HOST_WAIT(reg_state[n] == REG_READY, 1000);
+  CHECK(reg_state[n] == REG_READY);
+  h = handle[n];
+  for (i = 0; i < REPLAY_REPORTS; i++) {
+    host_report(r[i], (i & 1) ? btnA : btnB, i * 3, 0, (int16_t)(i * 1021), (int16_t)(-i * 509), 0, 0);
+    inserts = host_pad[h].inserts;
+    host_usb_in(dev_id, 0x81, r[i], HOST_REPORT_LEN);
+    host_usb_pump();
+    HOST_WAIT(host_pad[h].inserts != inserts, 200);
+    usleep(500);
+  }
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_stop();
+  host_insert_hook = NULL;
+  CHECK(live.inserts[h] == REPLAY_REPORTS);
+
+  // the trace holds each report as it came off the bus, in order
+  capture_path(path, sizeof(path));
+  CHECK(replay_open(&trace, path) == 0);
+  CHECK(trace.freq == HOST_TIMEBASE);
+  for (i = 0; (k = replay_next(&trace, &rec)) > 0; i++) {
+    if (i < REPLAY_REPORTS) {
+      CHECK(rec.count == HOST_REPORT_LEN && memcmp(rec.payload, r[i], HOST_REPORT_LEN) == 0);
+    }
+    CHECK(rec.dev_id == (uint32_t)dev_id);
+    CHECK(rec.xtype == XTYPE_XBOX360);
+    CHECK(rec.tb >= last);
+    last = rec.tb;
+  }
+  CHECK(k == 0);
+  CHECK(i == REPLAY_REPORTS);
+  replay_close(&trace);
+
+  // copy the trace out before the next setup clears the root
+  snprintf(copy, sizeof(copy), "/tmp/xpadreplay%d.bin", (int)getpid());
+  snprintf(cmd, sizeof(cmd), "cp %s %s", path, copy);
+  CHECK(system(cmd) == 0);
+
+  // replaying gives the live pad data, on every run
+  for (k = 0; k < 2; k++) {
+    host_setup(settings);
+    host_fs_put(DEVICES_FILE, replay_devices);
+    CHECK(init_usb() == CELL_OK);
+    CHECK(replay_open(&trace, copy) == 0);
+    CHECK(replay_run(&trace, &res[k], 0) == 0);
+    replay_close(&trace);
+    host_teardown();
+    CHECK(res[k].records == REPLAY_REPORTS && res[k].unplayed == 0);
+  }
+  for (i = 0; i < HOST_MAX_PORTS && res[0].inserts[i] == 0; i++);
+  CHECK(i < HOST_MAX_PORTS);
+  if (i < HOST_MAX_PORTS) {
+    CHECK(res[0].inserts[i] == REPLAY_REPORTS);
+    CHECK(res[0].digest[i] == live.digest[h]);
+    CHECK(res[1].digest[i] == res[0].digest[i]);
+  }
+  unlink(copy);
+  return(host_finish("test_replay"));
+}
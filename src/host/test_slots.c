@@ -0,0 +1,95 @@
+/*
+ * Per slot locks: a slot held by attach or detach doesn't hold up reads on
+ * the others, and pads coming and going next to a streaming pad neither
+ * lose its reports, stall them, nor leave a slot behind.
+ */
+#include <sched.h>
+#include "harness.h"
+
+#define SLOT_ROUNDS 200
+#define SLOT_GAP_MAX_US 2000 // the hot plug path used to hold the streaming pad 10 ms and more
+
+static uint64_t gap_tb; /* Longest time between two inserts on the streaming pad */
+static uint64_t prev_tb;
+
+static int32_t send_wait(int32_t dev_id, int32_t h, int16_t lx) {
+  uint8_t r[HOST_REPORT_LEN];
+  uint64_t inserts = host_pad[h].inserts;
+  uint64_t t0;
+
+  host_report(r, 0, 0, 0, lx, 0, 0, 0);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  t0 = host_now_ns();
+
+  // spins rather than sleeping so the gaps measured are the plugin's, not the wait's
+  while (__atomic_load_n(&host_pad[h].inserts, __ATOMIC_ACQUIRE) == inserts && host_now_ns() - t0 < 200000000ULL) {
+    sched_yield();
+  }
+  if (host_pad[h].inserts == inserts) {
+    return(0);
+  }
+
+  // each delivery is stamped, the gap to the one before it is what the game sees
+  if (prev_tb != 0 && host_pad[h].last_tb - prev_tb > gap_tb) {
+    gap_tb = host_pad[h].last_tb - prev_tb;
+  }
+  prev_tb = host_pad[h].last_tb;
+  return(1);
+}
+
+int main(void) {
+  int32_t a, b, c = 0, na, nb, ha, hb, i, lost = 0;
+  uint64_t gap_us;
+
+  host_setup("input_mode = event\ninsert_keepalive = 0\n");
+  // registrations as slow as the stall the streaming pad used to see
+  host_reg_delay_us = 10000;
+  CHECK(host_start() == 0);
+  a = host_plug_xbox360(4);
+  b = host_plug_xbox360(4);
+  na = host_number(a);
+  nb = host_number(b);
+  HOST_WAIT(reg_state[na] == REG_READY && reg_state[nb] == REG_READY, 1000);
+  CHECK(reg_state[na] == REG_READY && reg_state[nb] == REG_READY);
+  if ((ha = handle[na]) < 0 || (hb = handle[nb]) < 0) {
+    return(host_finish("test_slots"));
+  }
+
+  // one slot held, the other still reads
+  block(slot_mutex[na]);
+  CHECK(send_wait(b, hb, 1000) == 1);
+  unblock(slot_mutex[na]);
+
+  // a third pad plugged and unplugged while the one on port 0 streams
+  CHECK(na == 0);
+  prev_tb = 0;
+  gap_tb = 0;
+  for (i = 0; i < SLOT_ROUNDS; i++) {
+    c = host_plug_xbox360(4);
+    lost += !send_wait(a, ha, (int16_t)(i * 4099 + 1));
+    host_usb_unplug(c);
+    host_usb_pump();
+    lost += !send_wait(a, ha, (int16_t)(i * 4099 + 2));
+  }
+  gap_us = gap_tb * 1000000 / sys_time_get_timebase_frequency();
+  printf("port 0: %d reports over %d hot plugs, longest gap %llu us\n", SLOT_ROUNDS * 2 - lost, SLOT_ROUNDS, (unsigned long long)gap_us);
+  CHECK(lost == 0);
+  CHECK(gap_us < SLOT_GAP_MAX_US);
+  CHECK(XPAD.n == 2);
+  CHECK(XPAD.connected == ((1u << na) | (1u << nb)));
+  CHECK(stats.units_in_use == 2);
+
+  // handles of the third pad are all given back, even those that came late
+  HOST_WAIT(reg_pending == 0, 2 * REG_TIMEOUT);
+  for (i = 0, c = 0; i < HOST_MAX_PORTS; i++) {
+    c += host_pad[i].registered;
+  }
+  CHECK(c == 2);
+
+  host_usb_unplug(a);
+  host_usb_unplug(b);
+  host_usb_pump();
+  host_stop();
+  return(host_finish("test_slots"));
+}
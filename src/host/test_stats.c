@@ -0,0 +1,54 @@
+/*
+ * Stats dump: PS + START on a pad asks for it, the input thread writes
+ * stats.txt and shows a line per connected port.
+ */
+#include "harness.h"
+
+static int32_t read_file(const char *path, char *buf, int32_t max) {
+  char p[256];
+  FILE *f;
+  int32_t n;
+
+  snprintf(p, sizeof(p), "%s%s", host_root, path);
+  if ((f = fopen(p, "rb")) == NULL) {
+    return(-1);
+  }
+  n = fread(buf, 1, max - 1, f);
+  buf[n] = 0;
+  fclose(f);
+  return(n);
+}
+
+int main(void) {
+  uint8_t r[HOST_REPORT_LEN];
+  char text[2048];
+  int32_t dev_id, n;
+
+  host_setup("input_mode = event\ninsert_keepalive = 0\n");
+  CHECK(host_start() == 0);
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  HOST_WAIT(reg_state[n] == REG_READY, 1000);
+  CHECK(reg_state[n] == REG_READY);
+
+  // the combo acts once while it is held
+  host_report(r, btnXbox | btnStart, 0, 0, 0, 0, 0, 0);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  HOST_WAIT(read_file(STATS_FILE, text, sizeof(text)) > 0, 1000);
+  CHECK(read_file(STATS_FILE, text, sizeof(text)) > 0);
+  CHECK(strstr(text, "Units 1 in use, 1 most, 0 refused") != NULL);
+  CHECK(strstr(text, "Port 1: ") != NULL);
+  CHECK(strstr(text, " 0 dropped") != NULL);
+  CHECK(strncmp(host_last_msg, "Port 1: ", 8) == 0);
+  host_fs_remove(STATS_FILE);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  usleep(20000);
+  CHECK(read_file(STATS_FILE, text, sizeof(text)) < 0);
+
+  host_usb_unplug(dev_id);
+  host_usb_pump();
+  host_stop();
+  return(host_finish("test_stats"));
+}
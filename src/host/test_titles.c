@@ -0,0 +1,109 @@
+/*
+ * Per title profiles: xpad_titles.txt is read sorted, a game boot picks
+ * the profile of its title id and a game exit goes back to the settings.
+ */
+#include "harness.h"
+
+static char game_id[16]; /* Title id the game plugin reports */
+static int32_t game_up; /* Game plugin view exists */
+
+static int32_t game_info(void *info) {
+  memcpy((char *)info + 4, game_id, strlen(game_id));
+  return(0);
+}
+
+static GAME_PLUGIN_t game_plugin;
+
+static int32_t game_view_find(const char *name) {
+  return((game_up && strcmp(name, "game_plugin") == 0) ? 1 : 0);
+}
+
+static void *game_interface(int32_t view, int32_t id) {
+  return((view == 1 && id == 1) ? &game_plugin : NULL);
+}
+
+static uint16_t l2_after(int32_t dev_id, int32_t n, uint8_t trigL) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[HOST_REPORT_LEN];
+
+  host_report(r, 0, trigL, 0, 0, 0, 0, 0);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  XPAD.con_unit[n]->read_input(n, data);
+  return(host_pad[handle[n]].data.button[CELL_PAD_BTN_OFFSET_DIGITAL2] & CELL_PAD_CTRL_L2);
+}
+
+int main(void) {
+  int32_t dev_id, n, i;
+
+  host_setup("stick_deadzone = 10\ntrigger_threshold = 40\ninsert_keepalive = 0\n");
+  host_fs_put(TITLES_FILE,
+    "# title id, settings\n"
+    "NPUB30000, stick_deadzone = 20\n"
+    "BLUS30443, trigger_threshold = 100, insert_keepalive = 500\n"
+    "BLES00001, stick_curve = 9\n"
+    "blus1, remap = 0\n"
+    "BCUS98174, stick_antideadzone = 15\n");
+  game_plugin.gameInfo = game_info;
+  paf_view_find = game_view_find;
+  paf_plugin_interface = game_interface;
+  CHECK(init_usb() == CELL_OK);
+
+  // bad lines are left out and the rest are sorted by key
+  CHECK(title_count == 3);
+  for (i = 1; i < (int32_t)title_count; i++) {
+    CHECK(titles[i - 1].key < titles[i].key);
+  }
+  CHECK(title_find(title_key("BLUS30443")) != NULL);
+  CHECK(title_find(title_key("BLES00001")) == NULL);
+  CHECK(title_find(title_key("BLUS30444")) == NULL);
+  CHECK(title_key("blus30443") == 0);
+
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  host_register(n);
+  CHECK(reg_state[n] == REG_READY);
+  if (reg_state[n] != REG_READY) {
+    return(host_finish("test_titles"));
+  }
+  CHECK(l2_after(dev_id, n, 60) != 0);
+
+  // nothing changes until the game plugin can tell the title id
+  host_game = 0x1000;
+  strcpy(game_id, "BLUS30443");
+  title_check();
+  CHECK(analog.trig_on == 40);
+  CHECK(title_pid == 0);
+  game_up = 1;
+  title_check();
+  CHECK(title_pid == 0x1000);
+  CHECK(analog.trig_on == 100);
+  CHECK(insert_keepalive == 500);
+  CHECK(analog.deadzone == 10);
+  CHECK(l2_after(dev_id, n, 60) == 0);
+  CHECK(l2_after(dev_id, n, 120) != 0);
+
+  // the game exits, then another one without a profile boots
+  host_game = 0;
+  title_check();
+  CHECK(analog.trig_on == 40);
+  CHECK(insert_keepalive == 0);
+  host_game = 0x2000;
+  strcpy(game_id, "BLES00001");
+  title_check();
+  CHECK(title_pid == 0x2000);
+  CHECK(analog.trig_on == 40);
+  CHECK(analog.deadzone == 10);
+
+  // a profile only changes what it lists
+  host_game = 0x3000;
+  strcpy(game_id, "NPUB30000");
+  title_check();
+  CHECK(analog.deadzone == 20);
+  CHECK(analog.trig_on == 40);
+  CHECK(l2_after(dev_id, n, 60) != 0);
+
+  host_usb_unplug(dev_id);
+  host_teardown();
+  return(host_finish("test_titles"));
+}
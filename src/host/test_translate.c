@@ -0,0 +1,81 @@
+/*
+ * Table driven button translation: the lookup tables against a bit by bit
+ * walk of the button maps, then whole reports through to the pad data.
+ */
+#include "harness.h"
+
+static uint16_t *pad_after(int32_t dev_id, int32_t n, uint16_t buttons, uint8_t trigL, int16_t lx, int16_t ly) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  uint8_t r[HOST_REPORT_LEN];
+
+  host_report(r, buttons, trigL, 0, lx, ly, 0, 0);
+  host_usb_in(dev_id, 0x81, r, sizeof(r));
+  host_usb_pump();
+  XPAD.con_unit[n]->read_input(n, data);
+  return(host_pad[handle[n]].data.button);
+}
+
+int main(void) {
+  uint32_t w, i, expect, got;
+  int32_t dev_id, n;
+  uint16_t *b;
+
+  host_setup(NULL);
+  CHECK(init_usb() == CELL_OK);
+
+  // both Xbox tables match the map for every button word
+  for (w = 0; w < 0x10000; w++) {
+    expect = 0;
+    for (i = 0; i < XBOX_MAP_SIZE; i++) {
+      if (w & xbox_map[i].xbox) {
+        expect |= xbox_map[i].pad;
+      }
+    }
+    got = xbox_lut[0][w >> 8] | xbox_lut[1][w & 0xFF];
+    if (got != expect) {
+      break;
+    }
+  }
+  CHECK(w == 0x10000);
+
+  // HID buttons, one table per 8
+  for (i = 0; i < HID_BUTTONS; i++) {
+    CHECK(hid_lut[i / 8][1 << (i % 8)] == hid_map[i]);
+  }
+  CHECK(hid_lut[0][0xFF] == (hid_map[0] | hid_map[1] | hid_map[2] | hid_map[3] | hid_map[4] | hid_map[5] | hid_map[6] | hid_map[7]));
+
+  // each button alone reaches the pad with full pressure where it has one
+  dev_id = host_plug_xbox360(4);
+  n = host_number(dev_id);
+  host_register(n);
+  CHECK(reg_state[n] == REG_READY);
+  if (reg_state[n] != REG_READY) {
+    return(host_finish("test_translate"));
+  }
+  for (i = 0; i < XBOX_MAP_SIZE; i++) {
+    b = pad_after(dev_id, n, xbox_map[i].xbox, 0, 0, 0);
+    CHECK(b[0] == ((xbox_map[i].pad & PAD_PS) ? CELL_PAD_CTRL_LDD_PS : 0));
+    CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL1] == (xbox_map[i].pad & 0xFF));
+    CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == ((xbox_map[i].pad >> 8) & 0xFF));
+  }
+  b = pad_after(dev_id, n, btnA | btnDigiUp, 0, 0, 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_PRESS_CROSS] == 0xFF);
+  CHECK(b[CELL_PAD_BTN_OFFSET_PRESS_UP] == 0xFF);
+  CHECK(b[CELL_PAD_BTN_OFFSET_PRESS_CIRCLE] == 0);
+
+  // an analog trigger presses L2 and keeps its value as pressure
+  b = pad_after(dev_id, n, 0, 200, 0, 0);
+  CHECK(b[CELL_PAD_BTN_OFFSET_DIGITAL2] == CELL_PAD_CTRL_L2);
+  CHECK(b[CELL_PAD_BTN_OFFSET_PRESS_L2] == 200);
+
+  // Xbox sticks grow up, PS3 ones down
+  b = pad_after(dev_id, n, 0, 0, 32767, 32767);
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] == 0xFF);
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] == 0x00);
+  b = pad_after(dev_id, n, 0, 0, -32768, -32768);
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] == 0x00);
+  CHECK(b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] == 0xFF);
+  host_usb_unplug(dev_id);
+  host_teardown();
+  return(host_finish("test_translate"));
+}
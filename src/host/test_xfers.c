@@ -0,0 +1,78 @@
+/*
+ * Interrupt IN transfers in flight: every unit keeps in_transfers queued,
+ * a burst the size of that is taken without waiting for a resubmit, and
+ * completions handled out of order still deliver reports in the order the
+ * device sent them.
+ */
+#include "harness.h"
+
+#define XFERS 4
+
+static uint8_t marker(const unsigned char *data) {
+  return(data[2 + 6]); // low byte of the left stick x
+}
+
+static void send(int32_t dev_id, uint8_t m, int32_t *taken) {
+  uint8_t r[HOST_REPORT_LEN];
+
+  host_report(r, 0, 0, 0, m, 0, 0, 0);
+  *taken += host_usb_in(dev_id, 0x81, r, sizeof(r));
+}
+
+int main(void) {
+  unsigned char data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
+  int32_t queue_dev, latest_dev, taken, i, round;
+  XPAD_UNIT_t *unit;
+
+  host_setup("input_mode = poll\nin_transfers = 4\n");
+  CHECK(init_usb() == CELL_OK);
+
+  // the drumkit queues every report, a 1 ms endpoint
+  queue_dev = host_plug_wired(0x1bad, 0x0003, 1);
+  CHECK((unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(queue_dev)) != NULL);
+  if (unit == NULL) {
+    return(host_finish("test_xfers"));
+  }
+  CHECK(unit->xfers == XFERS);
+  CHECK(host_usb_in_queued(queue_dev, 0x81) == XFERS);
+
+  // a burst fills every transfer, the next report finds none until they complete
+  for (round = 0; round < 3; round++) {
+    taken = 0;
+    for (i = 0; i < XFERS + 1; i++) {
+      send(queue_dev, round * 16 + i, &taken);
+    }
+    CHECK(taken == XFERS);
+
+    // newest first, each completion waits for the older ones
+    while (host_usb_pump_newest());
+    CHECK(host_usb_in_queued(queue_dev, 0x81) == XFERS);
+    for (i = 0; i < XFERS; i++) {
+      CHECK(report_get(unit, data) == 1);
+      CHECK(marker(data) == round * 16 + i);
+      CHECK(data[0] == ((round * XFERS + i + 1) & 0xFF));
+    }
+    CHECK(report_get(unit, data) == 0);
+  }
+  CHECK(unit->dropped == 0);
+
+  // out of order completions can't leave an older report as the latest
+  latest_dev = host_plug_xbox360(1);
+  CHECK((unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(latest_dev)) != NULL && unit->rmode == REPORT_MODE_LATEST);
+  if (unit != NULL) {
+    taken = 0;
+    for (i = 0; i < XFERS; i++) {
+      send(latest_dev, 0x40 + i, &taken);
+    }
+    CHECK(taken == XFERS);
+    while (host_usb_pump_newest());
+    CHECK(report_get(unit, data) == 1);
+    CHECK(marker(data) == 0x40 + XFERS - 1);
+    CHECK(unit->skipped == XFERS - 1);
+  }
+  host_usb_unplug(queue_dev);
+  host_usb_unplug(latest_dev);
+  host_usb_pump();
+  host_teardown();
+  return(host_finish("test_xfers"));
+}
@@ -2,13 +2,66 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __ALTIVEC__
+#include <altivec.h>
+#endif
+
+/* copies and compares go a word at a time once both pointers are word aligned,
+   with the AltiVec build moving 16 bytes at a time when they are 16 byte aligned */
+typedef unsigned long __attribute__((__may_alias__)) word_t;
+
+#define WORD_SIZE sizeof(word_t)
+#define WORD_MASK (WORD_SIZE - 1)
+#define VEC_MIN 64
+
 void *memset(void *m, int c, size_t n)
 {
-	char *s = (char *) m;
+	unsigned char *s = (unsigned char *) m;
+	word_t w;
+
+	while (n != 0 && ((unsigned long)s & WORD_MASK) != 0)
+	{
+		*s++ = (unsigned char) c;
+		n--;
+	}
+
+#ifdef __ALTIVEC__
+	if (n >= VEC_MIN && ((unsigned long)s & 15) == 0)
+	{
+		unsigned char pat[16] __attribute__((aligned(16)));
+		vector unsigned char v;
+		int i;
+
+		for (i = 0; i < 16; i++)
+			pat[i] = (unsigned char) c;
+		v = vec_ld(0, pat);
+		while (n >= 16)
+		{
+			vec_st(v, 0, s);
+			s += 16;
+			n -= 16;
+		}
+	}
+#endif
+
+	if (n >= WORD_SIZE)
+	{
+		w = (unsigned char) c;
+		w |= w << 8;
+		w |= w << 16;
+		if (WORD_SIZE > 4)
+			w |= (w << 16) << 16;
+		while (n >= WORD_SIZE)
+		{
+			*(word_t *)s = w;
+			s += WORD_SIZE;
+			n -= WORD_SIZE;
+		}
+	}
 
 	while (n-- != 0)
 	{
-		*s++ = (char) c;
+		*s++ = (unsigned char) c;
 	}
 
 	return m;
@@ -16,11 +69,42 @@ void *memset(void *m, int c, size_t n)
 
 void *memcpy(void *dst0, const void *src0, size_t len0)
 {
-	char *dst = (char *)dst0;
-	char *src = (char *)src0;
+	unsigned char *dst = (unsigned char *)dst0;
+	const unsigned char *src = (const unsigned char *)src0;
 
 	void *save = dst0;
 
+	/* only worth aligning when both pointers can end up aligned together */
+	if ((((unsigned long)dst ^ (unsigned long)src) & WORD_MASK) == 0)
+	{
+		while (len0 != 0 && ((unsigned long)dst & WORD_MASK) != 0)
+		{
+			*dst++ = *src++;
+			len0--;
+		}
+
+#ifdef __ALTIVEC__
+		if (len0 >= VEC_MIN && (((unsigned long)dst | (unsigned long)src) & 15) == 0)
+		{
+			while (len0 >= 16)
+			{
+				vec_st(vec_ld(0, src), 0, dst);
+				dst += 16;
+				src += 16;
+				len0 -= 16;
+			}
+		}
+#endif
+
+		while (len0 >= WORD_SIZE)
+		{
+			*(word_t *)dst = *(const word_t *)src;
+			dst += WORD_SIZE;
+			src += WORD_SIZE;
+			len0 -= WORD_SIZE;
+		}
+	}
+
 	while (len0--)
 		*dst++ = *src++;
 
@@ -30,11 +114,28 @@ void *memcpy(void *dst0, const void *src0, size_t len0)
 int memcmp(const void* s1, const void* s2,size_t n)
 {
     const unsigned char *p1 = s1, *p2 = s2;
+
+    /* skip equal words, the byte loop below finds the first difference */
+    if ((((unsigned long)p1 ^ (unsigned long)p2) & WORD_MASK) == 0)
+    {
+        while (n != 0 && ((unsigned long)p1 & WORD_MASK) != 0)
+        {
+            if (*p1 != *p2)
+                return *p1 - *p2;
+            p1++, p2++, n--;
+        }
+        while (n >= WORD_SIZE && *(const word_t *)p1 == *(const word_t *)p2)
+        {
+            p1 += WORD_SIZE;
+            p2 += WORD_SIZE;
+            n -= WORD_SIZE;
+        }
+    }
     while(n--)
         if( *p1 != *p2 )
             return *p1 - *p2;
         else
-            *p1++,*p2++;
+            p1++,p2++;
     return 0;
 }
 
@@ -57,10 +158,15 @@ char *strchr(const char *s, int c)
 
 char *strstr(const char *s1, const char *s2)
 {
-    size_t n = strlen(s2);
-    while(*s1)
-        if(!memcmp(s1++,s2,n))
-            return s1-1;
+    size_t n;
+
+    /* only compare the rest of the needle where its first character matches */
+    if (!*s2)
+        return (char *)s1;
+    n = strlen(s2) - 1;
+    while ((s1 = strchr(s1, *s2)) != 0)
+        if(!memcmp(++s1,s2+1,n))
+            return (char *)s1-1;
     return 0;
 }
 
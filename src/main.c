@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ppu_thread.h>
@@ -8,37 +9,190 @@
 #include <sys/timer.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/sys_time.h>
 #include <cell/sysmodule.h>
 #include <cell/pad.h>
 #include <cell/pad/libpad_dbg.h>
 #include <cell/usbd.h>
+#include <cell/cell_fs.h>
+#include <cell/atomic.h>
+#include <ppu_intrinsics.h>
 #include "ControlStruct.h"
 
+// uncomment to measure input latency per controller, press PS + SELECT to show and dump it
+//#define XPAD_LATENCY
+
 #define THREAD_NAME "xpaddt"
 #define STOP_THREAD_NAME "xpadds"
+#define CAPTURE_THREAD_NAME "xpaddc"
+#define XPAD_DIR "/dev_hdd0/xpad/"
+#define CAPTURE_FLAG XPAD_DIR "capture.on" // capture is enabled while this file exists
+#define CAPTURE_FILE XPAD_DIR "capture.bin"
+#define CAPTURE_MAGIC 0x58505452 // "XPTR"
+#define CAPTURE_VERSION 1
+#define CAPTURE_BUF_SIZE 0x4000
+#define CAPTURE_MAX_RECORD (10 + 5 + 3 + MAX_XPAD_PAYLOAD) // delta, dev_id, ifnum/xtype/count, payload
+#define CAPTURE_EVENT_STOP (1ULL << 63)
+#define DEVICES_FILE XPAD_DIR "xpad_devices.txt"
+#define DEVICE_TABLE_SIZE 512 // power of 2, below 60% full with the whole linux xpad table
+#define DEVICE_HASH(key) (((key) * 0x9E3779B1) >> (32 - 9)) // top 9 bits for 512 entries
+#define DEVICE_REGISTERED 0x01 // temporary flag while registering ranges
+#define CONFIG_CHUNK 512 // bytes read from a config file at a time
+#define CONFIG_LINE 256 // longest config file line
+#define SETTINGS_FILE XPAD_DIR "xpad_settings.txt"
+#define REMAP_FILE XPAD_DIR "xpad_remap.txt"
+#define MAX_REMAP 10 // remap profiles
+#define REMAP_BUTTONS 17 // DIGITAL1 bits, DIGITAL2 bits, then PS
+#define REMAP_DIGITAL 0xFF // target pressure follows its digital button
+#define REMAP_INVERT 0x80 // stick axis source is inverted
+#define TITLES_FILE XPAD_DIR "xpad_titles.txt"
+#define TITLE_ID_LEN 9 // ex: BLUS30443
+#define TITLE_KEEP 0xFF // title profile leaves the global setting
+#define TITLE_KEEP16 0xFFFF // same for the 16 bit fields
+#define REMAP_COMBO (PAD_PS | PAD_D1(CELL_PAD_CTRL_R3)) // selects the next remap profile
+#define STATS_COMBO (PAD_PS | PAD_D1(CELL_PAD_CTRL_START)) // writes STATS_FILE
+#define COMBO_REMAP 0x1 // REMAP_COMBO held
+#define COMBO_STATS 0x2 // STATS_COMBO held
+#define LATENCY_COMBO (PAD_PS | PAD_D1(CELL_PAD_CTRL_SELECT)) // writes LATENCY_FILE
+#define COMBO_LATENCY 0x4 // LATENCY_COMBO held
+#define COMBO_PS 0x80 // PS held back until it is released
+#define STATS_FILE XPAD_DIR "stats.txt"
+#define LATENCY_FILE XPAD_DIR "latency.txt"
+#define LATENCY_BUCKETS 128 // 4 buckets per power of 2 timebase ticks
+#ifdef XPAD_LATENCY
+#define SLOT_STAMP_LEN 8 // completion timebase stored in front of each slot
+#else
+#define SLOT_STAMP_LEN 0
+#endif
 #define MAX_XPAD_DEV_NUM ((int32_t)(sizeof(xpad_info) / sizeof(xpad_info[0])))
 #define MAX_XPADW_DEV_NUM ((int32_t)(sizeof(xpadw_info) / sizeof(xpadw_info[0])))
 #define MAX_XPAD_NUM CELL_PAD_MAX_PORT_NUM
-#define MAX_XPADW_NUM 4
+#define MAX_XPADW_NUM 4 // controllers per wireless receiver
+#define MAX_XPADW_RECEIVERS 2 // wireless receivers attached at once
 #define XPAD_DATA_LEN 14+2 // +2 for count and size fields
 #define XPADW_DATA_LEN 0x13+2
-#define MAX_XPAD_DATA_LEN XPADW_DATA_LEN
-#define RINGBUF_SIZE  10
+#define MAX_XPAD_PAYLOAD 64 // largest full speed interrupt packet
+#define MAX_QUEUE_DEPTH 32 // power of 2
+#define MAX_IN_FLIGHT 4 // interrupt IN transfers queued per unit at most
+#define IN_TRANSFERS 2 // interrupt IN transfers queued per unit by default
+#define UNIT_POOL_SIZE (MAX_XPAD_NUM + MAX_XPADW_RECEIVERS * MAX_XPADW_NUM) // units reserved in init_usb, unlinked wireless units hold no port
+#define UNIT_DATA_LEN ((MAX_XPAD_PAYLOAD + 7) & ~7)
+#define UNIT_SLOT_LEN ((SLOT_STAMP_LEN + MAX_XPAD_PAYLOAD + 2 + 7) & ~7)
+#define UNIT_BUFFERS(xfers, depth) ((xfers) * UNIT_DATA_LEN + (depth) * UNIT_SLOT_LEN)
+#define UNIT_POOL_STRIDE(xfers, depth) ((sizeof(XPAD_UNIT_t) + ((UNIT_BUFFERS(xfers, depth) > HID_DESC_MAX) ? UNIT_BUFFERS(xfers, depth) : HID_DESC_MAX) + 127) & ~127)
+#define POLL_IDLE_MAX 32 // ms between reads in polling mode once every pad is idle, longest a report queue has to last
+#define POLL_IDLE_PASSES 16 // unchanged reads before the polling period doubles
+#define REG_POLL_INTERVAL 1 // ms between checks of a pending ldd controller registration
+#define REG_TIMEOUT 500 // ms before a pending registration counts as failed
+#define REG_LATE_INTERVAL 100 // ms between checks of a registration past REG_TIMEOUT
+#define RATE_INTERVAL 1000 // ms between per port read rate updates
+#define HOUSEKEEPING_INTERVAL 100 // ms between pad status checks in event mode
+#define VSH_RESOLVE_PASSES 2 // vsh export lookups, at load and again for misses after the xmb wait
+#define INSERT_KEEPALIVE 500 // ms between inserts of unchanged pad data, 0 inserts every report
+#define OUT_LED 0x1 // led state waiting to be sent
+#define OUT_REPORT_LEN 8 // largest output report
+#define XPAD_EVENT_WAKE (1ULL << 63) // wakes the input thread without any data
+#define XPAD_EVENT_LINK (1ULL << 62) // a wireless controller linked or unlinked
+#define XPAD_EVENT_ALL (XPAD_EVENT_WAKE | XPAD_EVENT_LINK | ((1ULL << MAX_XPAD_NUM) - 1))
+#define LINK_PENDING 0x100 // wireless link status waiting to be handled
+#define SLOT_FRESH 0x80000000 // triple buffer mid slot not read yet
+#define SLOT_INDEX 0x3
 #define DESCRIPTOR_TABLE_SIZE (sizeof(descriptor_table)/sizeof(descriptor_table_t))
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAP16(x) ((uint16_t)(x)) // host build, usb fields are already in cpu order
+#else
 #define SWAP16(x) ((uint16_t)((((x) & 0x00FF) << 8) | (((x) & 0xFF00) >> 8)))
+#endif
+#define PAD_D1(x) ((uint32_t)(x)) // CELL_PAD_BTN_OFFSET_DIGITAL1 bits in a pad button mask
+#define PAD_D2(x) ((uint32_t)(x) << 8) // CELL_PAD_BTN_OFFSET_DIGITAL2 bits in a pad button mask
+#define PAD_PS (1 << 16) // CELL_PAD_CTRL_LDD_PS in a pad button mask
+#define STICK_AXIAL_SHIFT 5 // stick magnitude to axial lookup index
+#define STICK_AXIAL_SIZE ((32768 >> STICK_AXIAL_SHIFT) + 1)
+#define STICK_RADIAL_SHIFT 20 // squared stick radius to radial lookup index
+#define STICK_RADIAL_SIZE ((2 * 32768 * 32768U >> STICK_RADIAL_SHIFT) + 1)
+#define XBOX_MAP_SIZE (sizeof(xbox_map)/sizeof(xbox_map[0]))
+#define HID_DESC_MAX 1024 // longest report descriptor, fetched into the unit's transfer buffers
+#define HID_MAX_FIELDS 12 // extraction plan steps
+#define HID_MAX_IDS 8 // report ids tracked while parsing
+#define HID_BUTTONS 16 // HID buttons mapped to pad buttons, 8 per lookup table
+#define HID_AXES 6 // lx, ly, rx, ry, trigL, trigR
+#define HID_AXIS_MAP_SIZE (sizeof(hid_axis_map)/sizeof(hid_axis_map[0]))
+#define DS3_REPORT_LEN 49 // DualShock 3 usb input report with its id
+#define DS3_FEATURE_LEN 17 // feature report 0xF2, reading it starts the input reports
+#define DS4_REPORT_LEN 25 // DualShock 4 usb input report up to the accelerometer
+#define DS4_ACCEL_SCALE 904 // 113 sixaxis counts per g over 8192 DualShock 4 counts per g, 16 bit fraction
+#define DS4_GYRO_SCALE 5467 // 123 sixaxis counts per 90 deg/s over 16.384 DualShock 4 counts per deg/s (2000 deg/s full scale), 16 bit fraction
+#define HID_READ_PAD 3 // a field is always read as 4 bytes, buffers leave room past the payload
 
 enum XTYPES {
   XTYPE_XBOX360 = 1,
-  XTYPE_XBOX360W = 2
+  XTYPE_XBOX360W = 2,
+  XTYPE_XBOX = 3,
+  XTYPE_XBOXONE = 4,
+  XTYPE_HID = 5
+};
+
+enum PTYPES {
+  PTYPE_PS3 = 0x10,
+  PTYPE_PS4 = 0x11,
+  PTYPE_BT = 0x12
+};
+
+enum INPUT_MODES {
+  INPUT_MODE_EVENT = 0, // input thread sleeps until a transfer completes
+  INPUT_MODE_POLL = 1 // input thread reads on a period derived from each endpoint's bInterval
+};
+
+enum REG_STATES {
+  REG_IDLE = 0, // no virtual controller
+  REG_PENDING = 1, // registration issued, waiting for the handle
+  REG_READY = 2, // handle valid, reports are inserted
+  REG_CANCEL = 3 // unregistered while pending, drop the handle once it shows up
+};
+
+enum HID_OPS {
+  HID_OP_BUTTONS = 0, // run of up to 8 buttons through one lookup table
+  HID_OP_HAT = 1, // hat switch to d-pad
+  HID_OP_AXIS = 2 // logical range to 16 bit axis
+};
+
+enum REPORT_MODES {
+  REPORT_MODE_LATEST = 0, // only the newest report is kept, older ones are skipped
+  REPORT_MODE_QUEUE = 1 // every report is queued, for devices where each one matters
 };
 
 typedef struct xpad_device {
 	uint16_t vid;
 	uint16_t pid;
 	const char *name;
+	uint8_t rmode;
 } XPAD_INFO_t;
 
-// xpad device info from linux xpad driver
+typedef struct {
+  uint32_t key; /* vid << 16 | pid, 0 for an empty entry */
+  uint8_t type; /* XTYPE or PTYPE */
+  uint8_t rmode; /* Report mode */
+  uint8_t flags;
+} DEVICE_ENTRY_t;
+
+typedef struct {
+  const char *name;
+  uint8_t type;
+} DEVICE_TYPE_t;
+
+// types accepted in the last column of xpad_devices.txt
+static const DEVICE_TYPE_t device_types[] = {
+  {"XTYPE_XBOX360", XTYPE_XBOX360},
+  {"XTYPE_XBOX360W", XTYPE_XBOX360W},
+  {"XTYPE_XBOX", XTYPE_XBOX},
+  {"XTYPE_XBOXONE", XTYPE_XBOXONE},
+  {"XTYPE_HID", XTYPE_HID},
+  {"PTYPE_PS3", PTYPE_PS3},
+  {"PTYPE_PS4", PTYPE_PS4},
+  {"PTYPE_BT", PTYPE_BT},
+};
+
+// built in xpad device info from linux xpad driver, xpad_devices.txt adds to it
 static XPAD_INFO_t xpad_info[] = {
 	{0x045e, 0x028e, "Microsoft X-Box 360 pad"},
 	{0x046d, 0xc242, "Logitech Chillstream Controller"},
@@ -53,7 +207,7 @@ static XPAD_INFO_t xpad_info[] = {
 	{0x146b, 0x0601, "BigBen Interactive XBOX 360 Controller"},
 	{0x1689, 0xfd00, "Razer Onza Tournament Edition"},
 	{0x1689, 0xfd01, "Razer Onza Classic Edition"},
-	{0x1bad, 0x0003, "Harmonix Rock Band Drumkit"},
+	{0x1bad, 0x0003, "Harmonix Rock Band Drumkit", REPORT_MODE_QUEUE},
 	{0x1bad, 0xf016, "Mad Catz Xbox 360 Controller"},
 	{0x1bad, 0xf028, "Street Fighter IV FightPad"},
 	{0x1bad, 0xf901, "Gamestop Xbox 360 Controller"},
@@ -71,30 +225,100 @@ typedef struct {
   int32_t (*dump_descriptor)(int32_t dev_id, void *desc);
 } descriptor_table_t;
 
+typedef struct {
+  struct XPAD_UNIT *unit; /* Owner */
+  uint32_t seq; /* Order the transfer was queued in */
+  int32_t count; /* Bytes received */
+  volatile uint8_t done; /* Completed, waiting for the ones queued before it */
+  unsigned char *buf; /* Transfer buffer */
+} XPAD_XFER_t;
+
+typedef struct {
+  uint8_t op; /* HID_OP_* */
+  uint8_t byte; /* First report byte holding the field, after the report id */
+  uint8_t shift; /* Bit offset within that byte */
+  uint8_t sext; /* Sign extension shift, 0 for an unsigned field */
+  uint8_t arg; /* Button lookup table, hat step or pad axis */
+  uint8_t lshift; /* Buttons: first button's bit in its lookup table */
+  uint8_t size; /* Bits */
+  uint32_t mask; /* (1 << size) - 1 */
+  int32_t min; /* Logical minimum */
+  uint32_t range; /* Logical maximum - minimum */
+  uint32_t scale; /* Axis: 16 bit fraction mapping the logical range to 0..65535 */
+} HID_FIELD_t;
+
+/*
+ * Extraction plan compiled from a HID report descriptor at attach,
+ * decoding a report just runs its fields in order
+ */
+typedef struct {
+  uint8_t report_id; /* Input report the fields come from, 0 when the device has no ids */
+  uint8_t n; /* Fields */
+  uint8_t len; /* Report bytes needed, after the report id */
+  uint8_t axes; /* Bit per pad axis some field fills */
+  uint16_t desc_len; /* Report descriptor length, fetched once configured */
+  HID_FIELD_t field[HID_MAX_FIELDS];
+} HID_PLAN_t;
+
+/*
+ * Attach time configuration, only read when transfers are set up
+ * and when output is sent, kept apart from the per report state
+ */
 typedef struct {
   int32_t dev_id; /* Device id */
-  int32_t number; /* Xpad number */
   int32_t c_pipe; /* Control pipe id */
-  int32_t i_pipe; /* In pipe id */
   int32_t o_pipe; /* Out pipe id */
-  int32_t payload; /* Size of payload */
   uint8_t ifnum; /* Interface number */
   uint8_t as; /* Alternate setting number */
+  uint8_t interval; /* Endpoint polling interval in ms */
+  int32_t (*out_report)(struct XPAD_UNIT *unit, uint32_t what);
+} XPAD_UNIT_CONF_t;
+
+/*
+ * Units start on a cache line, the fields every report touches come first,
+ * the output scheduler gets lines of its own and the configuration goes last
+ */
+typedef struct XPAD_UNIT {
+  int32_t number; /* Xpad number */
+  int32_t i_pipe; /* In pipe id */
+  int32_t payload; /* Size of payload */
   int32_t tcount; /* Transfer counts */
   uint8_t xtype;
-
-  // methods to their respective controllers
+  uint8_t rmode; /* Report mode */
+  uint32_t link; /* Latched wireless link status */
   int32_t (*read_input)(int32_t dev_id, void *data);
-  int32_t (*set_led)(int32_t dev_id, uint8_t led);
-  int32_t (*set_rumble)(int32_t dev_id, uint8_t lval, uint8_t rval);
-
-  /* Ring buffer */
-  int32_t rp; /* Read pointer   */
-  int32_t wp; /* Write pointer  */
-  int32_t rblen; /* Buffer length  */
-  unsigned char ringbuf[RINGBUF_SIZE][MAX_XPAD_DATA_LEN]; /* Ring buffer */
 
-  /* Buffer for interrupt transfer */
+  /* Report slots, each holds count and size followed by the payload */
+  unsigned char *slots;
+  int32_t slot_len; /* Bytes per slot */
+  uint32_t depth; /* Number of slots in queue mode, power of 2 */
+
+  /* Latest report triple buffer, slots swapped through mid */
+  uint32_t front; /* Slot owned by reader */
+  volatile uint32_t mid; /* Last completed slot | SLOT_FRESH */
+  uint32_t back; /* Slot owned by writer */
+  uint32_t skipped; /* Reports replaced before being read */
+
+  /* Single producer, single consumer queue */
+  volatile uint32_t head; /* Written by the USB callback only */
+  volatile uint32_t tail; /* Written by the input thread only */
+  uint32_t dropped; /* Reports lost to a full queue */
+
+  /* Interrupt IN transfers in flight, handled in the order they were queued */
+  uint32_t xfers; /* Transfers kept in flight */
+  uint32_t next_seq; /* Sequence number handled next */
+  XPAD_XFER_t xfer[MAX_IN_FLIGHT];
+
+  /* Output scheduler, one transfer in flight and the latest state merged into the next */
+  volatile uint32_t out_busy __attribute__((aligned(128))); /* Out transfer in flight */
+  volatile uint32_t out_pending; /* OUT_LED */
+  uint8_t led; /* Latest led state */
+  uint32_t out_merged; /* Updates folded into one already pending */
+  unsigned char out[OUT_REPORT_LEN] __attribute__((aligned(8))); /* Buffer for out transfer */
+
+  XPAD_UNIT_CONF_t conf;
+
+  /* Buffers for interrupt transfers, one per transfer in flight */
   unsigned char data[0];
 
 } XPAD_UNIT_t;
@@ -102,10 +326,100 @@ typedef struct {
 typedef struct {
   int32_t next_number;
   int32_t n;
-  int32_t is_connected[MAX_XPAD_NUM];
-  XPAD_UNIT_t *con_unit[MAX_XPAD_NUM];
+  volatile uint32_t connected; /* Bit per slot delivering input, read without a lock */
+  XPAD_UNIT_t *con_unit[MAX_XPAD_NUM]; /* Set while the unit holds the slot */
 } XPAD_t;
 
+typedef struct {
+  int32_t dev_id; /* Receiver device id, -1 when the entry is free */
+  XPAD_UNIT_t *unit[MAX_XPADW_NUM]; /* One unit per receiver endpoint */
+  int32_t n; /* Units in use */
+} XPADW_RECEIVER_t;
+
+/*
+ * Capture file layout, all multi byte header fields are big endian:
+ *   header: magic (4), version (1), timebase frequency (8)
+ *   record: timebase delta (varint), dev_id (varint), ifnum (1), xtype (1), count (1), payload (count)
+ * the first record's delta is relative to 0, each following one to the record before it
+ */
+typedef struct {
+  int fd;
+  uint64_t last_tb; /* Timebase of the previous record */
+  uint32_t active; /* Buffer filled by the USB callback */
+  uint32_t len[2]; /* Bytes used in each buffer */
+  volatile uint32_t full[2]; /* Buffer handed to the writer thread */
+  uint32_t dropped; /* Records lost while both buffers were full */
+  unsigned char buf[2][CAPTURE_BUF_SIZE];
+} CAPTURE_t;
+
+/*
+ * Remap profile compiled from xpad_remap.txt, sources are the buttons and
+ * axes a decoder reports, targets what the game sees
+ */
+typedef struct {
+  uint32_t lut[2][256]; /* DIGITAL1 and DIGITAL2 source byte to target pad button mask */
+  uint32_t ps; /* Target pad button mask of PS */
+  uint8_t press[12]; /* Source pressure for each target, RIGHT..R1, L2, R2, or REMAP_DIGITAL */
+  uint8_t axis[4]; /* Source of lx, ly, rx, ry | REMAP_INVERT */
+} REMAP_PROFILE_t;
+
+typedef struct {
+  uint64_t key; /* Title id packed by title_key */
+  uint16_t keepalive; /* insert_keepalive, TITLE_KEEP16 to keep */
+  uint16_t trig_on; /* trigger_threshold, TITLE_KEEP16 to keep */
+  uint8_t remap; /* Remap setting, TITLE_KEEP for each field to keep the global one */
+  uint8_t deadzone;
+  uint8_t antideadzone;
+  uint8_t curve;
+} TITLE_PROFILE_t;
+
+typedef struct {
+  void *unk[15];
+  int32_t (*gameInfo)(void *info); /* Title id at +0x04, title at +0x14 */
+} GAME_PLUGIN_t;
+
+typedef struct {
+  const char *name;
+  uint32_t mask; /* Pad button mask */
+  uint8_t press; /* Pressure index, RIGHT..R1, L2, R2, or REMAP_DIGITAL */
+} REMAP_NAME_t;
+
+typedef struct {
+  CellPadData data; /* Pad data last sent to the virtual pad */
+  uint64_t last_insert; /* Timebase of last insert */
+  uint8_t valid; /* Data has been inserted since registration */
+  uint8_t trig_held; /* L2 and R2 held by the triggers before remapping */
+  uint8_t combo; /* COMBO_REMAP | COMBO_STATS | COMBO_LATENCY held, COMBO_PS */
+} __attribute__((aligned(128))) PAD_IMAGE_t; /* Each port's image on lines of its own */
+
+typedef struct {
+  uint32_t inserts_issued[MAX_XPAD_NUM]; /* cellPadLddDataInsert calls */
+  uint32_t inserts_suppressed[MAX_XPAD_NUM]; /* Reports that left the pad data unchanged */
+  uint32_t units_in_use; /* Unit pool slots taken */
+  uint32_t units_high_water; /* Most unit pool slots ever taken at once */
+  uint32_t unit_alloc_failed; /* Attaches refused because the pool was empty */
+  uint32_t queue_depth_high_water; /* Deepest report queue handed out */
+  uint32_t reads[MAX_XPAD_NUM]; /* Reports read since the last rate update */
+  uint32_t read_rate[MAX_XPAD_NUM]; /* Reports read per second */
+  uint32_t poll_period; /* ms between reads in polling mode, 0 while parked */
+  uint32_t first_insert_us[MAX_XPAD_NUM]; /* Registration start to first inserted report */
+  uint32_t reg_wait_us[MAX_XPAD_NUM]; /* Registration start to valid handle */
+  uint32_t reg_failed; /* Registrations given up after REG_TIMEOUT */
+  uint32_t hid_failed; /* HID devices without a usable report descriptor */
+} XPAD_STATS_t;
+
+#ifdef XPAD_LATENCY
+typedef struct {
+  uint32_t queue[MAX_XPAD_NUM][LATENCY_BUCKETS]; /* Transfer completion to dequeue */
+  uint32_t total[MAX_XPAD_NUM][LATENCY_BUCKETS]; /* Transfer completion to insert */
+  uint64_t queue_max[MAX_XPAD_NUM];
+  uint64_t total_max[MAX_XPAD_NUM];
+  uint32_t reports[MAX_XPAD_NUM]; /* Reports dequeued */
+  uint64_t done[MAX_XPAD_NUM]; /* Completion timebase of the report being translated */
+  uint64_t since; /* Timebase when measuring started */
+} XPAD_LATENCY_t;
+#endif
+
 int xpadd_start(uint64_t arg);
 int xpadd_stop(void);
 
@@ -116,36 +430,94 @@ static int32_t xpad_detach(int32_t dev_id);
 static int32_t xpad_detach_all(void);
 static int32_t xpad_read_input(int32_t id, void *data);
 static void xpad_read_report(int32_t id, uint8_t *readBuf);
-static int32_t xpad_set_led(int32_t id, uint8_t led);
-static int32_t xpad_set_rumble(int32_t id, uint8_t lval, uint8_t rval);
+static int32_t xpad_out_report(XPAD_UNIT_t *unit, uint32_t what);
 
 // wireless Xbox 360 controller methods
 static int32_t xpadw_probe(int32_t dev_id);
 static int32_t xpadw_attach(int32_t dev_id);
 static int32_t xpadw_detach(int32_t dev_id);
 static int32_t xpadw_detach_all(void);
+static void xpadw_links(void);
+static XPADW_RECEIVER_t *receiver_find(int32_t dev_id);
 static int32_t xpadw_read_input(int32_t id, void *data);
 static void xpadw_read_report(int32_t id, uint8_t *readBuf);
-static int32_t xpadw_set_led(int32_t id, uint8_t led);
-static int32_t xpadw_set_rumble(int32_t id, uint8_t lval, uint8_t rval);
+static int32_t xpadw_out_report(XPAD_UNIT_t *unit, uint32_t what);
+
+// generic hid gamepad methods
+static int32_t hid_probe(int32_t dev_id);
+static int32_t hid_attach(int32_t dev_id);
+static int32_t hid_detach(int32_t dev_id);
+static int32_t hid_detach_all(void);
+static int32_t hid_read_input(int32_t id, void *data);
+static void hid_read_report(int32_t id, HID_PLAN_t *plan, uint8_t *readBuf);
+static int32_t hid_out_report(XPAD_UNIT_t *unit, uint32_t what);
+static void hid_start(int32_t result, int32_t count, void *arg);
+
+// DualShock 3 and 4 methods, attached through the hid methods
+static void ds3_enable(XPAD_UNIT_t *unit);
+static int32_t ds_read_input(int32_t id, void *data);
+static void ds3_read_report(int32_t id, uint8_t *readBuf);
+static void ds4_read_report(int32_t id, uint8_t *readBuf);
 
 // common methods
 static void data_transfer_done(int32_t result, int32_t count, void *arg);
 static void data_transfer(XPAD_UNIT_t *unit);
 static void set_config_done(int32_t result, int32_t count, void *arg);
 static void set_interface_done(int32_t result, int32_t count, void *arg);
-static XPAD_UNIT_t *unit_alloc(int32_t dev_id, int32_t payload, uint8_t ifnum, uint8_t as, uint8_t xtype);
+static XPAD_UNIT_t *unit_alloc(int32_t dev_id, int32_t payload, uint8_t interval, uint8_t ifnum, uint8_t as, uint8_t xtype, uint8_t rmode);
+static void pad_image_reset(int32_t id);
 static void unit_free(XPAD_UNIT_t *unit);
+static int32_t out_set_led(XPAD_UNIT_t *unit, uint8_t led);
 static int32_t check_pad_status(void);
 static int32_t register_ldd_controller(XPAD_UNIT_t *unit);
 static int32_t unregister_ldd_controller(XPAD_UNIT_t *unit);
 
+// stats methods
+static void stats_report(void);
+
+// capture methods
+static int32_t capture_start(void);
+static void capture_stop(void);
+static void capture_record(XPAD_UNIT_t *unit, unsigned char *buf, int32_t count);
+
 // vsh methods
-void *getNIDfunc(const char *vsh_module, uint32_t fnid, int32_t offset);
+static void vsh_resolve_table(uint32_t table);
+static void vsh_resolve(void);
+static void vsh_retry(void);
 static void show_msg(char *msg);
+
+// remap methods
+static void remap_select(uint32_t n);
+static void remap_next(void);
+
+// title profile methods
+static void title_load(void);
+static void title_free(void);
+static void title_check(void);
+static void build_pad_tables(void);
 int (*vshtask_notify)(int, const char *) = NULL;
 void *(*vsh_malloc)(unsigned int size) = NULL;
 int (*vsh_free)(void *ptr) = NULL;
+uint32_t (*vsh_game_pid)(void) = NULL;
+int32_t (*paf_view_find)(const char *name) = NULL;
+void *(*paf_plugin_interface)(int32_t view, int32_t id) = NULL;
+
+typedef struct {
+  const char *lib; /* Export library name */
+  uint32_t fnid; /* Function NID */
+  void **func; /* Resolved address, stays NULL when missing */
+} VSH_EXPORT_t;
+
+// every vsh export the plugin uses, resolved together in one pass
+static VSH_EXPORT_t vsh_exports[] = {
+  {"vshtask", 0xA02D46E7, (void **)&vshtask_notify},
+  {"allocator", 0x759E0635, (void **)&vsh_malloc},
+  {"allocator", 0x77A602DD, (void **)&vsh_free},
+  {"vshmain", 0x0624D3AE, (void **)&vsh_game_pid},
+  {"paf", 0xF21655F3, (void **)&paf_view_find},
+  {"paf", 0x23AFB290, (void **)&paf_plugin_interface},
+};
+static uint8_t vsh_resolved; /* Lookup passes done, after the last one a NULL pointer is a known miss */
 
 // usb methods
 static int32_t get_device_desc(int32_t dev_id, void *p);
@@ -153,6 +525,113 @@ static int32_t get_configration_desc(int32_t dev_id, void *p);
 static int32_t get_interface_desc(int32_t dev_id, void *p);
 static int32_t get_endpoint_desc(int32_t dev_id, void *p);
 
+typedef struct {
+  uint16_t xbox; /* Xbox button bit */
+  uint32_t pad; /* Pad button mask */
+} BTN_MAP_t;
+
+// Xbox buttons and the PS3 buttons they translate to
+static const BTN_MAP_t xbox_map[] = {
+  {btnXbox, PAD_PS},
+  {btnDigiLeft, PAD_D1(CELL_PAD_CTRL_LEFT)},
+  {btnDigiDown, PAD_D1(CELL_PAD_CTRL_DOWN)},
+  {btnDigiRight, PAD_D1(CELL_PAD_CTRL_RIGHT)},
+  {btnDigiUp, PAD_D1(CELL_PAD_CTRL_UP)},
+  {btnStart, PAD_D1(CELL_PAD_CTRL_START)},
+  {btnHatRight, PAD_D1(CELL_PAD_CTRL_R3)},
+  {btnHatLeft, PAD_D1(CELL_PAD_CTRL_L3)},
+  {btnBack, PAD_D1(CELL_PAD_CTRL_SELECT)},
+  {btnX, PAD_D2(CELL_PAD_CTRL_SQUARE)},
+  {btnA, PAD_D2(CELL_PAD_CTRL_CROSS)},
+  {btnB, PAD_D2(CELL_PAD_CTRL_CIRCLE)},
+  {btnY, PAD_D2(CELL_PAD_CTRL_TRIANGLE)},
+  {btnShoulderRight, PAD_D2(CELL_PAD_CTRL_R1)},
+  {btnShoulderLeft, PAD_D2(CELL_PAD_CTRL_L1)},
+};
+
+// HID buttons 1..16 in the common DirectInput gamepad order
+static const uint32_t hid_map[HID_BUTTONS] = {
+  PAD_D2(CELL_PAD_CTRL_SQUARE), PAD_D2(CELL_PAD_CTRL_CROSS), PAD_D2(CELL_PAD_CTRL_CIRCLE), PAD_D2(CELL_PAD_CTRL_TRIANGLE),
+  PAD_D2(CELL_PAD_CTRL_L1), PAD_D2(CELL_PAD_CTRL_R1), PAD_D2(CELL_PAD_CTRL_L2), PAD_D2(CELL_PAD_CTRL_R2),
+  PAD_D1(CELL_PAD_CTRL_SELECT), PAD_D1(CELL_PAD_CTRL_START), PAD_D1(CELL_PAD_CTRL_L3), PAD_D1(CELL_PAD_CTRL_R3),
+  PAD_PS, 0, 0, 0
+};
+
+// hat switch positions clockwise from up
+static const uint32_t hid_hat[8] = {
+  PAD_D1(CELL_PAD_CTRL_UP), PAD_D1(CELL_PAD_CTRL_UP | CELL_PAD_CTRL_RIGHT),
+  PAD_D1(CELL_PAD_CTRL_RIGHT), PAD_D1(CELL_PAD_CTRL_RIGHT | CELL_PAD_CTRL_DOWN),
+  PAD_D1(CELL_PAD_CTRL_DOWN), PAD_D1(CELL_PAD_CTRL_DOWN | CELL_PAD_CTRL_LEFT),
+  PAD_D1(CELL_PAD_CTRL_LEFT), PAD_D1(CELL_PAD_CTRL_LEFT | CELL_PAD_CTRL_UP)
+};
+
+typedef struct {
+  uint32_t usage; /* Usage page << 16 | usage id */
+  uint8_t axis; /* Pad axis, lx, ly, rx, ry, trigL, trigR */
+} HID_AXIS_t;
+
+// HID axes and the pad axes they fill, the first field with a usage wins
+static const HID_AXIS_t hid_axis_map[] = {
+  {0x010030, 0}, // X
+  {0x010031, 1}, // Y
+  {0x010032, 2}, // Z
+  {0x010035, 3}, // Rz
+  {0x010033, 4}, // Rx
+  {0x010034, 5}, // Ry
+  {0x0200C5, 4}, // brake
+  {0x0200C4, 5}, // accelerator
+};
+
+// DualShock 3 report bytes holding RIGHT..DOWN and TRIANGLE..R1 pressure
+static const uint8_t ds3_press[10] = {15, 17, 14, 16, 22, 23, 24, 25, 20, 21};
+
+// remap names in pad button mask bit order
+static const REMAP_NAME_t remap_names[REMAP_BUTTONS] = {
+  {"SELECT", PAD_D1(CELL_PAD_CTRL_SELECT), REMAP_DIGITAL},
+  {"L3", PAD_D1(CELL_PAD_CTRL_L3), REMAP_DIGITAL},
+  {"R3", PAD_D1(CELL_PAD_CTRL_R3), REMAP_DIGITAL},
+  {"START", PAD_D1(CELL_PAD_CTRL_START), REMAP_DIGITAL},
+  {"UP", PAD_D1(CELL_PAD_CTRL_UP), 2},
+  {"RIGHT", PAD_D1(CELL_PAD_CTRL_RIGHT), 0},
+  {"DOWN", PAD_D1(CELL_PAD_CTRL_DOWN), 3},
+  {"LEFT", PAD_D1(CELL_PAD_CTRL_LEFT), 1},
+  {"L2", PAD_D2(CELL_PAD_CTRL_L2), 10},
+  {"R2", PAD_D2(CELL_PAD_CTRL_R2), 11},
+  {"L1", PAD_D2(CELL_PAD_CTRL_L1), 8},
+  {"R1", PAD_D2(CELL_PAD_CTRL_R1), 9},
+  {"TRIANGLE", PAD_D2(CELL_PAD_CTRL_TRIANGLE), 4},
+  {"CIRCLE", PAD_D2(CELL_PAD_CTRL_CIRCLE), 5},
+  {"CROSS", PAD_D2(CELL_PAD_CTRL_CROSS), 6},
+  {"SQUARE", PAD_D2(CELL_PAD_CTRL_SQUARE), 7},
+  {"PS", PAD_PS, REMAP_DIGITAL},
+};
+static const char *remap_axes[4] = {"LX", "LY", "RX", "RY"};
+
+// pressure sensitive buttons in order of their CELL_PAD_BTN_OFFSET_PRESS_* offset
+static const uint8_t press_d1[4] = {CELL_PAD_CTRL_RIGHT, CELL_PAD_CTRL_LEFT, CELL_PAD_CTRL_UP, CELL_PAD_CTRL_DOWN};
+static const uint8_t press_d2[6] = {CELL_PAD_CTRL_TRIANGLE, CELL_PAD_CTRL_CIRCLE, CELL_PAD_CTRL_CROSS, CELL_PAD_CTRL_SQUARE, CELL_PAD_CTRL_L1, CELL_PAD_CTRL_R1};
+
+typedef struct {
+  uint8_t deadzone; /* Percent of stick travel ignored around the center */
+  uint8_t antideadzone; /* Percent of output the stick jumps to when it leaves the deadzone */
+  uint8_t curve; /* Response curve exponent, 1 is linear */
+  uint8_t radial; /* Deadzone applies to the stick radius instead of each axis */
+  uint8_t trig_on; /* Trigger value that presses L2/R2 */
+  uint8_t trig_hyst; /* How far below trig_on a pressed trigger may fall and stay pressed */
+} ANALOG_CONFIG_t;
+
+// defaults give the plain 16 to 8 bit conversion and L2/R2 on any pull
+static ANALOG_CONFIG_t analog = {0, 0, 1, 1, 1, 0};
+static uint8_t stick_shaped; /* Deadzone or curve set, sticks go through the lookup tables */
+static uint8_t stick_axial[STICK_AXIAL_SIZE]; /* Axis magnitude >> 5 to output magnitude 0..128 */
+static uint16_t stick_radial[STICK_RADIAL_SIZE]; /* Squared radius >> 20 to axis scale, 16 bit fraction */
+
+// lookup tables built by build_pad_tables, indexed by one byte of input
+static uint32_t xbox_lut[2][256]; /* Xbox buttons high and low byte to pad button mask */
+static uint16_t press_lut1[256][4]; /* DIGITAL1 byte to PRESS_RIGHT..PRESS_DOWN */
+static uint16_t press_lut2[256][6]; /* DIGITAL2 byte to PRESS_TRIANGLE..PRESS_R1 */
+static uint32_t hid_lut[HID_BUTTONS / 8][256]; /* HID buttons 1..8 and 9..16 to pad button mask */
+
 descriptor_table_t descriptor_table[] = {
   {USB_DESCRIPTOR_TYPE_DEVICE, get_device_desc},
   {USB_DESCRIPTOR_TYPE_CONFIGURATION, get_configration_desc},
@@ -174,12 +653,71 @@ static CellUsbdLddOps xpadw_ops = {
   xpadw_detach
 };
 
+static CellUsbdLddOps hid_ops = {
+  0,
+  hid_probe,
+  hid_attach,
+  hid_detach
+};
+
 static XPAD_t XPAD;
+static XPADW_RECEIVER_t receiver[MAX_XPADW_RECEIVERS];
+static sys_mutex_t receiver_mutex;
+static DEVICE_ENTRY_t device_table[DEVICE_TABLE_SIZE];
+static int32_t device_count;
 static uint8_t xpad_led[4] = {ledOn1, ledOn2, ledOn3, ledOn4};
 static sys_ppu_thread_t thread_id = 1;
-static sys_mutex_t xpad_mutex, ringbuf_mutex;
+static sys_mutex_t xpad_mutex;
+static sys_mutex_t slot_mutex[MAX_XPAD_NUM];
+static sys_event_flag_t xpad_event;
+static uint8_t input_mode = INPUT_MODE_EVENT;
 static int32_t handle[CELL_PAD_MAX_PORT_NUM];
+static uint8_t reg_state[MAX_XPAD_NUM];
+static uint64_t reg_start[MAX_XPAD_NUM]; /* Timebase registration started, cleared at first insert */
+static uint8_t reg_data[MAX_XPAD_NUM][0x114]; /* Filled by the registration syscall after it returns */
+static volatile uint32_t reg_pending; /* Bit per slot in REG_PENDING or REG_CANCEL */
+static volatile uint32_t reg_late; /* Pending bits past REG_TIMEOUT */
+static PAD_IMAGE_t pad_image[MAX_XPAD_NUM];
+static HID_PLAN_t hid_plan[MAX_XPAD_NUM]; /* Extraction plan of the HID unit on each slot */
+static XPAD_STATS_t stats;
+#ifdef XPAD_LATENCY
+static XPAD_LATENCY_t latency;
+#endif
+static uint32_t insert_keepalive = INSERT_KEEPALIVE;
+static uint32_t in_transfers = IN_TRANSFERS;
+static uint32_t poll_period = POLL_IDLE_MAX;
+static uint32_t poll_idle;
+static uint32_t input_changed;
+static uint64_t tb_per_ms;
+static uint8_t stats_pending; /* STATS_COMBO pressed, written once the slots are unlocked */
+#ifdef XPAD_LATENCY
+static uint8_t latency_pending; /* LATENCY_COMBO pressed */
+#endif
+static CAPTURE_t *capture;
+static sys_ppu_thread_t capture_thread_id = (sys_ppu_thread_t)-1;
+static sys_event_flag_t capture_event;
 static volatile uint8_t running;
+static uint32_t config_errors;
+static void *unit_pool_mem;
+static unsigned char *unit_pool;
+static uint32_t unit_pool_stride;
+static volatile uint32_t unit_pool_used;
+static char config_msg[128];
+static REMAP_PROFILE_t *remap_profile[MAX_REMAP]; /* Compiled profiles, NULL when not in the file */
+static REMAP_PROFILE_t * volatile remap; /* Active profile, NULL for none */
+static uint32_t remap_index; /* Active profile number, 0 for none */
+static uint32_t remap_loading; /* Profile being read from the file */
+static uint32_t remap_seen; /* Sources already mapped in the profile being read */
+static uint8_t remap_listed[MAX_REMAP];
+static uint32_t remap_target[MAX_REMAP][REMAP_BUTTONS]; /* Target mask of each source while loading */
+static uint8_t remap_axis[MAX_REMAP][4];
+static TITLE_PROFILE_t *titles; /* Sorted by key */
+static uint32_t title_count;
+static uint32_t title_total; /* Entries allocated */
+static uint32_t title_pid; /* Game process the active title profile belongs to */
+static ANALOG_CONFIG_t analog_default; /* Global settings, restored when the game exits */
+static uint32_t keepalive_default;
+static uint32_t remap_default;
 
 SYS_MODULE_INFO(XPADD, 0, 1, 0);
 SYS_MODULE_START(xpadd_start);
@@ -190,7 +728,7 @@ static inline void _sys_ppu_thread_exit(uint64_t val) {
 }
 
 static inline sys_prx_id_t prx_get_module_id_by_address(void *addr) {
-  system_call_1(461, (uint64_t)(uint32_t)addr);
+  system_call_1(461, (uint64_t)(uintptr_t)addr);
   return((int)p1);
 }
 
@@ -206,45 +744,82 @@ static inline void sys_pad_dbg_ldd_set_data_insert_mode(int32_t handle, uint16_t
   system_call_4(573, handle, addr, mode, addr2);
 }
 
-void *getNIDfunc(const char * vsh_module, uint32_t fnid, int32_t offset) {
+static void vsh_resolve_table(uint32_t table) {
+  uint32_t i, j, k, count, lib_fnid_ptr, lib_func_ptr, fnid;
+  uint32_t *export_stru_ptr;
+  const char *lib_name_ptr;
+  uint8_t want;
+
+  // from webman-MOD source, walks the export stubs once for every wanted NID
+  // still missing, exports found in an earlier pass are kept
+  // export stub: +0x06 export count, +0x10 library name, +0x14 FNID table, +0x18 OPD table
+  for (; *(uint32_t *)(uintptr_t)table != 0; table += 4) {
+    export_stru_ptr = (uint32_t *)(uintptr_t)*(uint32_t *)(uintptr_t)table;
+    lib_name_ptr = (const char *)(uintptr_t)*(uint32_t *)((char *)export_stru_ptr + 0x10);
+
+    // only scan libraries that still have a wanted export
+    want = 0;
+    for (i = 0; i < sizeof(vsh_exports) / sizeof(vsh_exports[0]); i++) {
+      if (*vsh_exports[i].func == NULL && strncmp(vsh_exports[i].lib, lib_name_ptr, strlen(lib_name_ptr)) == 0) {
+        want = 1;
+        break;
+      }
+    }
+    if (!want) {
+      continue;
+    }
+    lib_fnid_ptr = *(uint32_t *)((char *)export_stru_ptr + 0x14);
+    lib_func_ptr = *(uint32_t *)((char *)export_stru_ptr + 0x18);
+    count = *(uint16_t *)((char *)export_stru_ptr + 6);
+    for (j = 0; j < count; j++) {
+      fnid = *(uint32_t *)(uintptr_t)(lib_fnid_ptr + j * 4);
+      for (k = i; k < sizeof(vsh_exports) / sizeof(vsh_exports[0]); k++) {
+        if (vsh_exports[k].fnid == fnid && *vsh_exports[k].func == NULL && strncmp(vsh_exports[k].lib, lib_name_ptr, strlen(lib_name_ptr)) == 0) {
+
+          // take address from OPD
+          *vsh_exports[k].func = (void *)(uintptr_t)*((uint32_t *)(uintptr_t)lib_func_ptr + j);
+        }
+      }
+    }
+  }
+}
 
-  // from webman-MOD source
-  // used to find malloc, free, and show notification
+static void vsh_resolve(void) {
 
   // 0x10000 = ELF
   // 0x10080 = segment 2 start
   // 0x10200 = code start
-
   uint32_t table = (*(uint32_t *)0x1008C) + 0x984; // vsh table address
   //  uint32_t table = (*(uint32_t*)0x1002C) + 0x214 - 0x10000; // vsh table address
   //  uint32_t table = 0x63A9D4;
 
-  while (((uint32_t)*(uint32_t *)table) != 0) {
-    uint32_t *export_stru_ptr = (uint32_t *)*(uint32_t *)table; // ptr to export stub, size 2C, "sys_io" usually... Exports:0000000000635BC0 stru_635BC0:    ExportStub_s <0x1C00, 1, 9, 0x39, 0, 0x2000000, aSys_io, ExportFNIDTa
-    const char *lib_name_ptr =  (const char *)*(uint32_t *)((char *)export_stru_ptr + 0x10);
-    if(strncmp(vsh_module, lib_name_ptr, strlen(lib_name_ptr)) == 0) {
-      // we got the proper export struct
-      uint32_t lib_fnid_ptr = *(uint32_t *)((char *)export_stru_ptr + 0x14);
-      uint32_t lib_func_ptr = *(uint32_t *)((char *)export_stru_ptr + 0x18);
-      uint16_t count = *(uint16_t *)((char *)export_stru_ptr + 6); // number of exports
-      for (int i = 0; i < count; i++) {
-        if (fnid == *(uint32_t *)((char *)lib_fnid_ptr + i*4)) {
-          // take address from OPD
-          return (void **)*((uint32_t *)(lib_func_ptr) + i) + offset;
-        }
-      }
+  // the first pass can run before every vsh module is loaded,
+  // vsh_retry looks for its misses once more after the xmb wait
+  vsh_resolve_table(table);
+  vsh_resolved++;
+}
+
+static void vsh_retry(void) {
+  uint32_t i;
+
+  // a miss after this pass stays NULL
+  if (vsh_resolved >= VSH_RESOLVE_PASSES) {
+    return;
+  }
+  for (i = 0; i < sizeof(vsh_exports) / sizeof(vsh_exports[0]); i++) {
+    if (*vsh_exports[i].func == NULL) {
+      vsh_resolve();
+      return;
     }
-    table = table + 4;
   }
-  return(0);
 }
 
 static void show_msg(char* msg) {
 
   // from webman-MOD
   // displays a notification on the PS3
-  if (!vshtask_notify) {
-    vshtask_notify = (void *)((int)getNIDfunc("vshtask", 0xA02D46E7, 0));
+  if (!vsh_resolved) {
+    vsh_resolve();
   }
   if (strlen(msg) > 200) {
     msg[200] = 0;
@@ -257,8 +832,8 @@ static void show_msg(char* msg) {
 static void *_malloc(unsigned int size) {
 
   // vsh export for malloc
-  if (!vsh_malloc) {
-    vsh_malloc = getNIDfunc("allocator", 0x759E0635, 0);
+  if (!vsh_resolved) {
+    vsh_resolve();
   }
   if (vsh_malloc) {
     return vsh_malloc(size);
@@ -269,8 +844,8 @@ static void *_malloc(unsigned int size) {
 static void _free(void *ptr) {
 
   // vsh export for free
-  if (!vsh_free) {
-    vsh_free = (void *)((int)getNIDfunc("allocator", 0x77A602DD, 0));
+  if (!vsh_resolved) {
+    vsh_resolve();
   }
   if (vsh_free) {
     vsh_free(ptr);
@@ -293,245 +868,2011 @@ static void unblock(sys_mutex_t mutex) {
   }
 }
 
-static void data_transfer_done(int32_t result, int32_t count, void *arg) {
-  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
-  unsigned char *xpadbuf;
-  (void)result;
-  block(ringbuf_mutex);
-  if (unit->rblen < RINGBUF_SIZE) {
-    xpadbuf = &unit->ringbuf[unit->wp][0];
-    xpadbuf[0] = (unsigned char)(++unit->tcount & 0xFF);
-    xpadbuf[1] = (unsigned char)(count & 0xFF);
-    count = (count <= MAX_XPAD_DATA_LEN - 2) ? count : MAX_XPAD_DATA_LEN - 2;
-    memcpy(&xpadbuf[2], unit->data, count);
-    if (++unit->wp >= RINGBUF_SIZE) {
-      unit->wp = 0;
-    }
-    unit->rblen++;
+// start of config file methods
+static char *put_str(char *p, const char *str) {
+  while (*str) {
+    *p++ = *str++;
   }
-  unblock(ringbuf_mutex);
-  data_transfer(unit);
+  *p = 0;
+  return(p);
 }
 
-static void data_transfer(XPAD_UNIT_t *unit) {
-  cellUsbdInterruptTransfer(unit->i_pipe, unit->data, unit->payload, data_transfer_done, unit);
+static char *put_u32(char *p, uint32_t v) {
+  char tmp[10];
+  int32_t n = 0;
+
+  do {
+    tmp[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v);
+  while (n) {
+    *p++ = tmp[--n];
+  }
+  *p = 0;
+  return(p);
 }
 
-static void set_interface_done(int32_t result, int32_t count, void *arg) {
-  (void)result;
-  (void)count;
-  data_transfer((XPAD_UNIT_t *)arg);
+static char *next_token(char **line, char delim) {
+  char *p, *token;
+
+  // split in place at the next delimiter and trim surrounding blanks
+  p = *line;
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+  token = p;
+  while (*p && *p != delim) {
+    p++;
+  }
+  *line = (*p == delim) ? p + 1 : p;
+  while (p > token && (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\r')) {
+    p--;
+  }
+  *p = 0;
+  return(token);
 }
 
-static void set_config_done(int32_t result, int32_t count, void *arg) {
-  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
-  (void)result;
-  (void)count;
-  if (unit->as > 0) {
-    cellUsbdSetInterface(unit->c_pipe, unit->ifnum, unit->as, set_interface_done, unit);
-  } else {
-    data_transfer(unit);
+static int32_t parse_number(const char *p, uint32_t *value) {
+  uint32_t v = 0, base = 10, d;
+
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    base = 16;
+    p += 2;
+  }
+  if (*p == 0) {
+    return(-1);
+  }
+  for (; *p; p++) {
+    if (*p >= '0' && *p <= '9') {
+      d = *p - '0';
+    } else if (base == 16 && (*p | 0x20) >= 'a' && (*p | 0x20) <= 'f') {
+      d = (*p | 0x20) - 'a' + 10;
+    } else {
+      return(-1);
+    }
+    if (v > (0xFFFFFFFF - d) / base) {
+      return(-1);
+    }
+    v = v * base + d;
   }
+  *value = v;
+  return(0);
 }
 
-static void unit_free(XPAD_UNIT_t *unit) {
-  if (unit) {
-    _free(unit);
+static void config_error(const char *path, uint32_t line, const char *why) {
+  char *p;
+
+  // only the first error is kept, it's shown once we're back in xmb
+  if (config_errors++ > 0) {
+    return;
   }
+
+  // ex: "xpad_devices.txt line 12: unknown type"
+  p = put_str(config_msg, path + sizeof(XPAD_DIR) - 1);
+  p = put_str(p, " line ");
+  p = put_u32(p, line);
+  p = put_str(p, ": ");
+  put_str(p, why);
 }
 
-static XPAD_UNIT_t *unit_alloc(int32_t dev_id, int32_t payload, uint8_t ifnum, uint8_t as, uint8_t xtype) {
-  XPAD_UNIT_t *unit;
-  int32_t i;
-  if ((unit = (XPAD_UNIT_t *)_malloc(sizeof(XPAD_UNIT_t) + payload)) != NULL) {
-    memset(unit, 0, sizeof(XPAD_UNIT_t));
-    unit->dev_id = dev_id;
-    unit->payload = payload;
-    unit->ifnum = ifnum;
-    unit->as = as;
-    unit->tcount = 0;
-    unit->rp = 0;
-    unit->wp = 0;
-    unit->rblen = 0;
-    unit->xtype = xtype;
-    if (xtype == XTYPE_XBOX360) {
-      unit->read_input = xpad_read_input;
-      unit->set_led = xpad_set_led;
-      unit->set_rumble = xpad_set_rumble;
-    } else if (xtype == XTYPE_XBOX360W) {
-      unit->read_input = xpadw_read_input;
-      unit->set_led = xpadw_set_led;
-      unit->set_rumble = xpadw_set_rumble;
-    }
-    block(xpad_mutex);
-    unit->number = XPAD.next_number;
-    for (i = 0; i < MAX_XPAD_NUM; i++) {
-      ++XPAD.next_number;
-      if (XPAD.next_number >= MAX_XPAD_NUM) {
-        XPAD.next_number = 0;
+static int32_t config_read(const char *path, const char *(*parse_line)(char *line)) {
+  int32_t fd, len, i;
+  uint32_t line_no, errors;
+  uint64_t nread;
+  const char *why;
+  char chunk[CONFIG_CHUNK], line[CONFIG_LINE];
+
+  // single pass over fixed size chunks, lines are tokenised in place
+  // parse_line returns NULL or the reason the line was rejected
+  if (cellFsOpen(path, CELL_FS_O_RDONLY, &fd, NULL, 0) != CELL_FS_SUCCEEDED) {
+    return(-1);
+  }
+  len = 0;
+  line_no = 1;
+  errors = config_errors;
+  while (cellFsRead(fd, chunk, sizeof(chunk), &nread) == CELL_FS_SUCCEEDED && nread > 0) {
+    for (i = 0; i < (int32_t)nread; i++) {
+      if (chunk[i] != '\n') {
+        if (len < CONFIG_LINE - 1) {
+          line[len] = chunk[i];
+        } else if (len == CONFIG_LINE - 1) {
+          config_error(path, line_no, "line too long");
+        }
+        len++;
+        continue;
       }
-      if (XPAD.con_unit[XPAD.next_number] == NULL) {
-        break;
+      if (len < CONFIG_LINE) {
+        line[len] = 0;
+        if ((why = parse_line(line)) != NULL) {
+          config_error(path, line_no, why);
+        }
       }
+      len = 0;
+      line_no++;
     }
-    unblock(xpad_mutex);
-    if (i >= MAX_XPAD_NUM) {
-      _free(unit);
-      return(NULL);
+  }
+  if (len > 0 && len < CONFIG_LINE) {
+    line[len] = 0;
+    if ((why = parse_line(line)) != NULL) {
+      config_error(path, line_no, why);
     }
   }
-  return(unit);
+  cellFsClose(fd);
+  return(config_errors > errors ? -1 : CELL_OK);
 }
 
-static int32_t register_ldd_controller(XPAD_UNIT_t *unit) {
-  uint8_t data[0x114];
-  int32_t port;
-  uint32_t capability, mode, port_setting;
+static const char *settings_parse_line(char *line) {
+  uint32_t value;
+  char *key, *val;
 
-  // register ldd controller with custom device capability
-  if (handle[unit->number] < 0) {
-    capability = 0xFFFF; // CELL_PAD_CAPABILITY_PS3_CONFORMITY | CELL_PAD_CAPABILITY_PRESS_MODE | CELL_PAD_CAPABILITY_HP_ANALOG_STICK | CELL_PAD_CAPABILITY_ACTUATOR;
-    sys_pad_dbg_ldd_register_controller(data, (int32_t *)&(handle[unit->number]), 5, (uint32_t)capability << 1);
-    //handle[unit->number] = cellPadLddRegisterController();
-    sys_timer_usleep(1000*10); // allow some time for ps3 to register ldd controller
-    if (handle[unit->number] < 0) {
-      return(handle[unit->number]);
+  // KEY = VALUE
+  key = next_token(&line, '=');
+  if (key[0] == '#' || key[0] == 0) {
+    return(NULL);
+  }
+  val = next_token(&line, '#');
+  if (strcmp(key, "input_mode") == 0) {
+    if (strcmp(val, "event") == 0) {
+      input_mode = INPUT_MODE_EVENT;
+    } else if (strcmp(val, "poll") == 0) {
+      input_mode = INPUT_MODE_POLL;
+    } else {
+      return("input_mode must be event or poll");
     }
+  } else if (strcmp(key, "insert_keepalive") == 0) {
+    if (parse_number(val, &value) < 0) {
+      return("insert_keepalive must be a number");
+    }
+    insert_keepalive = value;
+  } else if (strcmp(key, "stick_deadzone") == 0 || strcmp(key, "stick_antideadzone") == 0) {
+    if (parse_number(val, &value) < 0 || value > 99) {
+      return("stick deadzones are a percentage, 0 to 99");
+    }
+    if (key[6] == 'd') {
+      analog.deadzone = value;
+    } else {
+      analog.antideadzone = value;
+    }
+  } else if (strcmp(key, "stick_deadzone_mode") == 0) {
+    if (strcmp(val, "radial") == 0) {
+      analog.radial = 1;
+    } else if (strcmp(val, "axial") == 0) {
+      analog.radial = 0;
+    } else {
+      return("stick_deadzone_mode must be radial or axial");
+    }
+  } else if (strcmp(key, "stick_curve") == 0) {
+    if (parse_number(val, &value) < 0 || value < 1 || value > 3) {
+      return("stick_curve must be 1 (linear), 2 or 3");
+    }
+    analog.curve = value;
+  } else if (strcmp(key, "trigger_threshold") == 0) {
+    if (parse_number(val, &value) < 0 || value < 1 || value > 255) {
+      return("trigger_threshold must be 1 to 255");
+    }
+    analog.trig_on = value;
+  } else if (strcmp(key, "trigger_hysteresis") == 0) {
+    if (parse_number(val, &value) < 0 || value > 254) {
+      return("trigger_hysteresis must be 0 to 254");
+    }
+    analog.trig_hyst = value;
+  } else if (strcmp(key, "remap") == 0) {
+    if (parse_number(val, &value) < 0 || value > MAX_REMAP) {
+      return("remap must be 0 (off) or a remap_setting 1 to 10");
+    }
+    remap_index = value;
+  } else if (strcmp(key, "in_transfers") == 0) {
+    if (parse_number(val, &value) < 0 || value < 1 || value > MAX_IN_FLIGHT) {
+      return("in_transfers must be 1 to 4");
+    }
+    in_transfers = value;
+  } else {
+    return("unknown setting");
+  }
+  return(NULL);
+}
+// end of config file methods
 
-    // all pad data into games
-    mode = CELL_PAD_LDD_INSERT_DATA_INTO_GAME_MODE_ON; // = (1)
-    sys_pad_dbg_ldd_set_data_insert_mode((int32_t)handle[unit->number], 0x100, (uint32_t *)&mode, 4);
+// start of latency methods
+#ifdef XPAD_LATENCY
+static inline uint32_t latency_bucket(uint64_t t) {
+  uint32_t msb;
 
-    // set press and sensor mode on
-    port_setting = CELL_PAD_SETTING_PRESS_ON | CELL_PAD_SETTING_SENSOR_ON;
-    port = cellPadLddGetPortNo(handle[unit->number]);
-    if (port < 0) {
-      return(port);
-    }
-    cellPadSetPortSetting(port, port_setting);
+  // log-linear buckets, exact below 4 ticks then 4 per power of 2
+  if (t < 4) {
+    return((uint32_t)t);
+  }
+  if (t >> 33) {
+    return(LATENCY_BUCKETS - 1);
+  }
+  msb = 63 - __cntlzd(t);
+  return(((msb - 1) << 2) | ((t >> (msb - 2)) & 3));
+}
 
-    // set Xbox led corresponding to port number
-    unit->set_led(unit->number, xpad_led[port%4]);
+static uint64_t latency_bucket_low(uint32_t b) {
+  if (b < 4) {
+    return(b);
   }
-  return(CELL_PAD_OK);
+  return((uint64_t)(4 | (b & 3)) << ((b >> 2) - 1));
 }
 
-static int32_t unregister_ldd_controller(XPAD_UNIT_t *unit) {
-  int32_t r;
+static inline void latency_dequeue(int32_t id, uint64_t done) {
+  uint64_t t = __mftb() - done;
 
-  if (handle[unit->number] >= 0) {
-    if ((r = cellPadLddUnregisterController(handle[unit->number])) != CELL_OK) {
-      return(r);
-    }
-    //xpad_set_led(unit->number, xpad_led[ledBlinkingAll]);
-    handle[unit->number] = -1;
+  latency.done[id] = done;
+  latency.reports[id]++;
+  latency.queue[id][latency_bucket(t)]++;
+  if (t > latency.queue_max[id]) {
+    latency.queue_max[id] = t;
   }
-  return(CELL_PAD_OK);
 }
 
-void usb_done_cb(int32_t result, int32_t count, void *arg) {
-  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
+static inline void latency_insert(int32_t id) {
+  uint64_t t = __mftb() - latency.done[id];
 
-  // do nothing
+  latency.total[id][latency_bucket(t)]++;
+  if (t > latency.total_max[id]) {
+    latency.total_max[id] = t;
+  }
 }
 
-static int32_t write_xpad(int32_t id, uint8_t *data, int32_t len) {
-  int32_t r;
-  XPAD_UNIT_t *unit;
-
-  unit = XPAD.con_unit[id];
-  r = cellUsbdInterruptTransfer(unit->o_pipe, data, len, usb_done_cb, unit);
-  return(r);
+static uint32_t latency_us(uint64_t t) {
+  return((uint32_t)(t * 1000 / tb_per_ms));
 }
 
-// start of wired controller specific methods
-static int32_t xpad_probe(int32_t dev_id) {
-  uint16_t idVendor, idProduct;
-  uint32_t i;
-  UsbDeviceDescriptor *ddesc;
-  UsbInterfaceDescriptor *idesc;
+static uint32_t latency_percentile(uint32_t *hist, uint32_t pct) {
+  uint32_t b, n, sum;
 
-  block(xpad_mutex);
-  if (XPAD.n >= MAX_XPAD_NUM) {
-    unblock(xpad_mutex);
-    return(CELL_USBD_PROBE_FAILED);
+  for (b = 0, n = 0; b < LATENCY_BUCKETS; b++) {
+    n += hist[b];
   }
-  unblock(xpad_mutex);
-  if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) == NULL) {
-    return(CELL_USBD_PROBE_FAILED);
+  if (n == 0) {
+    return(0);
   }
-  idesc = (UsbInterfaceDescriptor *)ddesc;
-  if ((idesc = (UsbInterfaceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
-    return(CELL_USBD_PROBE_FAILED);
+  for (b = 0, sum = 0; b < LATENCY_BUCKETS; b++) {
+    sum += hist[b];
+    if ((uint64_t)sum * 100 >= (uint64_t)n * pct) {
+      break;
+    }
   }
+  return(latency_us(latency_bucket_low(b)));
+}
 
-  // make sure product id and vendor id are valid
-  idVendor = SWAP16(ddesc->idVendor);
-  idProduct = SWAP16(ddesc->idProduct);
-  for (i = 0; i < MAX_XPAD_DEV_NUM; i++) {
-    if (xpad_info[i].vid == idVendor && xpad_info[i].pid == idProduct) {
-      return(CELL_USBD_PROBE_SUCCEEDED);
+static char *latency_line(char *p, int32_t id, uint64_t elapsed) {
+
+  // ex: "Port 1: 250 Hz, queue 12/40/80 us, insert 20/52/95 us"
+  // p50 and p99 are bucket lower bounds, max is exact
+  p = put_str(p, "Port ");
+  p = put_u32(p, id + 1);
+  p = put_str(p, ": ");
+  p = put_u32(p, elapsed ? (uint32_t)((uint64_t)latency.reports[id] * tb_per_ms * 1000 / elapsed) : 0);
+  p = put_str(p, " Hz, queue ");
+  p = put_u32(p, latency_percentile(latency.queue[id], 50));
+  p = put_str(p, "/");
+  p = put_u32(p, latency_percentile(latency.queue[id], 99));
+  p = put_str(p, "/");
+  p = put_u32(p, latency_us(latency.queue_max[id]));
+  p = put_str(p, " us, insert ");
+  p = put_u32(p, latency_percentile(latency.total[id], 50));
+  p = put_str(p, "/");
+  p = put_u32(p, latency_percentile(latency.total[id], 99));
+  p = put_str(p, "/");
+  p = put_u32(p, latency_us(latency.total_max[id]));
+  p = put_str(p, " us");
+  return(p);
+}
+
+static void latency_report(void) {
+  int32_t i, fd;
+  uint32_t b;
+  uint64_t elapsed, written;
+  char line[200], *p;
+
+  // one notification per port in use, full histograms go to LATENCY_FILE
+  elapsed = __mftb() - latency.since;
+  if (cellFsOpen(LATENCY_FILE, CELL_FS_O_WRONLY | CELL_FS_O_CREAT | CELL_FS_O_TRUNC, &fd, NULL, 0) != CELL_FS_SUCCEEDED) {
+    fd = -1;
+  }
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    if (latency.reports[i] == 0) {
+      continue;
+    }
+    p = latency_line(line, i, elapsed);
+    show_msg(line);
+    if (fd < 0) {
+      continue;
+    }
+    *p++ = '\n';
+    cellFsWrite(fd, line, p - line, &written);
+    for (b = 0; b < LATENCY_BUCKETS; b++) {
+      if (latency.queue[i][b] == 0 && latency.total[i][b] == 0) {
+        continue;
+      }
+
+      // ex: "  >= 12 us: 340 queue, 12 insert"
+      p = put_str(line, "  >= ");
+      p = put_u32(p, latency_us(latency_bucket_low(b)));
+      p = put_str(p, " us: ");
+      p = put_u32(p, latency.queue[i][b]);
+      p = put_str(p, " queue, ");
+      p = put_u32(p, latency.total[i][b]);
+      p = put_str(p, " insert\n");
+      cellFsWrite(fd, line, p - line, &written);
     }
   }
-  return(CELL_USBD_PROBE_FAILED);
+  if (fd >= 0) {
+    cellFsClose(fd);
+  }
 }
+#endif
+// end of latency methods
 
-static int32_t xpad_attach(int32_t dev_id) {
-  int32_t payload, port;
-  uint32_t mode, port_setting;
-  UsbConfigurationDescriptor *cdesc;
-  UsbInterfaceDescriptor *idesc;
-  UsbEndpointDescriptor *edesc;
+// start of stats methods
+static char *stats_port(char *p, int32_t i) {
   XPAD_UNIT_t *unit;
 
-  if ((cdesc = (UsbConfigurationDescriptor *) cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_CONFIGURATION)) == NULL) {
-    return (CELL_USBD_ATTACH_FAILED);
-  }
-  idesc = (UsbInterfaceDescriptor *)cdesc;
-  if ((idesc = (UsbInterfaceDescriptor *) cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
-    return(CELL_USBD_ATTACH_FAILED);
+  // ex: "Port 1: 250 reads/s, 1200 inserted, 3400 unchanged, registered 800 us, first insert 12000 us, 0 skipped, 0 dropped, 2 merged"
+  // the unit is only read while its slot is locked and still connected
+  p = put_str(p, "Port ");
+  p = put_u32(p, i + 1);
+  p = put_str(p, ": ");
+  p = put_u32(p, stats.read_rate[i]);
+  p = put_str(p, " reads/s, ");
+  p = put_u32(p, stats.inserts_issued[i]);
+  p = put_str(p, " inserted, ");
+  p = put_u32(p, stats.inserts_suppressed[i]);
+  p = put_str(p, " unchanged, registered ");
+  p = put_u32(p, stats.reg_wait_us[i]);
+  p = put_str(p, " us, first insert ");
+  p = put_u32(p, stats.first_insert_us[i]);
+  p = put_str(p, " us");
+  block(slot_mutex[i]);
+  if ((XPAD.connected & (1 << i)) && (unit = XPAD.con_unit[i]) != NULL) {
+    p = put_str(p, ", ");
+    p = put_u32(p, unit->skipped);
+    p = put_str(p, " skipped, ");
+    p = put_u32(p, unit->dropped);
+    p = put_str(p, " dropped, ");
+    p = put_u32(p, unit->out_merged);
+    p = put_str(p, " merged");
   }
-  if ((edesc = (UsbEndpointDescriptor *) cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_ENDPOINT)) == NULL) {
-    return(CELL_USBD_ATTACH_FAILED);
+  unblock(slot_mutex[i]);
+  return(p);
+}
+
+static void stats_report(void) {
+  int32_t i, fd;
+  uint64_t written;
+  char line[256], *p;
+
+  // PS + START, a notification per connected port, everything goes to STATS_FILE
+  if (cellFsOpen(STATS_FILE, CELL_FS_O_WRONLY | CELL_FS_O_CREAT | CELL_FS_O_TRUNC, &fd, NULL, 0) != CELL_FS_SUCCEEDED) {
+    fd = -1;
   }
-  if (edesc->bEndpointAddress != 0x81) { // XBox 360 controller In endpoint
-    return(CELL_USBD_ATTACH_FAILED);
+
+  // ex: "Units 2 in use, 3 most, 0 refused, queue depth 16, poll 4 ms, 0 registrations failed, 0 HID failed"
+  p = put_str(line, "Units ");
+  p = put_u32(p, stats.units_in_use);
+  p = put_str(p, " in use, ");
+  p = put_u32(p, stats.units_high_water);
+  p = put_str(p, " most, ");
+  p = put_u32(p, stats.unit_alloc_failed);
+  p = put_str(p, " refused, queue depth ");
+  p = put_u32(p, stats.queue_depth_high_water);
+  p = put_str(p, ", poll ");
+  p = put_u32(p, stats.poll_period);
+  p = put_str(p, " ms, ");
+  p = put_u32(p, stats.reg_failed);
+  p = put_str(p, " registrations failed, ");
+  p = put_u32(p, stats.hid_failed);
+  p = put_str(p, " HID failed\n");
+  if (fd >= 0) {
+    cellFsWrite(fd, line, p - line, &written);
   }
-  payload = SWAP16(edesc->wMaxPacketSize);
-  if ((unit = unit_alloc(dev_id, payload, idesc->bInterfaceNumber, idesc->bAlternateSetting, XTYPE_XBOX360)) == NULL) {
-    return(CELL_USBD_ATTACH_FAILED);
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    if (!(XPAD.connected & (1 << i)) && stats.inserts_issued[i] == 0) {
+      continue;
+    }
+    p = stats_port(line, i);
+    if (XPAD.connected & (1 << i)) {
+      show_msg(line);
+    }
+    *p++ = '\n';
+    if (fd >= 0) {
+      cellFsWrite(fd, line, p - line, &written);
+    }
   }
-  if ((unit->c_pipe = cellUsbdOpenPipe(dev_id, NULL)) < 0) {
-    unit_free(unit);
-    return(CELL_USBD_ATTACH_FAILED);
+  if (fd >= 0) {
+    cellFsClose(fd);
   }
-  if ((unit->i_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
-    unit_free(unit);
-    return(CELL_USBD_ATTACH_FAILED);
+}
+// end of stats methods
+
+// start of capture methods
+static inline unsigned char *put_varint(unsigned char *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (unsigned char)(v | 0x80);
+    v >>= 7;
   }
-  edesc->bEndpointAddress = 0x01; // XBox 360 controller out endpoint
-  if ((unit->o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
-    edesc->bEndpointAddress = 0x02; // It is 0x02 for some controllers
-    if ((unit->o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
-      unit_free(unit);
-      return(CELL_USBD_ATTACH_FAILED);
+  *p++ = (unsigned char)v;
+  return(p);
+}
+
+static void capture_writer(uint64_t arg) {
+  uint64_t bits, written;
+  uint32_t i;
+
+  // background thread, writes buffers handed over by capture_record
+  while (1) {
+    bits = 0;
+    sys_event_flag_wait(capture_event, 0x3 | CAPTURE_EVENT_STOP, SYS_EVENT_FLAG_WAIT_OR | SYS_EVENT_FLAG_WAIT_CLEAR, &bits, 0);
+    for (i = 0; i < 2; i++) {
+      if (capture->full[i]) {
+        cellFsWrite(capture->fd, capture->buf[i], capture->len[i], &written);
+        capture->len[i] = 0;
+        __lwsync();
+        capture->full[i] = 0;
+      }
+    }
+    if (bits & CAPTURE_EVENT_STOP) {
+
+      // usb is shut down by now, flush what is left in the active buffer
+      i = capture->active;
+      if (!capture->full[i] && capture->len[i] > 0) {
+        cellFsWrite(capture->fd, capture->buf[i], capture->len[i], &written);
+      }
+      break;
     }
   }
+  sys_ppu_thread_exit(0);
+}
 
-  // endpoint found, set configuration and add to connected controllers list
+static int32_t capture_start(void) {
+  int32_t r, i;
+  uint64_t written, freq;
+  unsigned char header[13];
+  CellFsStat st;
+  CAPTURE_t *cap;
+  sys_event_flag_attribute_t event_attr;
+
+  if (cellFsStat(CAPTURE_FLAG, &st) != CELL_FS_SUCCEEDED) {
+    return(CELL_OK);
+  }
+  if ((cap = (CAPTURE_t *)_malloc(sizeof(CAPTURE_t))) == NULL) {
+    return(-1);
+  }
+  memset(cap, 0, sizeof(CAPTURE_t) - sizeof(cap->buf));
+  if ((r = cellFsOpen(CAPTURE_FILE, CELL_FS_O_WRONLY | CELL_FS_O_CREAT | CELL_FS_O_TRUNC, &cap->fd, NULL, 0)) != CELL_FS_SUCCEEDED) {
+    _free(cap);
+    return(r);
+  }
+  freq = sys_time_get_timebase_frequency();
+  header[0] = (CAPTURE_MAGIC >> 24) & 0xFF;
+  header[1] = (CAPTURE_MAGIC >> 16) & 0xFF;
+  header[2] = (CAPTURE_MAGIC >> 8) & 0xFF;
+  header[3] = CAPTURE_MAGIC & 0xFF;
+  header[4] = CAPTURE_VERSION;
+  for (i = 0; i < 8; i++) {
+    header[5 + i] = (unsigned char)(freq >> (56 - i * 8));
+  }
+  cellFsWrite(cap->fd, header, sizeof(header), &written);
+  sys_event_flag_attribute_initialize(event_attr);
+  if ((r = sys_event_flag_create(&capture_event, &event_attr, 0)) != CELL_OK) {
+    cellFsClose(cap->fd);
+    _free(cap);
+    return(r);
+  }
+
+  // publish last, usb callbacks may already be running
+  capture = cap;
+  __lwsync();
+  sys_ppu_thread_create(&capture_thread_id, capture_writer, 0, 3000, 0x1000, SYS_PPU_THREAD_CREATE_JOINABLE, CAPTURE_THREAD_NAME);
+  return(CELL_OK);
+}
+
+static void capture_stop(void) {
+  uint64_t exit_code;
+  CAPTURE_t *cap;
+
+  if (capture == NULL) {
+    return;
+  }
+  sys_event_flag_set(capture_event, CAPTURE_EVENT_STOP);
+  if (capture_thread_id != (sys_ppu_thread_t)-1) {
+    sys_ppu_thread_join(capture_thread_id, &exit_code);
+    capture_thread_id = (sys_ppu_thread_t)-1;
+  }
+  cap = capture;
+  capture = NULL;
+  cellFsClose(cap->fd);
+  sys_event_flag_destroy(capture_event);
+  _free(cap);
+}
+
+static void capture_record(XPAD_UNIT_t *unit, unsigned char *buf, int32_t count) {
+  uint32_t b;
+  uint64_t now;
+  unsigned char *p;
+
+  // called from the USB callback, never waits for the writer
+  // if both buffers are still being written the record is dropped
+  now = __mftb();
+  b = capture->active;
+  if (capture->len[b] + CAPTURE_MAX_RECORD > CAPTURE_BUF_SIZE) {
+    __lwsync();
+    capture->full[b] = 1;
+    sys_event_flag_set(capture_event, 1ULL << b);
+    b ^= 1;
+    capture->active = b;
+  }
+  if (capture->full[b]) {
+    capture->dropped++;
+    return;
+  }
+  count = (count <= unit->payload) ? count : unit->payload;
+  p = &capture->buf[b][capture->len[b]];
+  p = put_varint(p, now - capture->last_tb);
+  p = put_varint(p, (uint32_t)unit->conf.dev_id);
+  *p++ = unit->conf.ifnum;
+  *p++ = unit->xtype;
+  *p++ = (unsigned char)count;
+  memcpy(p, buf, count);
+  capture->len[b] = (p + count) - &capture->buf[b][0];
+  capture->last_tb = now;
+}
+// end of capture methods
+
+static inline unsigned char *report_slot(XPAD_UNIT_t *unit, uint32_t slot) {
+  return(unit->slots + slot * unit->slot_len);
+}
+
+static void report_fill(XPAD_UNIT_t *unit, unsigned char *xpadbuf, unsigned char *buf, int32_t count) {
+#ifdef XPAD_LATENCY
+  uint64_t now = __mftb();
+  memcpy(xpadbuf, &now, SLOT_STAMP_LEN);
+#endif
+  xpadbuf += SLOT_STAMP_LEN;
+  xpadbuf[0] = (unsigned char)(++unit->tcount & 0xFF);
+  xpadbuf[1] = (unsigned char)(count & 0xFF);
+  count = (count <= unit->payload) ? count : unit->payload;
+  memcpy(&xpadbuf[2], buf, count);
+}
+
+static uint64_t report_done(XPAD_UNIT_t *unit, unsigned char *buf, int32_t count) {
+  uint32_t h, old;
+  int32_t n;
+
+  if (capture) {
+    capture_record(unit, buf, count);
+  }
+
+  // wireless link status must survive the reports that follow it,
+  // a linked pad may not have a port yet so it wakes the link handler
+  if (unit->xtype == XTYPE_XBOX360W && buf[0] == 0x08) {
+    cellAtomicStore32((uint32_t *)&unit->link, buf[1] | LINK_PENDING);
+    return(XPAD_EVENT_LINK);
+  }
+
+  // runs on the usb thread, never takes a lock shared with the input thread
+  if (unit->rmode == REPORT_MODE_QUEUE) {
+    h = unit->head;
+    if (h - unit->tail < unit->depth) {
+      report_fill(unit, report_slot(unit, h & (unit->depth - 1)), buf, count);
+      __lwsync(); // slot contents visible before the new head
+      unit->head = h + 1;
+    } else {
+      unit->dropped++;
+    }
+  } else {
+
+    // fill the writer's slot, then publish it as the latest report
+    report_fill(unit, report_slot(unit, unit->back), buf, count);
+    __lwsync();
+    old = cellAtomicStore32((uint32_t *)&unit->mid, unit->back | SLOT_FRESH);
+    unit->back = old & SLOT_INDEX;
+    if (old & SLOT_FRESH) {
+      unit->skipped++;
+    }
+  }
+
+  // one bit per controller number, none for a wireless unit without a port
+  n = unit->number;
+  return((n >= 0) ? (1ULL << n) : 0);
+}
+
+static void data_transfer_done(int32_t result, int32_t count, void *arg) {
+  XPAD_XFER_t *xfer = (XPAD_XFER_t *)arg;
+  XPAD_UNIT_t *unit = xfer->unit;
+  uint64_t events = 0;
+  (void)result;
+
+  // a transfer that finishes ahead of an older one waits for it,
+  // each one handled is queued again right away with the next free sequence number
+  xfer->count = count;
+  xfer->done = 1;
+  while (1) {
+    xfer = &unit->xfer[unit->next_seq % unit->xfers];
+    if (!xfer->done || xfer->seq != unit->next_seq) {
+      break;
+    }
+    xfer->done = 0;
+    events |= report_done(unit, xfer->buf, xfer->count);
+    unit->next_seq++;
+    xfer->seq += unit->xfers;
+    cellUsbdInterruptTransfer(unit->i_pipe, xfer->buf, unit->payload, data_transfer_done, xfer);
+  }
+
+  // wake input thread, link changes are handled in polling mode too
+  if (input_mode == INPUT_MODE_POLL) {
+    events &= XPAD_EVENT_LINK;
+  }
+  if (events) {
+    sys_event_flag_set(xpad_event, events);
+  }
+}
+
+static void data_transfer(XPAD_UNIT_t *unit) {
+  uint32_t i;
+
+  // keep several transfers queued so the device never waits for a resubmit
+  unit->next_seq = 0;
+  for (i = 0; i < unit->xfers; i++) {
+    unit->xfer[i].unit = unit;
+    unit->xfer[i].seq = i;
+    unit->xfer[i].done = 0;
+    unit->xfer[i].buf = unit->data + i * ((unit->payload + 7) & ~7);
+    cellUsbdInterruptTransfer(unit->i_pipe, unit->xfer[i].buf, unit->payload, data_transfer_done, &unit->xfer[i]);
+  }
+}
+
+static int32_t report_get(XPAD_UNIT_t *unit, unsigned char *p) {
+  uint32_t t, old;
+  unsigned char *slot;
+#ifdef XPAD_LATENCY
+  uint64_t done;
+#endif
+
+  if (unit->rmode == REPORT_MODE_QUEUE) {
+    t = unit->tail;
+    if (unit->head == t) {
+      return(0);
+    }
+    __lwsync(); // read the slot only after seeing the new head
+    slot = report_slot(unit, t & (unit->depth - 1));
+    memcpy(p, slot + SLOT_STAMP_LEN, unit->payload + 2);
+#ifdef XPAD_LATENCY
+    memcpy(&done, slot, SLOT_STAMP_LEN);
+#endif
+    __lwsync(); // done with the slot before handing it back
+    unit->tail = t + 1;
+  } else {
+
+    // take the latest report, the writer never touches the front slot
+    if (!(unit->mid & SLOT_FRESH)) {
+      return(0);
+    }
+    old = cellAtomicStore32((uint32_t *)&unit->mid, unit->front);
+    unit->front = old & SLOT_INDEX;
+    __lwsync();
+    slot = report_slot(unit, unit->front);
+    memcpy(p, slot + SLOT_STAMP_LEN, unit->payload + 2);
+#ifdef XPAD_LATENCY
+    memcpy(&done, slot, SLOT_STAMP_LEN);
+#endif
+  }
+#ifdef XPAD_LATENCY
+  latency_dequeue(unit->number, done);
+#endif
+  return(1);
+}
+
+static int32_t report_get_link(XPAD_UNIT_t *unit) {
+  uint32_t link;
+
+  if (!(unit->link & LINK_PENDING)) {
+    return(-1);
+  }
+  link = cellAtomicStore32((uint32_t *)&unit->link, 0);
+  return((link & LINK_PENDING) ? (int32_t)(link & 0xFF) : -1);
+}
+
+static uint32_t queue_depth(uint8_t interval) {
+  uint32_t n, depth;
+
+  // enough slots to hold every report sent during the longest polling period,
+  // plus one being read and one being written
+  if (interval == 0) {
+    interval = 1;
+  }
+  n = (POLL_IDLE_MAX + interval - 1) / interval + 2;
+  for (depth = 2; depth < n && depth < MAX_QUEUE_DEPTH; depth <<= 1);
+  return(depth);
+}
+
+static void set_interface_done(int32_t result, int32_t count, void *arg) {
+  (void)result;
+  (void)count;
+  data_transfer((XPAD_UNIT_t *)arg);
+}
+
+static void set_config_done(int32_t result, int32_t count, void *arg) {
+  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
+  (void)result;
+  (void)count;
+  if (unit->conf.as > 0) {
+    cellUsbdSetInterface(unit->conf.c_pipe, unit->conf.ifnum, unit->conf.as, set_interface_done, unit);
+  } else {
+    data_transfer(unit);
+  }
+}
+
+// start of unit pool methods
+static inline uint32_t bit_count(uint32_t v) {
+  v = v - ((v >> 1) & 0x55555555);
+  v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+  return((((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+}
+
+static int32_t unit_pool_init(void) {
+
+  // every unit slot is sized for the largest payload, the configured transfers
+  // and the deepest queue, the one of a 1 ms endpoint, or a report descriptor
+  // reserved once so attach and detach never touch the vsh heap
+  unit_pool_stride = UNIT_POOL_STRIDE(in_transfers, queue_depth(1));
+  if ((unit_pool_mem = _malloc(UNIT_POOL_SIZE * unit_pool_stride + 127)) == NULL) {
+    return(-1);
+  }
+  unit_pool = (unsigned char *)(((uintptr_t)unit_pool_mem + 127) & ~(uintptr_t)127);
+  unit_pool_used = 0;
+  return(CELL_OK);
+}
+
+static void unit_pool_destroy(void) {
+  if (unit_pool_mem) {
+    _free(unit_pool_mem);
+    unit_pool_mem = NULL;
+    unit_pool = NULL;
+  }
+}
+
+static XPAD_UNIT_t *unit_pool_get(void) {
+  uint32_t used, i, n;
+
+  // one bit per slot, claimed with compare and swap
+  do {
+    used = unit_pool_used;
+    if (~used >> (32 - UNIT_POOL_SIZE) == 0) {
+      stats.unit_alloc_failed++;
+      return(NULL);
+    }
+    i = __cntlzw(~used);
+  } while (cellAtomicCompareAndSwap32((uint32_t *)&unit_pool_used, used, used | (0x80000000 >> i)) != used);
+  n = bit_count(used) + 1;
+  stats.units_in_use = n;
+  if (n > stats.units_high_water) {
+    stats.units_high_water = n;
+  }
+  return((XPAD_UNIT_t *)(unit_pool + i * unit_pool_stride));
+}
+
+static void unit_pool_put(XPAD_UNIT_t *unit) {
+  uint32_t i, used;
+
+  i = ((unsigned char *)unit - unit_pool) / unit_pool_stride;
+  used = cellAtomicAnd32((uint32_t *)&unit_pool_used, ~(0x80000000 >> i));
+  stats.units_in_use = bit_count(used) - 1;
+}
+// end of unit pool methods
+
+static int32_t slot_take(XPAD_UNIT_t *unit) {
+  int32_t i, n;
+
+  // take the next free number and reserve its slot
+  block(xpad_mutex);
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    n = (XPAD.next_number + i) % MAX_XPAD_NUM;
+    if (XPAD.con_unit[n] == NULL) {
+      XPAD.con_unit[n] = unit;
+      XPAD.next_number = (n + 1) % MAX_XPAD_NUM;
+      unit->number = n;
+      break;
+    }
+  }
+  unblock(xpad_mutex);
+  return((i < MAX_XPAD_NUM) ? CELL_OK : -1);
+}
+
+static void slot_release(XPAD_UNIT_t *unit) {
+  block(xpad_mutex);
+  if (unit->number >= 0 && XPAD.con_unit[unit->number] == unit) {
+    XPAD.con_unit[unit->number] = NULL;
+  }
+  unit->number = -1;
+  unblock(xpad_mutex);
+}
+
+static inline int32_t slot_next(uint32_t *bits) {
+  int32_t i;
+
+  // lowest set bit first, so live slots are still served in order
+  i = 31 - __cntlzw(*bits & -*bits);
+  *bits &= *bits - 1;
+  return(i);
+}
+
+static void unit_free(XPAD_UNIT_t *unit) {
+  if (unit) {
+    slot_release(unit);
+    unit_pool_put(unit);
+  }
+}
+
+static void slot_connect(XPAD_UNIT_t *unit, uint8_t reg) {
+  int32_t n = unit->number;
+
+  // registration completes later on the input thread
+  if (reg) {
+    block(slot_mutex[n]);
+    register_ldd_controller(unit);
+    unblock(slot_mutex[n]);
+  }
+  block(xpad_mutex);
+  XPAD.n++;
+  unblock(xpad_mutex);
+  cellAtomicOr32((uint32_t *)&XPAD.connected, 1 << n);
+}
+
+static void slot_disconnect(XPAD_UNIT_t *unit) {
+  int32_t n = unit->number;
+
+  // stop new reads, then wait for one in progress on this slot only
+  cellAtomicAnd32((uint32_t *)&XPAD.connected, ~(1 << n));
+  block(slot_mutex[n]);
+  unregister_ldd_controller(unit);
+  unblock(slot_mutex[n]);
+  block(xpad_mutex);
+  XPAD.n--;
+  unblock(xpad_mutex);
+}
+
+static XPAD_UNIT_t *unit_alloc(int32_t dev_id, int32_t payload, uint8_t interval, uint8_t ifnum, uint8_t as, uint8_t xtype, uint8_t rmode) {
+  XPAD_UNIT_t *unit;
+  int32_t data_len, slot_len;
+  uint32_t depth;
+
+  // slots are sized from the endpoint, queue depth from its polling interval
+  if (payload <= 0 || payload > MAX_XPAD_PAYLOAD) {
+    return(NULL);
+  }
+  data_len = (payload + 7) & ~7;
+  slot_len = (SLOT_STAMP_LEN + payload + 2 + 7) & ~7;
+  depth = (rmode == REPORT_MODE_QUEUE) ? queue_depth(interval) : 3;
+  if (depth > stats.queue_depth_high_water) {
+    stats.queue_depth_high_water = depth;
+  }
+  if ((unit = unit_pool_get()) != NULL) {
+    memset(unit, 0, sizeof(XPAD_UNIT_t));
+    unit->conf.dev_id = dev_id;
+    unit->payload = payload;
+    unit->conf.ifnum = ifnum;
+    unit->conf.as = as;
+    unit->tcount = 0;
+    unit->xfers = in_transfers;
+    unit->slots = unit->data + in_transfers * data_len;
+    unit->slot_len = slot_len;
+    unit->depth = depth;
+    unit->head = 0;
+    unit->tail = 0;
+    unit->front = 0;
+    unit->mid = 1;
+    unit->back = 2;
+    unit->xtype = xtype;
+    unit->rmode = rmode;
+    unit->conf.interval = interval;
+    if (xtype == XTYPE_XBOX360) {
+      unit->read_input = xpad_read_input;
+      unit->conf.out_report = xpad_out_report;
+    } else if (xtype == XTYPE_XBOX360W) {
+      unit->read_input = xpadw_read_input;
+      unit->conf.out_report = xpadw_out_report;
+    } else if (xtype == XTYPE_HID) {
+      unit->read_input = hid_read_input;
+      unit->conf.out_report = hid_out_report;
+    } else if (xtype == PTYPE_PS3 || xtype == PTYPE_PS4) {
+      unit->read_input = ds_read_input;
+      unit->conf.out_report = hid_out_report;
+    }
+
+    // wired pads reserve their slot right away, wireless ones once they link
+    unit->number = -1;
+    if (xtype != XTYPE_XBOX360W && slot_take(unit) < 0) {
+      unit_pool_put(unit);
+      return(NULL);
+    }
+  }
+  return(unit);
+}
+
+// start of registration methods
+static int32_t register_ldd_controller(XPAD_UNIT_t *unit) {
+  int32_t n = unit->number;
+  uint32_t capability;
+
+  // register ldd controller with custom device capability, the handle shows up
+  // some time after the syscall returns and register_poll finishes the job
+  // called with the slot locked
+  if (reg_state[n] == REG_CANCEL) {
+    reg_state[n] = REG_PENDING;
+    reg_start[n] = __mftb();
+    cellAtomicAnd32((uint32_t *)&reg_late, ~(1 << n));
+    return(CELL_PAD_OK);
+  }
+  if (handle[n] < 0 && reg_state[n] == REG_IDLE) {
+    capability = 0xFFFF; // CELL_PAD_CAPABILITY_PS3_CONFORMITY | CELL_PAD_CAPABILITY_PRESS_MODE | CELL_PAD_CAPABILITY_HP_ANALOG_STICK | CELL_PAD_CAPABILITY_ACTUATOR;
+    reg_state[n] = REG_PENDING;
+    reg_start[n] = __mftb();
+    cellAtomicOr32((uint32_t *)&reg_pending, 1 << n);
+    sys_pad_dbg_ldd_register_controller(reg_data[n], (int32_t *)&(handle[n]), 5, (uint32_t)capability << 1);
+    //handle[n] = cellPadLddRegisterController();
+  }
+  return(CELL_PAD_OK);
+}
+
+static void register_poll(int32_t n, XPAD_UNIT_t *unit) {
+  int32_t h, port;
+  uint32_t mode, port_setting;
+  uint64_t now;
+
+  // called with the slot locked while its registration is pending
+  now = __mftb();
+  h = *(volatile int32_t *)&handle[n];
+  if (h < 0) {
+
+    // the handle can still show up, the slot stays pending so a late one is
+    // used or released through unregister, it's only checked less often
+    if (!(reg_late & (1 << n)) && now - reg_start[n] >= REG_TIMEOUT * tb_per_ms) {
+      stats.reg_failed += (reg_state[n] == REG_PENDING);
+      cellAtomicOr32((uint32_t *)&reg_late, 1 << n);
+    }
+    return;
+  }
+  cellAtomicAnd32((uint32_t *)&reg_pending, ~(1 << n));
+  cellAtomicAnd32((uint32_t *)&reg_late, ~(1 << n));
+  if (reg_state[n] == REG_CANCEL || unit == NULL) {
+    cellPadLddUnregisterController(h);
+    handle[n] = -1;
+    reg_state[n] = REG_IDLE;
+    return;
+  }
+  stats.reg_wait_us[n] = (uint32_t)((now - reg_start[n]) * 1000 / tb_per_ms);
+  reg_state[n] = REG_READY;
+
+  // all pad data into games
+  mode = CELL_PAD_LDD_INSERT_DATA_INTO_GAME_MODE_ON; // = (1)
+  sys_pad_dbg_ldd_set_data_insert_mode(h, 0x100, (uint32_t *)&mode, 4);
+
+  pad_image_reset(n);
+
+  // set press and sensor mode on, a pad without a port number yet
+  // keeps the default settings and gets the led of its slot
+  port_setting = CELL_PAD_SETTING_PRESS_ON | CELL_PAD_SETTING_SENSOR_ON;
+  if ((port = cellPadLddGetPortNo(h)) >= 0) {
+    cellPadSetPortSetting(port, port_setting);
+  } else {
+    port = n;
+  }
+
+  // set Xbox led corresponding to port number
+  out_set_led(unit, xpad_led[port%4]);
+}
+
+static int32_t unregister_ldd_controller(XPAD_UNIT_t *unit) {
+  int32_t r, n = unit->number;
+
+  // a registration still in flight is dropped once its handle shows up
+  if (reg_state[n] == REG_PENDING) {
+    reg_state[n] = REG_CANCEL;
+    return(CELL_PAD_OK);
+  }
+  if (handle[n] >= 0) {
+    if ((r = cellPadLddUnregisterController(handle[n])) != CELL_OK) {
+      return(r);
+    }
+    //out_set_led(unit, xpad_led[ledBlinkingAll]);
+    handle[n] = -1;
+    pad_image_reset(n);
+  }
+  reg_state[n] = REG_IDLE;
+  return(CELL_PAD_OK);
+}
+// end of registration methods
+
+// start of output scheduler methods
+static void out_done(int32_t result, int32_t count, void *arg);
+
+static inline uint32_t out_ready(XPAD_UNIT_t *unit) {
+  return(unit->out_pending & OUT_LED);
+}
+
+static void out_send(XPAD_UNIT_t *unit) {
+  uint32_t what;
+  int32_t len;
+
+  // called with out_busy held, releases it once there is nothing left to send
+  while (1) {
+    if ((what = out_ready(unit)) != 0) {
+      cellAtomicAnd32((uint32_t *)&unit->out_pending, ~what);
+      __lwsync();
+
+      // a device without an out endpoint fills nothing
+      len = unit->conf.out_report(unit, what);
+      if (len > 0 && cellUsbdInterruptTransfer(unit->conf.o_pipe, unit->out, len, out_done, unit) == CELL_OK) {
+        return;
+      }
+      continue;
+    }
+
+    // a setter may have queued state after the check but before the release
+    unit->out_busy = 0;
+    __lwsync();
+    if (out_ready(unit) == 0 || cellAtomicCompareAndSwap32((uint32_t *)&unit->out_busy, 0, 1) != 0) {
+      return;
+    }
+  }
+}
+
+static void out_done(int32_t result, int32_t count, void *arg) {
+  (void)result;
+  (void)count;
+  out_send((XPAD_UNIT_t *)arg);
+}
+
+static void out_kick(XPAD_UNIT_t *unit) {
+
+  // whoever takes out_busy sends, otherwise the transfer in flight picks it up
+  if (cellAtomicCompareAndSwap32((uint32_t *)&unit->out_busy, 0, 1) == 0) {
+    out_send(unit);
+  }
+}
+
+static int32_t out_set_led(XPAD_UNIT_t *unit, uint8_t led) {
+
+  // only the latest state matters, an unsent update is overwritten
+  unit->led = led;
+  __lwsync();
+  if (cellAtomicOr32((uint32_t *)&unit->out_pending, OUT_LED) & OUT_LED) {
+    unit->out_merged++;
+  }
+  out_kick(unit);
+  return(CELL_OK);
+}
+// end of output scheduler methods
+
+// start of device database methods
+static DEVICE_ENTRY_t *device_lookup(uint16_t idVendor, uint16_t idProduct) {
+  uint32_t key, i;
+
+  // open addressing with linear probing, the table is never full
+  key = ((uint32_t)idVendor << 16) | idProduct;
+  for (i = DEVICE_HASH(key); device_table[i].key != 0; i = (i + 1) & (DEVICE_TABLE_SIZE - 1)) {
+    if (device_table[i].key == key) {
+      return(&device_table[i]);
+    }
+  }
+  return(NULL);
+}
+
+static int32_t device_add(uint16_t idVendor, uint16_t idProduct, uint8_t type, uint8_t rmode) {
+  uint32_t key, i;
+
+  key = ((uint32_t)idVendor << 16) | idProduct;
+  if (key == 0) {
+    return(-1);
+  }
+  for (i = DEVICE_HASH(key); device_table[i].key != 0; i = (i + 1) & (DEVICE_TABLE_SIZE - 1)) {
+    if (device_table[i].key == key) {
+      break;
+    }
+  }
+  if (device_table[i].key == 0) {
+
+    // keep at least one empty entry so lookups always terminate
+    if (device_count >= DEVICE_TABLE_SIZE - 1) {
+      return(-1);
+    }
+    device_count++;
+  }
+  device_table[i].key = key;
+  device_table[i].type = type;
+  device_table[i].rmode = rmode;
+  device_table[i].flags = 0;
+  return(0);
+}
+
+static const char *device_parse_line(char *line) {
+  uint32_t vid, pid, i;
+  uint8_t rmode;
+  char *type, *mode;
+
+  // VID, PID, NAME, TYPE[, REPORT_MODE_QUEUE]
+  while (*line == ' ' || *line == '\t') {
+    line++;
+  }
+  if (line[0] == '#' || line[0] == 0 || line[0] == '\r') {
+    return(NULL);
+  }
+  if (parse_number(next_token(&line, ','), &vid) < 0 || vid > 0xFFFF) {
+    return("bad vendor id");
+  }
+  if (parse_number(next_token(&line, ','), &pid) < 0 || pid > 0xFFFF) {
+    return("bad product id");
+  }
+  next_token(&line, ','); // name is only for the reader
+  type = next_token(&line, ',');
+  mode = next_token(&line, ',');
+  if (mode[0] == 0) {
+    rmode = REPORT_MODE_LATEST;
+  } else if (strcmp(mode, "REPORT_MODE_QUEUE") == 0) {
+    rmode = REPORT_MODE_QUEUE;
+  } else {
+    return("unknown report mode");
+  }
+  for (i = 0; i < sizeof(device_types) / sizeof(device_types[0]); i++) {
+    if (strcmp(type, device_types[i].name) == 0) {
+      if (device_add(vid, pid, device_types[i].type, rmode) < 0) {
+        return("device table full");
+      }
+      return(NULL);
+    }
+  }
+  return("unknown type");
+}
+
+static void device_load(void) {
+  int32_t i;
+
+  memset(device_table, 0, sizeof(device_table));
+  device_count = 0;
+  for (i = 0; i < MAX_XPAD_DEV_NUM; i++) {
+    device_add(xpad_info[i].vid, xpad_info[i].pid, XTYPE_XBOX360, xpad_info[i].rmode);
+  }
+  for (i = 0; i < MAX_XPADW_DEV_NUM; i++) {
+    device_add(xpadw_info[i].vid, xpadw_info[i].pid, XTYPE_XBOX360W, xpadw_info[i].rmode);
+  }
+  config_read(DEVICES_FILE, device_parse_line);
+}
+
+static CellUsbdLddOps *device_ops(uint8_t type) {
+  if (type == XTYPE_XBOX360) {
+    return(&xpad_ops);
+  } else if (type == XTYPE_XBOX360W) {
+    return(&xpadw_ops);
+  } else if (type == XTYPE_HID || type == PTYPE_PS3 || type == PTYPE_PS4) {
+    return(&hid_ops);
+  }
+  return(NULL);
+}
+
+static int32_t device_register(void) {
+  int32_t r;
+  uint32_t i, j, stop;
+  uint16_t vid, lo, hi, pid;
+  DEVICE_ENTRY_t *e, *f;
+  CellUsbdLddOps *ops;
+
+  // as few registrations per vendor and driver as cover all of its product ids,
+  // ids in between that aren't in the table are rejected by probe, but a range
+  // never takes in an id another driver handles
+  for (i = 0; i < DEVICE_TABLE_SIZE; i++) {
+    e = &device_table[i];
+    if (e->key == 0 || (e->flags & DEVICE_REGISTERED) || (ops = device_ops(e->type)) == NULL) {
+      continue;
+    }
+    vid = e->key >> 16;
+    while (1) {
+
+      // lowest product id of this driver left to register
+      lo = 0xFFFF;
+      f = NULL;
+      for (j = i; j < DEVICE_TABLE_SIZE; j++) {
+        e = &device_table[j];
+        if (e->key != 0 && (e->key >> 16) == vid && !(e->flags & DEVICE_REGISTERED) && device_ops(e->type) == ops && (e->key & 0xFFFF) <= lo) {
+          lo = e->key & 0xFFFF;
+          f = e;
+        }
+      }
+      if (f == NULL) {
+        break;
+      }
+
+      // the range ends before the next id of another driver
+      stop = 0x10000;
+      for (j = 0; j < DEVICE_TABLE_SIZE; j++) {
+        e = &device_table[j];
+        pid = e->key & 0xFFFF;
+        if (e->key != 0 && (e->key >> 16) == vid && device_ops(e->type) != ops && pid > lo && pid < stop) {
+          stop = pid;
+        }
+      }
+      hi = lo;
+      for (j = i; j < DEVICE_TABLE_SIZE; j++) {
+        e = &device_table[j];
+        pid = e->key & 0xFFFF;
+        if (e->key != 0 && (e->key >> 16) == vid && device_ops(e->type) == ops && pid >= lo && pid < stop) {
+          hi = (pid > hi) ? pid : hi;
+          e->flags |= DEVICE_REGISTERED;
+        }
+      }
+      if ((r = cellUsbdRegisterExtraLdd2(ops, vid, lo, hi)) != CELL_OK) {
+        return(r);
+      }
+    }
+  }
+  for (i = 0; i < DEVICE_TABLE_SIZE; i++) {
+    device_table[i].flags &= ~DEVICE_REGISTERED;
+  }
+  return(CELL_OK);
+}
+// end of device database methods
+
+// start of remap methods
+static const char *remap_parse_line(char *line) {
+  uint32_t value, src, dst;
+  uint8_t neg;
+  char *key, *val;
+
+  // remap_setting = N starts profile N, then SOURCE = TARGET lines
+  key = next_token(&line, '=');
+  if (key[0] == '#' || key[0] == 0) {
+    return(NULL);
+  }
+  val = next_token(&line, '#');
+  if (strcmp(key, "remap_setting") == 0) {
+    if (parse_number(val, &value) < 0 || value < 1 || value > MAX_REMAP) {
+      return("remap_setting must be 1 to 10");
+    }
+    remap_loading = value;
+    remap_listed[value - 1] = 1;
+    for (src = 0; src < REMAP_BUTTONS; src++) {
+      remap_target[value - 1][src] = remap_names[src].mask;
+    }
+    for (src = 0; src < 4; src++) {
+      remap_axis[value - 1][src] = src;
+    }
+    remap_seen = 0;
+    return(NULL);
+  }
+  if (remap_loading == 0) {
+    return("mapping before the first remap_setting");
+  }
+
+  // sticks may be swapped and inverted, - in front of the target inverts it
+  neg = (val[0] == '-');
+  val += neg;
+  for (src = 0; src < 4 && strcmp(key, remap_axes[src]) != 0; src++);
+  for (dst = 0; dst < 4 && strcmp(val, remap_axes[dst]) != 0; dst++);
+  if (src < 4 || dst < 4) {
+    if (src == 4 || dst == 4) {
+      return("sticks only map to sticks");
+    }
+    remap_axis[remap_loading - 1][dst] = src | (neg ? REMAP_INVERT : 0);
+    return(NULL);
+  }
+  if (neg) {
+    return("only sticks can be inverted");
+  }
+
+  // the first line for a source replaces its own button, more lines add targets
+  for (src = 0; src < REMAP_BUTTONS && strcmp(key, remap_names[src].name) != 0; src++);
+  if (src == REMAP_BUTTONS) {
+    return("unknown source button");
+  }
+  for (dst = 0; dst < REMAP_BUTTONS && strcmp(val, remap_names[dst].name) != 0; dst++);
+  if (dst == REMAP_BUTTONS && strcmp(val, "NONE") != 0) {
+    return("unknown target button");
+  }
+  if (!(remap_seen & (1 << src))) {
+    remap_target[remap_loading - 1][src] = 0;
+    remap_seen |= 1 << src;
+  }
+  if (dst < REMAP_BUTTONS) {
+    remap_target[remap_loading - 1][src] |= remap_names[dst].mask;
+  }
+  return(NULL);
+}
+
+static void remap_build(REMAP_PROFILE_t *rm, const uint32_t *target, const uint8_t *axis) {
+  uint32_t v, i, j;
+
+  // one table per source byte of the pad button mask, PS is a single bit
+  for (v = 0; v < 256; v++) {
+    rm->lut[0][v] = 0;
+    rm->lut[1][v] = 0;
+    for (i = 0; i < 8; i++) {
+      if (v & (1 << i)) {
+        rm->lut[0][v] |= target[i];
+        rm->lut[1][v] |= target[8 + i];
+      }
+    }
+  }
+  rm->ps = target[16];
+
+  // a target's pressure comes from the first pressure sensitive source mapped to it,
+  // otherwise it follows the remapped digital button
+  memset(rm->press, REMAP_DIGITAL, sizeof(rm->press));
+  for (i = 0; i < REMAP_BUTTONS; i++) {
+    if (remap_names[i].press == REMAP_DIGITAL) {
+      continue;
+    }
+    for (j = 0; j < REMAP_BUTTONS; j++) {
+      if ((target[i] & remap_names[j].mask) && remap_names[j].press != REMAP_DIGITAL && rm->press[remap_names[j].press] == REMAP_DIGITAL) {
+        rm->press[remap_names[j].press] = remap_names[i].press;
+      }
+    }
+  }
+  memcpy(rm->axis, axis, sizeof(rm->axis));
+}
+
+static void remap_load(void) {
+  uint32_t i;
+
+  // profiles are compiled once, only the ones in the file take memory
+  memset(remap_listed, 0, sizeof(remap_listed));
+  remap_loading = 0;
+  config_read(REMAP_FILE, remap_parse_line);
+  for (i = 0; i < MAX_REMAP; i++) {
+    if (remap_listed[i] && (remap_profile[i] = (REMAP_PROFILE_t *)_malloc(sizeof(REMAP_PROFILE_t))) != NULL) {
+      remap_build(remap_profile[i], remap_target[i], remap_axis[i]);
+    }
+  }
+  remap_select(remap_index);
+}
+
+static void remap_free(void) {
+  uint32_t i;
+
+  remap = NULL;
+  for (i = 0; i < MAX_REMAP; i++) {
+    if (remap_profile[i] != NULL) {
+      _free(remap_profile[i]);
+      remap_profile[i] = NULL;
+    }
+  }
+}
+
+static void remap_select(uint32_t n) {
+
+  // profiles are never changed once built, the input thread picks up the
+  // new one with a single aligned pointer store
+  remap_index = (n > 0 && n <= MAX_REMAP && remap_profile[n - 1] != NULL) ? n : 0;
+  __lwsync();
+  remap = (remap_index > 0) ? remap_profile[remap_index - 1] : NULL;
+}
+
+static void remap_next(void) {
+  uint32_t i, n;
+  char msg[32], *p;
+
+  // PS + R3 steps through the loaded profiles, then back to no remapping
+  n = 0;
+  for (i = remap_index; i < MAX_REMAP; i++) {
+    if (remap_profile[i] != NULL) {
+      n = i + 1;
+      break;
+    }
+  }
+  remap_select(n);
+  if (n > 0) {
+    p = put_str(msg, "XPAD remap ");
+    p = put_u32(p, n);
+    *p = 0;
+  } else {
+    put_str(msg, "XPAD remap off")[0] = 0;
+  }
+  show_msg(msg);
+}
+// end of remap methods
+
+// start of title profile methods
+static uint64_t title_key(const char *id) {
+  uint64_t key;
+  uint32_t i;
+
+  // 7 bits per character keep title ids in order, 0 when malformed
+  key = 0;
+  for (i = 0; i < TITLE_ID_LEN; i++) {
+    if (!((id[i] >= 'A' && id[i] <= 'Z') || (id[i] >= '0' && id[i] <= '9'))) {
+      return(0);
+    }
+    key = (key << 7) | id[i];
+  }
+  return(key);
+}
+
+static const char *title_count_line(char *line) {
+  if (*next_token(&line, '#') != 0) {
+    title_total++;
+  }
+  return(NULL);
+}
+
+static const char *title_parse_line(char *line) {
+  uint32_t value;
+  char *id, *tok, *key;
+  TITLE_PROFILE_t *t;
+
+  // TITLEID, KEY=VALUE[, KEY=VALUE...], settings not listed keep the global value
+  line = next_token(&line, '#');
+  if (line[0] == 0) {
+    return(NULL);
+  }
+  if (title_count >= title_total) {
+    return("title table full");
+  }
+  t = &titles[title_count];
+  memset(t, TITLE_KEEP, sizeof(TITLE_PROFILE_t));
+  id = next_token(&line, ',');
+  if (strlen(id) != TITLE_ID_LEN || (t->key = title_key(id)) == 0) {
+    return("bad title id");
+  }
+  while (*(tok = next_token(&line, ',')) != 0) {
+    key = next_token(&tok, '=');
+    if (parse_number(next_token(&tok, 0), &value) < 0) {
+      return("title settings are KEY=NUMBER");
+    }
+    if (strcmp(key, "remap") == 0 && value <= MAX_REMAP) {
+      t->remap = value;
+    } else if (strcmp(key, "stick_deadzone") == 0 && value <= 99) {
+      t->deadzone = value;
+    } else if (strcmp(key, "stick_antideadzone") == 0 && value <= 99) {
+      t->antideadzone = value;
+    } else if (strcmp(key, "stick_curve") == 0 && value >= 1 && value <= 3) {
+      t->curve = value;
+    } else if (strcmp(key, "trigger_threshold") == 0 && value >= 1 && value <= 255) {
+      t->trig_on = value;
+    } else if (strcmp(key, "insert_keepalive") == 0 && value < TITLE_KEEP16) {
+      t->keepalive = value;
+    } else {
+      return("unknown title setting or value out of range");
+    }
+  }
+  title_count++;
+  return(NULL);
+}
+
+static void title_load(void) {
+  uint32_t gap, i, j;
+  TITLE_PROFILE_t t;
+
+  // the global settings are what a title without a profile gets
+  analog_default = analog;
+  keepalive_default = insert_keepalive;
+  remap_default = remap_index;
+
+  // count the lines, then read them into one block sorted for binary search
+  title_total = 0;
+  title_count = 0;
+  if (config_read(TITLES_FILE, title_count_line) < 0 || title_total == 0) {
+    return;
+  }
+  if ((titles = (TITLE_PROFILE_t *)_malloc(title_total * sizeof(TITLE_PROFILE_t))) == NULL) {
+    return;
+  }
+  config_read(TITLES_FILE, title_parse_line);
+  for (gap = title_count / 2; gap > 0; gap /= 2) {
+    for (i = gap; i < title_count; i++) {
+      t = titles[i];
+      for (j = i; j >= gap && titles[j - gap].key > t.key; j -= gap) {
+        titles[j] = titles[j - gap];
+      }
+      titles[j] = t;
+    }
+  }
+}
+
+static void title_free(void) {
+  if (titles != NULL) {
+    _free(titles);
+    titles = NULL;
+  }
+  title_count = 0;
+}
+
+static TITLE_PROFILE_t *title_find(uint64_t key) {
+  int32_t lo, hi, mid;
+
+  lo = 0;
+  hi = (int32_t)title_count - 1;
+  while (lo <= hi) {
+    mid = (lo + hi) >> 1;
+    if (titles[mid].key == key) {
+      return(&titles[mid]);
+    }
+    if (titles[mid].key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return(NULL);
+}
+
+static void title_apply(const TITLE_PROFILE_t *t) {
+  uint32_t n;
+
+  // runs on the input thread, so the tables never change under pad_insert
+  analog = analog_default;
+  insert_keepalive = keepalive_default;
+  n = remap_default;
+  if (t != NULL) {
+    if (t->deadzone != TITLE_KEEP) {
+      analog.deadzone = t->deadzone;
+    }
+    if (t->antideadzone != TITLE_KEEP) {
+      analog.antideadzone = t->antideadzone;
+    }
+    if (t->curve != TITLE_KEEP) {
+      analog.curve = t->curve;
+    }
+    if (t->trig_on != TITLE_KEEP16) {
+      analog.trig_on = t->trig_on;
+    }
+    if (t->keepalive != TITLE_KEEP16) {
+      insert_keepalive = t->keepalive;
+    }
+    if (t->remap != TITLE_KEEP) {
+      n = t->remap;
+    }
+  }
+  build_pad_tables();
+  remap_select(n);
+}
+
+static void title_check(void) {
+  uint32_t pid;
+  int32_t view;
+  GAME_PLUGIN_t *game;
+  char info[0x120];
+
+  // a game boot or exit shows up as a change of the game process id
+  if (titles == NULL) {
+    return;
+  }
+  if (!vsh_resolved) {
+    vsh_resolve();
+  }
+  if (vsh_game_pid == NULL || (pid = vsh_game_pid()) == title_pid) {
+    return;
+  }
+  if (pid == 0) {
+    title_pid = 0;
+    title_apply(NULL);
+    return;
+  }
+
+  // the title id comes from the game plugin, tried again next time if it isn't up yet
+  if (paf_view_find == NULL || paf_plugin_interface == NULL || (view = paf_view_find("game_plugin")) == 0) {
+    return;
+  }
+  if ((game = (GAME_PLUGIN_t *)paf_plugin_interface(view, 1)) == NULL) {
+    return;
+  }
+  memset(info, 0, sizeof(info));
+  game->gameInfo(info);
+  title_pid = pid;
+  title_apply(title_find(title_key(info + 4)));
+}
+// end of title profile methods
+
+// start of common pad translation methods
+static uint32_t stick_curve(uint32_t m) {
+  uint32_t dz, ad, t, c, i;
+
+  // stick magnitude 0..32768 to output magnitude in 1/256 steps, 0..128 * 256
+  dz = (uint32_t)analog.deadzone * 32768 / 100;
+  ad = (uint32_t)analog.antideadzone * (128 << 8) / 100;
+  if (m <= dz) {
+    return(0);
+  }
+  t = (m >= 32768) ? 0x10000 : (uint32_t)(((uint64_t)(m - dz) << 16) / (32768 - dz));
+  for (i = 1, c = t; i < analog.curve; i++) {
+    c = (uint32_t)(((uint64_t)c * t) >> 16);
+  }
+  return(ad + (uint32_t)(((uint64_t)((128 << 8) - ad) * c) >> 16));
+}
+
+static uint32_t isqrt(uint32_t v) {
+  uint32_t r = 0, b;
+
+  for (b = 1 << 30; b > v; b >>= 2);
+  for (; b; b >>= 2) {
+    if (v >= r + b) {
+      v -= r + b;
+      r = (r >> 1) + b;
+    } else {
+      r >>= 1;
+    }
+  }
+  return(r);
+}
+
+static void build_stick_tables(void) {
+  uint32_t i, m, out;
+
+  // built once from the settings, a report only does lookups
+  stick_shaped = (analog.deadzone > 0 || analog.antideadzone > 0 || analog.curve > 1);
+  for (i = 0; i < STICK_AXIAL_SIZE; i++) {
+    out = (stick_curve(i << STICK_AXIAL_SHIFT) + 0x80) >> 8;
+    stick_axial[i] = (out > 128) ? 128 : out;
+  }
+
+  // radial entries scale both axes by curve(r) / r for the radius at the bucket start
+  stick_radial[0] = 0;
+  for (i = 1; i < STICK_RADIAL_SIZE; i++) {
+    m = isqrt(i << STICK_RADIAL_SHIFT);
+    out = (stick_curve(m) << 8) / m;
+    stick_radial[i] = (out > 0xFFFF) ? 0xFFFF : out;
+  }
+}
+
+static inline uint8_t stick_clamp(int32_t v) {
+  v += 128;
+  return((v < 0) ? 0 : (v > 255) ? 255 : v);
+}
+
+static void stick_shape(int32_t x, int32_t y, uint8_t *px, uint8_t *py) {
+  int32_t m;
+  uint32_t s;
+
+  // x and y are signed 16 bit with down positive, deadzone and curve applied
+  if (analog.radial) {
+    s = stick_radial[((uint32_t)(x * x) + (uint32_t)(y * y)) >> STICK_RADIAL_SHIFT];
+    *px = stick_clamp((x * (int32_t)s) >> 16);
+    *py = stick_clamp((y * (int32_t)s) >> 16);
+  } else {
+    m = stick_axial[((x < 0) ? -x : x) >> STICK_AXIAL_SHIFT];
+    *px = stick_clamp((x < 0) ? -m : m);
+    m = stick_axial[((y < 0) ? -y : y) >> STICK_AXIAL_SHIFT];
+    *py = stick_clamp((y < 0) ? -m : m);
+  }
+}
+
+static void stick_convert(XBOX360_HAT *hat, uint8_t *px, uint8_t *py) {
+  int32_t x, y;
+
+  // Xbox axes are little endian 16 bit with up positive, PS3 axes are 8 bit with down positive
+  x = (int16_t)SWAP16((uint16_t)hat->x);
+  y = -(int32_t)(int16_t)SWAP16((uint16_t)hat->y);
+  if (!stick_shaped) {
+    *px = stick_clamp(x >> 8);
+    *py = stick_clamp((y - 1) >> 8);
+    return;
+  }
+  stick_shape(x, y, px, py);
+}
+
+static void stick_convert8(uint8_t x, uint8_t y, uint8_t *px, uint8_t *py) {
+
+  // 8 bit pads already match the PS3 range and direction
+  if (!stick_shaped) {
+    *px = x;
+    *py = y;
+    return;
+  }
+  stick_shape(((int32_t)x - 128) << 8, ((int32_t)y - 128) << 8, px, py);
+}
+
+static inline uint16_t sensor_clamp(int32_t v) {
+  v += 0x200;
+  return((v < 0) ? 0 : (v > 0x3FF) ? 0x3FF : v);
+}
+
+static void build_pad_tables(void) {
+  uint32_t v, i;
+
+  // a release point at or below zero would keep the trigger pressed
+  if (analog.trig_hyst >= analog.trig_on) {
+    analog.trig_hyst = analog.trig_on - 1;
+  }
+  build_stick_tables();
+
+  for (v = 0; v < 256; v++) {
+    xbox_lut[0][v] = 0;
+    xbox_lut[1][v] = 0;
+    for (i = 0; i < XBOX_MAP_SIZE; i++) {
+      if ((xbox_map[i].xbox >> 8) & v) {
+        xbox_lut[0][v] |= xbox_map[i].pad;
+      }
+      if ((xbox_map[i].xbox & 0xFF) & v) {
+        xbox_lut[1][v] |= xbox_map[i].pad;
+      }
+    }
+
+    // button presses correspond to max sensitivity value
+    for (i = 0; i < 4; i++) {
+      press_lut1[v][i] = (v & press_d1[i]) ? 0xFF : 0;
+    }
+    for (i = 0; i < 6; i++) {
+      press_lut2[v][i] = (v & press_d2[i]) ? 0xFF : 0;
+    }
+    for (i = 0; i < HID_BUTTONS; i++) {
+      if (i % 8 == 0) {
+        hid_lut[i / 8][v] = 0;
+      }
+      if (v & (1 << (i % 8))) {
+        hid_lut[i / 8][v] |= hid_map[i];
+      }
+    }
+  }
+}
+
+static void pad_image_reset(int32_t id) {
+  uint16_t *b;
+  PAD_IMAGE_t *img;
+
+  // set default controller values, the next report is always inserted
+  img = &pad_image[id];
+  memset(img, 0, sizeof(PAD_IMAGE_t));
+  img->data.len = 24;
+  b = img->data.button;
+  b[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X] = 0x0080;
+  b[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y] = 0x0080;
+  b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] = 0x0080;
+  b[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] = 0x0080;
+  b[CELL_PAD_BTN_OFFSET_SENSOR_X] = 0x0200;
+  b[CELL_PAD_BTN_OFFSET_SENSOR_Y] = 0x0200;
+  b[CELL_PAD_BTN_OFFSET_SENSOR_Z] = 0x0200;
+  b[CELL_PAD_BTN_OFFSET_SENSOR_G] = 0x0200;
+}
+
+// stores v in the pad image and remembers whether it differed
+#define PAD_SET(off, v) { uint16_t _v = (v); diff |= b[off] ^ _v; b[off] = _v; }
+
+static void pad_insert(int32_t id, uint32_t buttons, uint8_t trigL, uint8_t trigR, uint8_t lx, uint8_t ly, uint8_t rx, uint8_t ry, const uint16_t *press, const uint16_t *sensor) {
+  uint16_t *b, diff, src[12], dst[12];
+  const uint16_t *p1, *p2;
+  uint8_t held, combo, stick[4];
+  uint32_t i;
+  uint64_t now;
+  PAD_IMAGE_t *img;
+  REMAP_PROFILE_t *rm;
+
+  // L2 and R2 are analog triggers on most pads, a pressed trigger
+  // stays pressed until it falls trig_hyst below the press threshold
+  img = &pad_image[id];
+  b = img->data.button;
+  held = 0;
+  if (trigL + ((img->trig_held & 1) ? analog.trig_hyst : 0) >= analog.trig_on) {
+    buttons |= PAD_D2(CELL_PAD_CTRL_L2);
+    held |= 1;
+  }
+  if (trigR + ((img->trig_held & 2) ? analog.trig_hyst : 0) >= analog.trig_on) {
+    buttons |= PAD_D2(CELL_PAD_CTRL_R2);
+    held |= 2;
+  }
+  img->trig_held = held;
+
+  // combos are checked before remapping so they can't be mapped away,
+  // each acts once when it is pressed
+  combo = ((buttons & REMAP_COMBO) == REMAP_COMBO) ? COMBO_REMAP : 0;
+  combo |= ((buttons & STATS_COMBO) == STATS_COMBO) ? COMBO_STATS : 0;
+  if (combo & ~img->combo & COMBO_REMAP) {
+    remap_next();
+  }
+  if (combo & ~img->combo & COMBO_STATS) {
+    stats_pending = 1;
+  }
+#ifdef XPAD_LATENCY
+  if ((buttons & LATENCY_COMBO) == LATENCY_COMBO) {
+    latency_pending |= !(img->combo & COMBO_LATENCY);
+    combo |= COMBO_LATENCY;
+  }
+#endif
+
+  // the game doesn't see PS while it is part of a combo, nor after one
+  // until PS itself is released
+  if (combo || ((img->combo & COMBO_PS) && (buttons & PAD_PS))) {
+    combo |= COMBO_PS;
+    buttons &= ~PAD_PS;
+  }
+  img->combo = combo;
+
+  // pads without pressure sensitive buttons report them fully pressed,
+  // press holds RIGHT..DOWN then TRIANGLE..R1 on pads that have them
+  if (press == NULL) {
+    p1 = press_lut1[buttons & 0xFF];
+    p2 = press_lut2[(buttons >> 8) & 0xFF];
+  } else {
+    p1 = press;
+    p2 = press + 4;
+  }
+
+  // one lookup per source byte moves the buttons, pressure and sticks follow the profile
+  if ((rm = remap) != NULL) {
+    for (i = 0; i < 4; i++) {
+      src[i] = p1[i];
+    }
+    for (i = 0; i < 6; i++) {
+      src[4 + i] = p2[i];
+    }
+    src[10] = trigL;
+    src[11] = trigR;
+    buttons = rm->lut[0][buttons & 0xFF] | rm->lut[1][(buttons >> 8) & 0xFF] | ((buttons & PAD_PS) ? rm->ps : 0);
+    p1 = press_lut1[buttons & 0xFF];
+    p2 = press_lut2[(buttons >> 8) & 0xFF];
+    for (i = 0; i < 4; i++) {
+      dst[i] = (rm->press[i] != REMAP_DIGITAL) ? src[rm->press[i]] : p1[i];
+    }
+    for (i = 0; i < 6; i++) {
+      dst[4 + i] = (rm->press[4 + i] != REMAP_DIGITAL) ? src[rm->press[4 + i]] : p2[i];
+    }
+    trigL = (rm->press[10] != REMAP_DIGITAL) ? src[rm->press[10]] : (buttons & PAD_D2(CELL_PAD_CTRL_L2)) ? 0xFF : 0;
+    trigR = (rm->press[11] != REMAP_DIGITAL) ? src[rm->press[11]] : (buttons & PAD_D2(CELL_PAD_CTRL_R2)) ? 0xFF : 0;
+    p1 = dst;
+    p2 = dst + 4;
+    stick[0] = lx;
+    stick[1] = ly;
+    stick[2] = rx;
+    stick[3] = ry;
+    lx = stick[rm->axis[0] & 3] ^ ((rm->axis[0] & REMAP_INVERT) ? 0xFF : 0);
+    ly = stick[rm->axis[1] & 3] ^ ((rm->axis[1] & REMAP_INVERT) ? 0xFF : 0);
+    rx = stick[rm->axis[2] & 3] ^ ((rm->axis[2] & REMAP_INVERT) ? 0xFF : 0);
+    ry = stick[rm->axis[3] & 3] ^ ((rm->axis[3] & REMAP_INVERT) ? 0xFF : 0);
+  }
+
+  // update the persistent pad image, length never changes here
+  diff = 0;
+  PAD_SET(0, (buttons & PAD_PS) ? CELL_PAD_CTRL_LDD_PS : 0);
+  PAD_SET(CELL_PAD_BTN_OFFSET_DIGITAL1, buttons & 0xFF);
+  PAD_SET(CELL_PAD_BTN_OFFSET_DIGITAL2, (buttons >> 8) & 0xFF);
+  PAD_SET(CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X, rx);
+  PAD_SET(CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y, ry);
+  PAD_SET(CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X, lx);
+  PAD_SET(CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y, ly);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_RIGHT, p1[0]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_LEFT, p1[1]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_UP, p1[2]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_DOWN, p1[3]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_TRIANGLE, p2[0]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_CIRCLE, p2[1]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_CROSS, p2[2]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_SQUARE, p2[3]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_L1, p2[4]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_R1, p2[5]);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_L2, trigL);
+  PAD_SET(CELL_PAD_BTN_OFFSET_PRESS_R2, trigR);
+
+  // sensors stay centered on pads without motion sensors
+  if (sensor != NULL) {
+    PAD_SET(CELL_PAD_BTN_OFFSET_SENSOR_X, sensor[0]);
+    PAD_SET(CELL_PAD_BTN_OFFSET_SENSOR_Y, sensor[1]);
+    PAD_SET(CELL_PAD_BTN_OFFSET_SENSOR_Z, sensor[2]);
+    PAD_SET(CELL_PAD_BTN_OFFSET_SENSOR_G, sensor[3]);
+  }
+
+  // only send pad data to virtual pad when it changed or to keep it alive
+  input_changed |= diff;
+  now = __mftb();
+  if (diff == 0 && img->valid && insert_keepalive > 0 && now - img->last_insert < insert_keepalive * tb_per_ms) {
+    stats.inserts_suppressed[id]++;
+    return;
+  }
+  cellPadLddDataInsert(handle[id], &img->data);
+  if (reg_start[id]) {
+    stats.first_insert_us[id] = (uint32_t)((now - reg_start[id]) * 1000 / tb_per_ms);
+    reg_start[id] = 0;
+  }
+#ifdef XPAD_LATENCY
+  latency_insert(id);
+#endif
+  img->last_insert = now;
+  img->valid = 1;
+  stats.inserts_issued[id]++;
+}
+
+static void xbox_read_report(int32_t id, XBOX360_IN_REPORT *report) {
+  uint32_t buttons;
+  uint8_t *b = (uint8_t *)&report->buttons;
+  uint8_t lx, ly, rx, ry;
+
+  // wired and wireless Xbox 360 pads share everything after their header, buttons read in wire order
+  buttons = xbox_lut[0][b[0]] | xbox_lut[1][b[1]];
+
+  // PS3 pads use 8 bit values for each axis while Xbox pads use 16 bit
+  stick_convert(&report->left, &lx, &ly);
+  stick_convert(&report->right, &rx, &ry);
+  pad_insert(id, buttons, report->trigL, report->trigR, lx, ly, rx, ry, NULL, NULL);
+}
+// end of common pad translation methods
+
+// start of wired controller specific methods
+static int32_t xpad_probe(int32_t dev_id) {
+  uint16_t idVendor, idProduct;
+  UsbDeviceDescriptor *ddesc;
+  UsbInterfaceDescriptor *idesc;
+  DEVICE_ENTRY_t *dev;
+
+  block(xpad_mutex);
+  if (XPAD.n >= MAX_XPAD_NUM) {
+    unblock(xpad_mutex);
+    return(CELL_USBD_PROBE_FAILED);
+  }
+  unblock(xpad_mutex);
+  if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) == NULL) {
+    return(CELL_USBD_PROBE_FAILED);
+  }
+  idesc = (UsbInterfaceDescriptor *)ddesc;
+  if ((idesc = (UsbInterfaceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
+    return(CELL_USBD_PROBE_FAILED);
+  }
+
+  // make sure product id and vendor id are valid
+  idVendor = SWAP16(ddesc->idVendor);
+  idProduct = SWAP16(ddesc->idProduct);
+  if ((dev = device_lookup(idVendor, idProduct)) != NULL && dev->type == XTYPE_XBOX360) {
+    return(CELL_USBD_PROBE_SUCCEEDED);
+  }
+  return(CELL_USBD_PROBE_FAILED);
+}
+
+static int32_t xpad_attach(int32_t dev_id) {
+  int32_t payload;
+  UsbDeviceDescriptor *ddesc;
+  UsbConfigurationDescriptor *cdesc;
+  UsbInterfaceDescriptor *idesc;
+  UsbEndpointDescriptor *edesc;
+  DEVICE_ENTRY_t *dev;
+  XPAD_UNIT_t *unit;
+
+  if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((dev = device_lookup(SWAP16(ddesc->idVendor), SWAP16(ddesc->idProduct))) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((cdesc = (UsbConfigurationDescriptor *) cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_CONFIGURATION)) == NULL) {
+    return (CELL_USBD_ATTACH_FAILED);
+  }
+  idesc = (UsbInterfaceDescriptor *)cdesc;
+  if ((idesc = (UsbInterfaceDescriptor *) cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((edesc = (UsbEndpointDescriptor *) cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_ENDPOINT)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if (edesc->bEndpointAddress != 0x81) { // XBox 360 controller In endpoint
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  payload = SWAP16(edesc->wMaxPacketSize);
+  if ((unit = unit_alloc(dev_id, payload, edesc->bInterval, idesc->bInterfaceNumber, idesc->bAlternateSetting, XTYPE_XBOX360, dev->rmode)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((unit->conf.c_pipe = cellUsbdOpenPipe(dev_id, NULL)) < 0) {
+    unit_free(unit);
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((unit->i_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+    unit_free(unit);
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  edesc->bEndpointAddress = 0x01; // XBox 360 controller out endpoint
+  if ((unit->conf.o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+    edesc->bEndpointAddress = 0x02; // It is 0x02 for some controllers
+    if ((unit->conf.o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+      unit_free(unit);
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+  }
+
+  // endpoint found, set configuration and add to connected controllers list
   cellUsbdSetPrivateData(dev_id, unit);
-  cellUsbdSetConfiguration(unit->c_pipe, cdesc->bConfigurationValue, set_config_done, unit);
-  block(xpad_mutex);
-  XPAD.n++;
-  XPAD.is_connected[unit->number] = 1;
-  XPAD.con_unit[unit->number] = unit;
-  register_ldd_controller(unit);
-  unblock(xpad_mutex);
+  cellUsbdSetConfiguration(unit->conf.c_pipe, cdesc->bConfigurationValue, set_config_done, unit);
+  slot_connect(unit, 1);
+  sys_event_flag_set(xpad_event, XPAD_EVENT_WAKE);
   return(CELL_USBD_ATTACH_SUCCEEDED);
 }
 
 static int32_t xpad_detach(int32_t dev_id) {
-  int32_t r;
   XPAD_UNIT_t *unit;
 
   // Xbox controller has been unplugged
@@ -539,252 +2880,650 @@ static int32_t xpad_detach(int32_t dev_id) {
   if ((unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(dev_id)) == NULL) {
     return(CELL_USBD_DETACH_FAILED);
   }
-  block(xpad_mutex);
-
-  // update common data
-  XPAD.n--;
-  XPAD.is_connected[unit->number] = 0;
-  XPAD.con_unit[unit->number] = NULL;
-  unregister_ldd_controller(unit);
-  unblock(xpad_mutex);
+  slot_disconnect(unit);
   unit_free(unit);
   return(CELL_USBD_DETACH_SUCCEEDED);
 }
 
 static int32_t xpad_detach_all(void) {
   int32_t i;
+  uint32_t live;
   XPAD_UNIT_t *unit;
 
   // detach all wired controllers
-  block(xpad_mutex);
-  for (i = 0; i < MAX_XPAD_NUM; i++) {
-    if (XPAD.is_connected[i]) {
-      unit = XPAD.con_unit[i];
-      if (unit->xtype == XTYPE_XBOX360) {
-        XPAD.n--;
-        XPAD.is_connected[unit->number] = 0;
-        XPAD.con_unit[unit->number] = NULL;
-        unregister_ldd_controller(unit);
-        unit_free(unit);
+  live = XPAD.connected;
+  while (live) {
+    i = slot_next(&live);
+    unit = XPAD.con_unit[i];
+    if (unit->xtype == XTYPE_XBOX360) {
+      slot_disconnect(unit);
+      unit_free(unit);
+    }
+  }
+  return(CELL_USBD_DETACH_SUCCEEDED);
+}
+
+static void xpad_read_report(int32_t id, uint8_t *readBuf) {
+  xbox_read_report(id, (XBOX360_IN_REPORT *)readBuf);
+}
+
+static int32_t xpad_read_input(int32_t id, void *data) {
+  unsigned char *p;
+  XBOX360_IN_REPORT *report;
+  XPAD_UNIT_t *unit;
+
+  p = (unsigned char *)data;
+  if (id > MAX_XPAD_NUM) {
+    return(-1);
+  }
+  if ((unit = XPAD.con_unit[id]) == NULL) {
+    return(-1);
+  }
+
+  // get the next report, data holds count and size followed by the payload
+  if (report_get(unit, p) == 0) {
+    return(0);
+  }
+  p += 2;
+  report = (XBOX360_IN_REPORT *)p;
+  if ((report->header.command == inReport) && (report->header.size == sizeof(XBOX360_IN_REPORT))) {
+    xpad_read_report(unit->number, p);
+  }
+  return(1);
+}
+
+static int32_t xpad_out_report(XPAD_UNIT_t *unit, uint32_t what) {
+  uint8_t *out = unit->out;
+
+  // fill the out buffer, returns the report length
+  if (what == OUT_LED) {
+    out[0] = 0x01;
+    out[1] = 0x03;
+    out[2] = unit->led;
+    return(3);
+  }
+  return(0);
+}
+// end of wired controller specific methods 
+
+// start of wireless controller specific methods
+static int32_t get_device_desc(int32_t dev_id, void *p) {
+  (void) dev_id;
+  (void) p;
+
+  // do nothing
+  return(CELL_OK);
+}
+
+static int32_t get_configration_desc(int32_t dev_id, void *p) {
+  (void) dev_id;
+  (void) p;
+
+  // do nothing
+  return(CELL_OK);
+}
+
+static int32_t get_interface_desc(int32_t dev_id, void *p) {
+  (void) dev_id;
+  (void) p;
+
+  // do nothing
+  return(CELL_OK);
+}
+
+static int32_t get_endpoint_desc(int32_t dev_id, void *p) {
+  UsbEndpointDescriptor *edesc = (UsbEndpointDescriptor *)p;
+  UsbDeviceDescriptor *ddesc;
+  int32_t payload;
+  uint8_t rmode;
+  DEVICE_ENTRY_t *dev;
+  XPAD_UNIT_t *unit;
+  XPADW_RECEIVER_t *rx;
+
+  if (edesc->bEndpointAddress == 0x81 || edesc->bEndpointAddress == 0x83 || edesc->bEndpointAddress == 0x85 || edesc->bEndpointAddress == 0x87) {
+    if ((rx = receiver_find(dev_id)) == NULL || rx->n >= MAX_XPADW_NUM) {
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+    payload = SWAP16(edesc->wMaxPacketSize);
+    rmode = REPORT_MODE_LATEST;
+    if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) != NULL) {
+      if ((dev = device_lookup(SWAP16(ddesc->idVendor), SWAP16(ddesc->idProduct))) != NULL) {
+        rmode = dev->rmode;
+      }
+    }
+    if ((unit = unit_alloc(dev_id, payload, edesc->bInterval, (edesc->bEndpointAddress - 0x01) & 0x0f, 0, XTYPE_XBOX360W, rmode)) == NULL) {
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+    if ((unit->conf.c_pipe = cellUsbdOpenPipe(dev_id, NULL)) < 0) {
+      unit_free(unit);
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+    if ((unit->i_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+      unit_free(unit);
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+    edesc->bEndpointAddress &= 0x0f; // XBox controller out endpoint, ex: 0x81 & 0x0f == 0x01
+    if ((unit->conf.o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+      unit_free(unit);
+      return(CELL_USBD_ATTACH_FAILED);
+    }
+
+    // endpoint found, set configuration and add it to its receiver,
+    // the controller gets a port once its link comes up
+    rx->unit[rx->n++] = unit;
+    cellUsbdSetConfiguration(unit->conf.c_pipe, 1, set_config_done, unit);
+  }
+  return(CELL_USBD_ATTACH_SUCCEEDED);
+}
+
+static int32_t xpadw_probe(int32_t dev_id) {
+  uint16_t idVendor, idProduct;
+  UsbDeviceDescriptor *ddesc;
+  UsbInterfaceDescriptor *idesc;
+  DEVICE_ENTRY_t *dev;
+
+  // each receiver needs an entry of its own
+  block(receiver_mutex);
+  if (receiver_find(-1) == NULL) {
+    unblock(receiver_mutex);
+    return(CELL_USBD_PROBE_FAILED);
+  }
+  unblock(receiver_mutex);
+  if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) == NULL) {
+    return(CELL_USBD_PROBE_FAILED);
+  }
+  idesc = (UsbInterfaceDescriptor *)ddesc;
+  if ((idesc = (UsbInterfaceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
+    return(CELL_USBD_PROBE_FAILED);
+  }
+
+  // make sure product id and vendor id are valid
+  idVendor = SWAP16(ddesc->idVendor);
+  idProduct = SWAP16(ddesc->idProduct);
+  if ((dev = device_lookup(idVendor, idProduct)) != NULL && dev->type == XTYPE_XBOX360W) {
+    return(CELL_USBD_PROBE_SUCCEEDED);
+  }
+  return(CELL_USBD_PROBE_FAILED);
+}
+
+static int xpadw_attach(int32_t dev_id) {
+  uint8_t* desc = 0;
+  uint32_t i;
+  XPADW_RECEIVER_t *rx;
+
+  // claim a receiver entry, its units are added as the endpoints are found
+  block(receiver_mutex);
+  if ((rx = receiver_find(-1)) == NULL) {
+    unblock(receiver_mutex);
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  rx->dev_id = dev_id;
+  rx->n = 0;
+
+  // Xbox 360 wireless receivers have 4 endpoints (1 per controller)
+  // all 4 need to be listened to at all times in case of controller connection/disconnection
+  // traverse through its usb device descriptor and find the endpoints
+  while (1) {
+    if ((desc = cellUsbdScanStaticDescriptor(dev_id, desc, 0)) == 0) {
+        break;
+    }
+    for (i = 0; i < DESCRIPTOR_TABLE_SIZE; i++) {
+      if (descriptor_table[i].bDescriptorType == desc[1]) {
+        break;
+      }
+    }
+    if (i != DESCRIPTOR_TABLE_SIZE) {
+      descriptor_table[i].dump_descriptor(dev_id, desc);
+    }
+  }
+  if (rx->n == 0) {
+    rx->dev_id = -1;
+    unblock(receiver_mutex);
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  unblock(receiver_mutex);
+  return(CELL_USBD_ATTACH_SUCCEEDED);
+}
+
+static XPADW_RECEIVER_t *receiver_find(int32_t dev_id) {
+  int32_t i;
+
+  // called with receiver_mutex held, dev_id -1 finds a free entry
+  for (i = 0; i < MAX_XPADW_RECEIVERS; i++) {
+    if (receiver[i].dev_id == dev_id) {
+      return(&receiver[i]);
+    }
+  }
+  return(NULL);
+}
+
+static void receiver_release(XPADW_RECEIVER_t *rx) {
+  int32_t i;
+  XPAD_UNIT_t *unit;
+
+  // called with receiver_mutex held, only this receiver's units are touched
+  for (i = 0; i < rx->n; i++) {
+    unit = rx->unit[i];
+    if (unit->number >= 0) {
+      slot_disconnect(unit);
+    }
+    unit_free(unit);
+    rx->unit[i] = NULL;
+  }
+  rx->n = 0;
+  rx->dev_id = -1;
+}
+
+static int32_t xpadw_detach(int32_t dev_id) {
+  XPADW_RECEIVER_t *rx;
+
+  // Xbox wireless receiver has been unplugged
+  // disconnect the virtual controllers associated to it
+  block(receiver_mutex);
+  if ((rx = receiver_find(dev_id)) != NULL) {
+    receiver_release(rx);
+  }
+  unblock(receiver_mutex);
+  return(CELL_USBD_DETACH_SUCCEEDED);
+}
+
+static int32_t xpadw_detach_all(void) {
+  int32_t i;
+
+  // detach all wireless receivers
+  block(receiver_mutex);
+  for (i = 0; i < MAX_XPADW_RECEIVERS; i++) {
+    if (receiver[i].dev_id >= 0) {
+      receiver_release(&receiver[i]);
+    }
+  }
+  unblock(receiver_mutex);
+  return(CELL_USBD_DETACH_SUCCEEDED);
+}
+
+static void xpadw_links(void) {
+  int32_t i, j, link;
+  XPAD_UNIT_t *unit;
+
+  // link status latched on the usb thread, a linked controller takes
+  // a port and registers, an unlinked one gives its port back
+  block(receiver_mutex);
+  for (i = 0; i < MAX_XPADW_RECEIVERS; i++) {
+    for (j = 0; j < receiver[i].n; j++) {
+      unit = receiver[i].unit[j];
+      if ((link = report_get_link(unit)) < 0) {
+        continue;
+      }
+      if (link == 0x80 && unit->number < 0) {
+
+        // controller connected to receiver
+        if (slot_take(unit) == CELL_OK) {
+          slot_connect(unit, 1);
+        }
+      } else if (link == 0x00 && unit->number >= 0) {
+
+        // controller disconnected from receiver
+        slot_disconnect(unit);
+        slot_release(unit);
+      }
+    }
+  }
+  unblock(receiver_mutex);
+}
+
+static void xpadw_read_report(int32_t id, uint8_t *readBuf) {
+
+  // skip the wireless header, the rest matches the wired report
+  xbox_read_report(id, (XBOX360_IN_REPORT *)(readBuf + offsetof(XBOX360W_IN_REPORT, header)));
+}
+
+static int32_t xpadw_read_input(int32_t id, void *data) {
+  unsigned char *p;
+  XBOX360W_IN_REPORT *report;
+  XPAD_UNIT_t *unit;
+
+  p = (unsigned char *)data;
+  if (id > MAX_XPAD_NUM) {
+    return(-1);
+  }
+  if ((unit = XPAD.con_unit[id]) == NULL) {
+    return(-1);
+  }
+
+  // get the next report, data holds count and size followed by the payload
+  if (report_get(unit, p) == 0) {
+    return(0);
+  }
+  p += 2;
+  report = (XBOX360W_IN_REPORT *)p;
+  if ((p[1] == 0x01) && (report->header.command == inReport) && (report->header.size == sizeof(XBOX360W_IN_REPORT))) {
+    xpadw_read_report(unit->number, p);
+  }
+  return(1);
+}
+
+static int32_t xpadw_out_report(XPAD_UNIT_t *unit, uint32_t what) {
+  uint8_t *out = unit->out;
+
+  // fill the out buffer, returns the report length
+  if (what == OUT_LED) {
+    out[0] = 0x00;
+    out[1] = 0x00;
+    out[2] = 0x08;
+    out[3] = unit->led | 0x40;
+    return(4);
+  }
+  return(0);
+}
+// end of wireless controller specific methods
+
+// start of hid controller specific methods
+static HID_FIELD_t *hid_field_add(HID_PLAN_t *plan, uint8_t op, uint32_t bit, uint32_t size, uint8_t arg) {
+  HID_FIELD_t *f;
+
+  // the field is read as 4 bytes from its first byte, so it fits in 32 bits
+  if (plan->n >= HID_MAX_FIELDS || size == 0 || size > 16 || (bit + size + 7) / 8 > MAX_XPAD_PAYLOAD) {
+    return(NULL);
+  }
+  f = &plan->field[plan->n++];
+  memset(f, 0, sizeof(HID_FIELD_t));
+  f->op = op;
+  f->byte = bit >> 3;
+  f->shift = bit & 7;
+  f->size = size;
+  f->mask = (1 << size) - 1;
+  f->arg = arg;
+  if ((bit + size + 7) / 8 > plan->len) {
+    plan->len = (bit + size + 7) / 8;
+  }
+  return(f);
+}
+
+static int32_t hid_compile(HID_PLAN_t *plan, const uint8_t *desc, int32_t len) {
+  const uint8_t *p, *end;
+  uint8_t b, ids[HID_MAX_IDS];
+  uint16_t bits[HID_MAX_IDS];
+  uint32_t u, page, rsize, rcount, usage[HID_BUTTONS], nusage, umin, umax, i, j, k, next_button, next_bit;
+  int32_t s, lmin, lmax, lmax_u, size, cur, nids;
+  HID_FIELD_t *f;
+
+  // walk the short items once, every input field a pad uses becomes a plan step
+  // bit offsets are kept per report id, fields come from the first id that has one
+  memset(plan->field, 0, sizeof(plan->field));
+  plan->report_id = 0;
+  plan->n = 0;
+  plan->len = 0;
+  plan->axes = 0;
+  page = rsize = rcount = nusage = umin = umax = 0;
+  lmin = lmax = lmax_u = 0;
+  next_button = next_bit = 0;
+  ids[0] = 0;
+  bits[0] = 0;
+  nids = 1;
+  cur = 0;
+  p = desc;
+  end = desc + len;
+  while (p < end) {
+    b = *p++;
+    if (b == 0xFE) {
+
+      // long item, nothing a gamepad needs
+      if (p + 2 > end) {
+        break;
+      }
+      p += 2 + p[0];
+      continue;
+    }
+    size = ((b & 3) == 3) ? 4 : (b & 3);
+    if (p + size > end) {
+      break;
+    }
+    for (u = 0, i = 0; i < (uint32_t)size; i++) {
+      u |= (uint32_t)p[i] << (8 * i);
+    }
+    s = (size == 0) ? 0 : (int32_t)(u << (32 - 8 * size)) >> (32 - 8 * size);
+    p += size;
+    switch (b & 0xFC) {
+    case 0x04: // usage page
+      page = u;
+      break;
+    case 0x14: // logical minimum
+      lmin = s;
+      break;
+    case 0x24: // logical maximum, many devices leave out the sign byte
+      lmax = s;
+      lmax_u = u;
+      break;
+    case 0x74: // report size
+      rsize = u;
+      break;
+    case 0x94: // report count
+      rcount = u;
+      break;
+    case 0x84: // report id
+      for (i = 0; i < (uint32_t)nids && ids[i] != (uint8_t)u; i++);
+      if (i == (uint32_t)nids) {
+        if (nids >= HID_MAX_IDS) {
+          return(plan->n);
+        }
+        ids[nids] = (uint8_t)u;
+        bits[nids++] = 0;
+      }
+      cur = i;
+      break;
+    case 0x08: // usage
+      if (nusage < HID_BUTTONS) {
+        usage[nusage++] = (size == 4) ? u : (page << 16) | u;
+      }
+      break;
+    case 0x18: // usage minimum
+      umin = (size == 4) ? u : (page << 16) | u;
+      break;
+    case 0x28: // usage maximum
+      umax = (size == 4) ? u : (page << 16) | u;
+      break;
+    case 0x80: // input
+      if (lmax < lmin) {
+        lmax = lmax_u;
+      }
+      for (i = 0; i < rcount; i++, bits[cur] += rsize) {
+
+        // constant padding and array fields only take up space
+        if ((u & 0x03) != 0x02 || (plan->n > 0 && ids[cur] != plan->report_id)) {
+          continue;
+        }
+        if (nusage > 0) {
+          k = usage[(i < nusage) ? i : nusage - 1];
+        } else if (umin + i <= umax) {
+          k = umin + i;
+        } else {
+          continue;
+        }
+        f = NULL;
+        if ((k >> 16) == 0x09 && (k & 0xFFFF) >= 1 && (k & 0xFFFF) <= HID_BUTTONS && rsize == 1) {
+
+          // buttons that follow each other in the report and the same table share a step,
+          // the plan's report length grows with the step
+          j = (k & 0xFFFF) - 1;
+          if (plan->n > 0 && plan->field[plan->n - 1].op == HID_OP_BUTTONS && j == next_button && bits[cur] == next_bit && (j >> 3) == plan->field[plan->n - 1].arg && bits[cur] < MAX_XPAD_PAYLOAD * 8) {
+            f = &plan->field[plan->n - 1];
+            f->size++;
+            f->mask = (1 << f->size) - 1;
+            if ((f->byte * 8 + f->shift + f->size + 7) / 8 > plan->len) {
+              plan->len = (f->byte * 8 + f->shift + f->size + 7) / 8;
+            }
+          } else if ((f = hid_field_add(plan, HID_OP_BUTTONS, bits[cur], 1, j >> 3)) != NULL) {
+            f->lshift = j & 7;
+          }
+          next_button = j + 1;
+          next_bit = bits[cur] + 1;
+        } else if (k == 0x10039 && (lmax - lmin == 7 || lmax - lmin == 3)) {
+
+          // 8 way hats step by one, 4 way hats by two
+          if ((f = hid_field_add(plan, HID_OP_HAT, bits[cur], rsize, 8 / (lmax - lmin + 1))) != NULL) {
+            f->min = lmin;
+            f->range = lmax - lmin;
+          }
+        } else {
+          for (j = 0; j < HID_AXIS_MAP_SIZE && hid_axis_map[j].usage != k; j++);
+          if (j == HID_AXIS_MAP_SIZE || (plan->axes & (1 << hid_axis_map[j].axis)) || lmax <= lmin) {
+            continue;
+          }
+          if ((f = hid_field_add(plan, HID_OP_AXIS, bits[cur], rsize, hid_axis_map[j].axis)) != NULL) {
+            f->min = lmin;
+            f->range = lmax - lmin;
+            f->scale = 0xFFFF0000 / f->range;
+            plan->axes |= 1 << f->arg;
+          }
+        }
+        if (f != NULL) {
+          f->sext = (lmin < 0) ? 32 - f->size : 0;
+          plan->report_id = ids[cur];
+        }
       }
+      nusage = umin = umax = 0;
+      break;
+    case 0x90: // output
+    case 0xB0: // feature
+    case 0xA0: // collection
+    case 0xC0: // end collection
+      nusage = umin = umax = 0;
+      break;
     }
   }
-  unblock(xpad_mutex);
-  return(CELL_USBD_DETACH_SUCCEEDED);
-}
-
-static void xpad_read_report(int32_t id, uint8_t *readBuf) {
-  uint16_t *digit0, *digit1, *digit2,
-           *analog_rx, *analog_ry, *analog_lx, *analog_ly,
-           *press_l2, *press_r2, *press_l1, *press_r1,
-           *press_up, *press_down, *press_left, *press_right,
-           *press_cross, *press_square, *press_circle, *press_triangle;
-  XBOX360_IN_REPORT *report;
-  CellPadData data;
-
-  report = (XBOX360_IN_REPORT *)readBuf;
-  memset(&data, 0, sizeof(CellPadData));
-  data.len = 24;
-
-  // map location of each button in virtual pad's data
-  digit0 = &data.button[0];
-  digit1 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL1];
-  digit2 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL2];
-  analog_rx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X];
-  analog_ry = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y];
-  analog_lx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X];
-  analog_ly = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y];
-  press_l2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L2];
-  press_r2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R2];
-  press_l1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L1];
-  press_r1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R1];
-  press_right = &data.button[CELL_PAD_BTN_OFFSET_PRESS_RIGHT];
-  press_left = &data.button[CELL_PAD_BTN_OFFSET_PRESS_LEFT];
-  press_up = &data.button[CELL_PAD_BTN_OFFSET_PRESS_UP];
-  press_down = &data.button[CELL_PAD_BTN_OFFSET_PRESS_DOWN];
-  press_cross = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CROSS];
-  press_square = &data.button[CELL_PAD_BTN_OFFSET_PRESS_SQUARE];
-  press_circle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CIRCLE];
-  press_triangle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_TRIANGLE];
-
-  // set default controller values
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_X] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Y] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Z] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_G] = 0x0200;
-
-  // read values from Xbox controller and map it to the virtual pad
-  *digit0 = (report->buttons & btnXbox) ? *digit0 | CELL_PAD_CTRL_LDD_PS : *digit0 & ~CELL_PAD_CTRL_LDD_PS;
-  *digit1 = (report->buttons & btnDigiLeft) ? *digit1 | CELL_PAD_CTRL_LEFT : *digit1 & ~CELL_PAD_CTRL_LEFT;
-  *digit1 = (report->buttons & btnDigiDown) ? *digit1 | CELL_PAD_CTRL_DOWN : *digit1 & ~CELL_PAD_CTRL_DOWN;
-  *digit1 = (report->buttons & btnDigiRight) ? *digit1 | CELL_PAD_CTRL_RIGHT : *digit1 & ~CELL_PAD_CTRL_RIGHT;
-  *digit1 = (report->buttons & btnDigiUp) ? *digit1 | CELL_PAD_CTRL_UP : *digit1 & ~CELL_PAD_CTRL_UP;
-  *digit1 = (report->buttons & btnStart) ? *digit1 | CELL_PAD_CTRL_START : *digit1 & ~CELL_PAD_CTRL_START;
-  *digit1 = (report->buttons & btnHatRight) ? *digit1 | CELL_PAD_CTRL_R3 : *digit1 & ~CELL_PAD_CTRL_R3;
-  *digit1 = (report->buttons & btnHatLeft) ? *digit1 | CELL_PAD_CTRL_L3 : *digit1 & ~CELL_PAD_CTRL_L3;
-  *digit1 = (report->buttons & btnBack) ? *digit1 | CELL_PAD_CTRL_SELECT : *digit1 & ~CELL_PAD_CTRL_SELECT;
-  *digit2 = (report->buttons & btnX) ? *digit2 | CELL_PAD_CTRL_SQUARE : *digit2 & ~CELL_PAD_CTRL_SQUARE;
-  *digit2 = (report->buttons & btnA) ? *digit2 | CELL_PAD_CTRL_CROSS : *digit2 & ~CELL_PAD_CTRL_CROSS;
-  *digit2 = (report->buttons & btnB) ? *digit2 | CELL_PAD_CTRL_CIRCLE : *digit2 & ~CELL_PAD_CTRL_CIRCLE;
-  *digit2 = (report->buttons & btnY) ? *digit2 | CELL_PAD_CTRL_TRIANGLE : *digit2 & ~CELL_PAD_CTRL_TRIANGLE;
-  *digit2 = (report->buttons & btnShoulderRight) ? *digit2 | CELL_PAD_CTRL_R1 : *digit2 & ~CELL_PAD_CTRL_R1;
-  *digit2 = (report->buttons & btnShoulderLeft) ? *digit2 | CELL_PAD_CTRL_L1 : *digit2 & ~CELL_PAD_CTRL_L1;
-  *digit2 = (report->trigL > 0) ? *digit2 | CELL_PAD_CTRL_L2 : *digit2 & ~CELL_PAD_CTRL_L2;
-  *digit2 = (report->trigR > 0) ? *digit2 | CELL_PAD_CTRL_R2 : *digit2 & ~CELL_PAD_CTRL_R2;
-
-  // emulate pressure values except for L2 and R2, button presses correspond to max sensitivity value
-  *press_l2 = (report->trigL);
-  *press_r2 = (report->trigR);
-  *press_l1 = (report->buttons & btnShoulderLeft) ? 0xFF : 0;
-  *press_r1 = (report->buttons & btnShoulderRight) ? 0xFF : 0;
-  *press_up = (report->buttons & btnDigiUp) ? 0xFF : 0;
-  *press_down = (report->buttons & btnDigiDown) ? 0xFF : 0;
-  *press_left = (report->buttons & btnDigiLeft) ? 0xFF : 0;
-  *press_right = (report->buttons & btnDigiRight) ? 0xFF : 0;
-  *press_square = (report->buttons & btnX) ? 0xFF : 0;
-  *press_circle = (report->buttons & btnB) ? 0xFF : 0;
-  *press_cross = (report->buttons & btnA) ? 0xFF : 0;
-  *press_triangle = (report->buttons & btnY) ? 0xFF : 0;
-
-  // PS3 pads use 8 bit values for each axis while Xbox pads use 16 bit
-  // convert Xbox analog values for PS3 compatibility
-  *analog_rx = (report->right.x-0x80) & 0x00FF;
-  *analog_ry = ((report->right.y ^ 0xFF)-0x80) & 0x00FF;
-  *analog_lx = (report->left.x-0x80) & 0x00FF;
-  *analog_ly = ((report->left.y ^ 0xFF)-0x80) & 0x00FF;
-
-  // send pad data to virtual pad
-  cellPadLddDataInsert(handle[id], &data);
+  return(plan->n);
 }
 
-static int32_t xpad_read_input(int32_t id, void *data) {
-  unsigned char *p;
-  int32_t i;
-  unsigned char *xpadbuf;
-  XPAD_UNIT_t *unit;
+static void hid_read_report(int32_t id, HID_PLAN_t *plan, uint8_t *readBuf) {
+  uint32_t buttons, v, d, i;
+  uint32_t axis[HID_AXES] = {0x8000, 0x8000, 0x8000, 0x8000, 0, 0};
+  int32_t s;
+  uint8_t *q, lx, ly, rx, ry, trigL, trigR;
+  HID_FIELD_t *f;
+
+  // run the plan, each step is one unaligned read, a mask and a table or scale
+  buttons = 0;
+  for (i = 0; i < plan->n; i++) {
+    f = &plan->field[i];
+    q = readBuf + f->byte;
+    v = ((q[0] | (q[1] << 8) | (q[2] << 16) | ((uint32_t)q[3] << 24)) >> f->shift) & f->mask;
+    if (f->op == HID_OP_BUTTONS) {
+      buttons |= hid_lut[f->arg][(v << f->lshift) & 0xFF];
+      continue;
+    }
+    s = ((int32_t)(v << f->sext) >> f->sext) - f->min;
+    if (f->op == HID_OP_HAT) {
 
-  p = (unsigned char *)data;
-  if (id > MAX_XPAD_NUM) {
-    return(-1);
+      // out of range is the hat's null state
+      if ((uint32_t)s <= f->range) {
+        buttons |= hid_hat[s * f->arg];
+      }
+    } else {
+      d = (s < 0) ? 0 : ((uint32_t)s > f->range) ? f->range : (uint32_t)s;
+      axis[f->arg] = (uint32_t)(((uint64_t)d * f->scale) >> 16);
+    }
   }
-  if ((unit = XPAD.con_unit[id]) == NULL) {
-    return(-1);
+
+  // HID axes grow right and down like PS3 ones
+  if (!stick_shaped) {
+    lx = axis[0] >> 8;
+    ly = axis[1] >> 8;
+    rx = axis[2] >> 8;
+    ry = axis[3] >> 8;
+  } else {
+    stick_shape((int32_t)axis[0] - 32768, (int32_t)axis[1] - 32768, &lx, &ly);
+    stick_shape((int32_t)axis[2] - 32768, (int32_t)axis[3] - 32768, &rx, &ry);
   }
 
-  // get from ringbuffer
-  block(ringbuf_mutex);
-  if (unit->rblen > 0) {
-    xpadbuf = &unit->ringbuf[unit->rp][0];
-    *p++ = xpadbuf[0]; // count
-    *p++ = xpadbuf[1]; // size
-    memcpy(p, &xpadbuf[2], unit->payload);
-    if (++unit->rp >= RINGBUF_SIZE) {
-      unit->rp = 0;
-    }
-    XBOX360_IN_REPORT *report = (XBOX360_IN_REPORT *)p;
-    if ((report->header.command == inReport) && (report->header.size == sizeof(XBOX360_IN_REPORT))) {
-      xpad_read_report(unit->number, p);
-    }
-    unit->rblen--;
+  // pads with digital L2 and R2 only report them as fully pressed
+  if (plan->axes & (3 << 4)) {
+    trigL = axis[4] >> 8;
+    trigR = axis[5] >> 8;
   } else {
-    *p++ = 0; // count
-    memset(p, 0, unit->payload);
+    trigL = (buttons & PAD_D2(CELL_PAD_CTRL_L2)) ? 0xFF : 0;
+    trigR = (buttons & PAD_D2(CELL_PAD_CTRL_R2)) ? 0xFF : 0;
   }
-  unblock(ringbuf_mutex);
-  return(0);
+  pad_insert(id, buttons, trigL, trigR, lx, ly, rx, ry, NULL, NULL);
 }
 
-static int32_t xpad_set_led(int32_t id, uint8_t led) {
-  uint8_t out[3] = {0x01, 0x03, led};
+static int32_t hid_live(XPAD_UNIT_t *unit) {
+  int32_t n = unit->number;
 
-  if (write_xpad(id, out, 3) < 0) {
-    return(-1);
-  }
-  return(CELL_OK);
+  // a device unplugged while a control transfer was in flight has given its unit back
+  return(n >= 0 && n < MAX_XPAD_NUM && XPAD.con_unit[n] == unit && cellUsbdGetPrivateData(unit->conf.dev_id) == unit);
 }
 
-static int32_t xpad_set_rumble(int32_t id, uint8_t lval, uint8_t rval) {
-  uint8_t out[8] = {0x00, 0x08, 0x00, lval, rval, 0x00, 0x00, 0x00};
+static void hid_desc_done(int32_t result, int32_t count, void *arg) {
+  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
+  HID_PLAN_t *plan;
 
-  if (write_xpad(id, out, 8) < 0) {
-    return(-1);
+  if (!hid_live(unit)) {
+    return;
   }
-  return(CELL_OK);
-}
-// end of wired controller specific methods 
 
-// start of wireless controller specific methods
-static int32_t get_device_desc(int32_t dev_id, void *p) {
-  (void) dev_id;
-  UsbDeviceDescriptor *desc = (UsbDeviceDescriptor *)p;
+  // nothing in the descriptor maps to a pad, the device stays attached
+  // without a unit or a slot and detach has nothing left to free
+  plan = &hid_plan[unit->number];
+  if (result != HC_CC_NOERR || hid_compile(plan, unit->data, count) <= 0 || plan->len + (plan->report_id != 0) > unit->payload) {
+    plan->n = 0;
+    stats.hid_failed++;
+    cellUsbdSetPrivateData(unit->conf.dev_id, NULL);
+    unit_free(unit);
+    return;
+  }
 
-  // do nothing
-  return(CELL_OK);
+  hid_start(result, count, unit);
 }
 
-static int32_t get_configration_desc(int32_t dev_id, void *p) {
-  (void) dev_id;
-  UsbConfigurationDescriptor *desc = (UsbConfigurationDescriptor *)p;
-  uint16_t wTotalLength;
-  wTotalLength = SWAP16(desc->wTotalLength);
+static void hid_start(int32_t result, int32_t count, void *arg) {
+  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
+  (void)result;
+  (void)count;
 
-  // do nothing
-  return(CELL_OK);
+  // ready to decode, start reading and add to connected controllers list
+  if (!hid_live(unit)) {
+    return;
+  }
+  set_config_done(HC_CC_NOERR, 0, unit);
+  slot_connect(unit, 1);
+  sys_event_flag_set(xpad_event, XPAD_EVENT_WAKE);
 }
 
-static int32_t get_interface_desc(int32_t dev_id, void *p) {
-  (void) dev_id;
-  UsbInterfaceDescriptor *desc = (UsbInterfaceDescriptor *)p;
-
-  // do nothing
-  return(CELL_OK);
-}
+// the report descriptor is fetched into unit->data, the smallest pool unit must hold the longest one
+typedef char hid_desc_fits[(UNIT_POOL_STRIDE(1, 2) - sizeof(XPAD_UNIT_t) >= HID_DESC_MAX) ? 1 : -1];
 
-static int32_t get_endpoint_desc(int32_t dev_id, void *p) {
-  (void) dev_id;
-  UsbEndpointDescriptor *edesc = (UsbEndpointDescriptor *)p;
-  int32_t payload;
-  XPAD_UNIT_t *unit;
+static void hid_config_done(int32_t result, int32_t count, void *arg) {
+  XPAD_UNIT_t *unit = (XPAD_UNIT_t *)arg;
+  UsbDeviceRequest req;
 
-  if (edesc->bEndpointAddress == 0x81 || edesc->bEndpointAddress == 0x83 || edesc->bEndpointAddress == 0x85 || edesc->bEndpointAddress == 0x87) {
-    payload = SWAP16(edesc->wMaxPacketSize);
-    if ((unit = unit_alloc(dev_id, payload, (edesc->bEndpointAddress - 0x01) & 0x0f, 0, XTYPE_XBOX360W)) == NULL) {
-      return(CELL_USBD_ATTACH_FAILED);
-    }
-    if ((unit->c_pipe = cellUsbdOpenPipe(dev_id, NULL)) < 0) {
-      unit_free(unit);
-      return(CELL_USBD_ATTACH_FAILED);
-    }
-    if ((unit->i_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
-      unit_free(unit);
-      return(CELL_USBD_ATTACH_FAILED);
-    }
-    edesc->bEndpointAddress &= 0x0f; // XBox controller out endpoint, ex: 0x81 & 0x0f == 0x01
-    if ((unit->o_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
-      unit_free(unit);
-      return(CELL_USBD_ATTACH_FAILED);
-    }
+  // DualShock reports have a fixed layout, no descriptor to compile
+  if (unit->xtype == PTYPE_PS3) {
+    ds3_enable(unit);
+    return;
+  }
+  if (unit->xtype == PTYPE_PS4) {
+    hid_start(result, count, unit);
+    return;
+  }
 
-    // endpoint found, set configuration and add to connected controllers list
-    cellUsbdSetConfiguration(unit->c_pipe, 1, set_config_done, unit);
-    block(xpad_mutex);
-    XPAD.n++;
-    XPAD.is_connected[unit->number] = 1;
-    XPAD.con_unit[unit->number] = unit;
-    unblock(xpad_mutex);
+  // GET_DESCRIPTOR for the interface's report descriptor, into the transfer
+  // buffers which are free until reading starts
+  if (!hid_live(unit)) {
+    return;
   }
-  return(CELL_USBD_ATTACH_SUCCEEDED);
+  req.bmRequestType = 0x81;
+  req.bRequest = 0x06;
+  req.wValue = SWAP16(0x2200);
+  req.wIndex = SWAP16(unit->conf.ifnum);
+  req.wLength = SWAP16(hid_plan[unit->number].desc_len);
+  cellUsbdControlTransfer(unit->conf.c_pipe, &req, unit->data, hid_desc_done, unit);
 }
 
-static int32_t xpadw_probe(int32_t dev_id) {
+static int32_t hid_probe(int32_t dev_id) {
   uint16_t idVendor, idProduct;
-  uint32_t i;
   UsbDeviceDescriptor *ddesc;
   UsbInterfaceDescriptor *idesc;
+  DEVICE_ENTRY_t *dev;
 
   block(xpad_mutex);
   if (XPAD.n >= MAX_XPAD_NUM) {
@@ -803,161 +3542,111 @@ static int32_t xpadw_probe(int32_t dev_id) {
   // make sure product id and vendor id are valid
   idVendor = SWAP16(ddesc->idVendor);
   idProduct = SWAP16(ddesc->idProduct);
-  for (i = 0; i < MAX_XPADW_DEV_NUM; i++) {
-    if (xpadw_info[i].vid == idVendor && xpadw_info[i].pid == idProduct) {
-      return(CELL_USBD_PROBE_SUCCEEDED);
-    }
+  if ((dev = device_lookup(idVendor, idProduct)) != NULL && (dev->type == XTYPE_HID || dev->type == PTYPE_PS3 || dev->type == PTYPE_PS4)) {
+    return(CELL_USBD_PROBE_SUCCEEDED);
   }
   return(CELL_USBD_PROBE_FAILED);
 }
 
-static int xpadw_attach(int32_t dev_id) {
-  uint8_t* desc = 0;
-  uint32_t i;
+static int32_t hid_attach(int32_t dev_id) {
+  int32_t payload, desc_len;
+  uint8_t *hdesc;
+  UsbDeviceDescriptor *ddesc;
+  UsbConfigurationDescriptor *cdesc;
+  UsbInterfaceDescriptor *idesc;
+  UsbEndpointDescriptor *edesc;
+  DEVICE_ENTRY_t *dev;
+  XPAD_UNIT_t *unit;
 
-  // Xbox 360 wireless receivers have 4 endpoints (1 per controller)
-  // all 4 need to be listened to at all times in case of controller connection/disconnection
-  // traverse through its usb device descriptor and find the endpoints
-  while (1) {
-    if ((desc = cellUsbdScanStaticDescriptor(dev_id, desc, 0)) == 0) {
-        break;
-    }
-    for (i = 0; i < DESCRIPTOR_TABLE_SIZE; i++) {
-      if (descriptor_table[i].bDescriptorType == desc[1]) {
-        break;
-      }
+  if ((ddesc = (UsbDeviceDescriptor *)cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_DEVICE)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((dev = device_lookup(SWAP16(ddesc->idVendor), SWAP16(ddesc->idProduct))) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((cdesc = (UsbConfigurationDescriptor *) cellUsbdScanStaticDescriptor(dev_id, NULL, USB_DESCRIPTOR_TYPE_CONFIGURATION)) == NULL) {
+    return (CELL_USBD_ATTACH_FAILED);
+  }
+
+  // first HID interface, its class descriptor and interrupt in endpoint
+  idesc = (UsbInterfaceDescriptor *)cdesc;
+  do {
+    if ((idesc = (UsbInterfaceDescriptor *) cellUsbdScanStaticDescriptor(dev_id, idesc, USB_DESCRIPTOR_TYPE_INTERFACE)) == NULL) {
+      return(CELL_USBD_ATTACH_FAILED);
     }
-    if (i != DESCRIPTOR_TABLE_SIZE) {
-      descriptor_table[i].dump_descriptor(dev_id, desc);
+  } while (idesc->bInterfaceClass != 0x03); // HID class
+  if ((hdesc = (uint8_t *) cellUsbdScanStaticDescriptor(dev_id, idesc, 0x21)) == NULL || hdesc[0] < 9 || hdesc[6] != 0x22) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  desc_len = hdesc[7] | (hdesc[8] << 8);
+  if (desc_len == 0 || desc_len > HID_DESC_MAX) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  edesc = (UsbEndpointDescriptor *)idesc;
+  do {
+    if ((edesc = (UsbEndpointDescriptor *) cellUsbdScanStaticDescriptor(dev_id, edesc, USB_DESCRIPTOR_TYPE_ENDPOINT)) == NULL) {
+      return(CELL_USBD_ATTACH_FAILED);
     }
+  } while (!(edesc->bEndpointAddress & 0x80) || (edesc->bmAttributes & 0x03) != 0x03);
+  payload = SWAP16(edesc->wMaxPacketSize);
+  if ((unit = unit_alloc(dev_id, payload, edesc->bInterval, idesc->bInterfaceNumber, idesc->bAlternateSetting, dev->type, dev->rmode)) == NULL) {
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  memset(&hid_plan[unit->number], 0, sizeof(HID_PLAN_t));
+  hid_plan[unit->number].desc_len = desc_len;
+  unit->conf.o_pipe = -1;
+  if ((unit->conf.c_pipe = cellUsbdOpenPipe(dev_id, NULL)) < 0) {
+    unit_free(unit);
+    return(CELL_USBD_ATTACH_FAILED);
+  }
+  if ((unit->i_pipe = cellUsbdOpenPipe(dev_id, edesc)) < 0) {
+    unit_free(unit);
+    return(CELL_USBD_ATTACH_FAILED);
   }
+
+  // set configuration, the report descriptor is fetched and compiled once it is done
+  cellUsbdSetPrivateData(dev_id, unit);
+  cellUsbdSetConfiguration(unit->conf.c_pipe, cdesc->bConfigurationValue, hid_config_done, unit);
   return(CELL_USBD_ATTACH_SUCCEEDED);
 }
 
-static int32_t xpadw_detach(int32_t dev_id) {
-  int32_t r;
+static int32_t hid_detach(int32_t dev_id) {
+  XPAD_UNIT_t *unit;
 
-  // Xbox wireless receiver has been unplugged
-  // disconnect all virtual controllers associated to it
-  r = xpadw_detach_all();
-  return(r);
+  // HID gamepad has been unplugged, it only holds a virtual controller
+  // if its report descriptor compiled
+  if ((unit = (XPAD_UNIT_t *)cellUsbdGetPrivateData(dev_id)) == NULL) {
+    return(CELL_USBD_DETACH_FAILED);
+  }
+  if (XPAD.connected & (1 << unit->number)) {
+    slot_disconnect(unit);
+  }
+  unit_free(unit);
+  return(CELL_USBD_DETACH_SUCCEEDED);
 }
 
-static int32_t xpadw_detach_all(void) {
+static int32_t hid_detach_all(void) {
   int32_t i;
+  uint32_t live;
   XPAD_UNIT_t *unit;
 
-  // detach all wireless controllers
-  block(xpad_mutex);
-  for (i = 0; i < MAX_XPAD_NUM; i++) {
-    if (XPAD.is_connected[i]) {
-      unit = XPAD.con_unit[i];
-      if (unit->xtype == XTYPE_XBOX360) {
-        XPAD.n--;
-        XPAD.is_connected[unit->number] = 0;
-        XPAD.con_unit[unit->number] = NULL;
-        unregister_ldd_controller(unit);
-        unit_free(unit);
-      }
+  // detach all HID gamepads and DualShocks
+  live = XPAD.connected;
+  while (live) {
+    i = slot_next(&live);
+    unit = XPAD.con_unit[i];
+    if (unit->xtype == XTYPE_HID || unit->xtype == PTYPE_PS3 || unit->xtype == PTYPE_PS4) {
+      slot_disconnect(unit);
+      unit_free(unit);
     }
   }
-  unblock(xpad_mutex);
   return(CELL_USBD_DETACH_SUCCEEDED);
 }
 
-static void xpadw_read_report(int32_t id, uint8_t *readBuf) {
-  uint16_t *digit0, *digit1, *digit2,
-           *analog_rx, *analog_ry, *analog_lx, *analog_ly,
-           *press_l2, *press_r2, *press_l1, *press_r1,
-           *press_up, *press_down, *press_left, *press_right,
-           *press_cross, *press_square, *press_circle, *press_triangle;
-  XBOX360W_IN_REPORT *report;
-  CellPadData data;
-
-  report = (XBOX360W_IN_REPORT *)readBuf;
-  memset(&data, 0, sizeof(CellPadData));
-  data.len = 24;
-
-  // map location of each button in virtual pad's data
-  digit0 = &data.button[0];
-  digit1 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL1];
-  digit2 = &data.button[CELL_PAD_BTN_OFFSET_DIGITAL2];
-  analog_rx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X];
-  analog_ry = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y];
-  analog_lx = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X];
-  analog_ly = &data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y];
-  press_l2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L2];
-  press_r2 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R2];
-  press_l1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_L1];
-  press_r1 = &data.button[CELL_PAD_BTN_OFFSET_PRESS_R1];
-  press_right = &data.button[CELL_PAD_BTN_OFFSET_PRESS_RIGHT];
-  press_left = &data.button[CELL_PAD_BTN_OFFSET_PRESS_LEFT];
-  press_up = &data.button[CELL_PAD_BTN_OFFSET_PRESS_UP];
-  press_down = &data.button[CELL_PAD_BTN_OFFSET_PRESS_DOWN];
-  press_cross = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CROSS];
-  press_square = &data.button[CELL_PAD_BTN_OFFSET_PRESS_SQUARE];
-  press_circle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_CIRCLE];
-  press_triangle = &data.button[CELL_PAD_BTN_OFFSET_PRESS_TRIANGLE];
-
-  // set default controller values
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y] = 0x0080;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_X] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Y] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_Z] = 0x0200;
-  data.button[CELL_PAD_BTN_OFFSET_SENSOR_G] = 0x0200;
-
-  // read values from Xbox controller and map it to the virtual pad
-  *digit0 = (report->buttons & btnXbox) ? *digit0 | CELL_PAD_CTRL_LDD_PS : *digit0 & ~CELL_PAD_CTRL_LDD_PS;
-  *digit1 = (report->buttons & btnDigiLeft) ? *digit1 | CELL_PAD_CTRL_LEFT : *digit1 & ~CELL_PAD_CTRL_LEFT;
-  *digit1 = (report->buttons & btnDigiDown) ? *digit1 | CELL_PAD_CTRL_DOWN : *digit1 & ~CELL_PAD_CTRL_DOWN;
-  *digit1 = (report->buttons & btnDigiRight) ? *digit1 | CELL_PAD_CTRL_RIGHT : *digit1 & ~CELL_PAD_CTRL_RIGHT;
-  *digit1 = (report->buttons & btnDigiUp) ? *digit1 | CELL_PAD_CTRL_UP : *digit1 & ~CELL_PAD_CTRL_UP;
-  *digit1 = (report->buttons & btnStart) ? *digit1 | CELL_PAD_CTRL_START : *digit1 & ~CELL_PAD_CTRL_START;
-  *digit1 = (report->buttons & btnHatRight) ? *digit1 | CELL_PAD_CTRL_R3 : *digit1 & ~CELL_PAD_CTRL_R3;
-  *digit1 = (report->buttons & btnHatLeft) ? *digit1 | CELL_PAD_CTRL_L3 : *digit1 & ~CELL_PAD_CTRL_L3;
-  *digit1 = (report->buttons & btnBack) ? *digit1 | CELL_PAD_CTRL_SELECT : *digit1 & ~CELL_PAD_CTRL_SELECT;
-  *digit2 = (report->buttons & btnX) ? *digit2 | CELL_PAD_CTRL_SQUARE : *digit2 & ~CELL_PAD_CTRL_SQUARE;
-  *digit2 = (report->buttons & btnA) ? *digit2 | CELL_PAD_CTRL_CROSS : *digit2 & ~CELL_PAD_CTRL_CROSS;
-  *digit2 = (report->buttons & btnB) ? *digit2 | CELL_PAD_CTRL_CIRCLE : *digit2 & ~CELL_PAD_CTRL_CIRCLE;
-  *digit2 = (report->buttons & btnY) ? *digit2 | CELL_PAD_CTRL_TRIANGLE : *digit2 & ~CELL_PAD_CTRL_TRIANGLE;
-  *digit2 = (report->buttons & btnShoulderRight) ? *digit2 | CELL_PAD_CTRL_R1 : *digit2 & ~CELL_PAD_CTRL_R1;
-  *digit2 = (report->buttons & btnShoulderLeft) ? *digit2 | CELL_PAD_CTRL_L1 : *digit2 & ~CELL_PAD_CTRL_L1;
-  *digit2 = (report->trigL > 0) ? *digit2 | CELL_PAD_CTRL_L2 : *digit2 & ~CELL_PAD_CTRL_L2;
-  *digit2 = (report->trigR > 0) ? *digit2 | CELL_PAD_CTRL_R2 : *digit2 & ~CELL_PAD_CTRL_R2;
-
-  // emulate pressure values except for L2 and R2, button presses correspond to max sensitivity value
-  *press_l2 = (report->trigL);
-  *press_r2 = (report->trigR);
-  *press_l1 = (report->buttons & btnShoulderLeft) ? 0xFF : 0;
-  *press_r1 = (report->buttons & btnShoulderRight) ? 0xFF : 0;
-  *press_up = (report->buttons & btnDigiUp) ? 0xFF : 0;
-  *press_down = (report->buttons & btnDigiDown) ? 0xFF : 0;
-  *press_left = (report->buttons & btnDigiLeft) ? 0xFF : 0;
-  *press_right = (report->buttons & btnDigiRight) ? 0xFF : 0;
-  *press_square = (report->buttons & btnX) ? 0xFF : 0;
-  *press_circle = (report->buttons & btnB) ? 0xFF : 0;
-  *press_cross = (report->buttons & btnA) ? 0xFF : 0;
-  *press_triangle = (report->buttons & btnY) ? 0xFF : 0;
-
-  // PS3 pads use 8 bit values for each axis while Xbox pads use 16 bit
-  // convert Xbox analog values for PS3 compatibility 
-  *analog_rx = (report->right.x-0x80) & 0x00FF;
-  *analog_ry = ((report->right.y ^ 0xFF)-0x80) & 0x00FF;
-  *analog_lx = (report->left.x-0x80) & 0x00FF;
-  *analog_ly = ((report->left.y ^ 0xFF)-0x80) & 0x00FF;
-
-  // send pad data to virtual pad
-  cellPadLddDataInsert(handle[id], &data);
-}
-
-static int32_t xpadw_read_input(int32_t id, void *data) {
+static int32_t hid_read_input(int32_t id, void *data) {
   unsigned char *p;
-  int32_t i, port;
-  unsigned char *xpadbuf;
-  XBOX360W_IN_REPORT *report;
+  int32_t count;
+  HID_PLAN_t *plan;
   XPAD_UNIT_t *unit;
 
   p = (unsigned char *)data;
@@ -968,59 +3657,131 @@ static int32_t xpadw_read_input(int32_t id, void *data) {
     return(-1);
   }
 
-  // get from ringbuffer
-  block(ringbuf_mutex);
-  if (unit->rblen > 0) {
-    xpadbuf = &unit->ringbuf[unit->rp][0];
-    *p++ = xpadbuf[0]; // count
-    *p++ = xpadbuf[1]; // size
-    memcpy(p, &xpadbuf[2], unit->payload);
-    if (++unit->rp >= RINGBUF_SIZE) {
-      unit->rp = 0;
+  // get the next report, data holds count and size followed by the payload
+  if (report_get(unit, p) == 0) {
+    return(0);
+  }
+  count = p[1];
+  p += 2;
+
+  // reports with other ids carry nothing the plan reads
+  plan = &hid_plan[id];
+  if (plan->report_id != 0) {
+    if (count < 1 || p[0] != plan->report_id) {
+      return(1);
     }
-    if (p[0] == 0x08 && p[1] == 0x80) {
+    p++;
+    count--;
+  }
+  if (count >= plan->len) {
+    hid_read_report(unit->number, plan, p);
+  }
+  return(1);
+}
 
-      // controller connected to receiver
-      register_ldd_controller(unit);
-    } else if (p[0] == 0x08 && p[1] == 0x00) {
+static int32_t hid_out_report(XPAD_UNIT_t *unit, uint32_t what) {
+  (void)unit;
+  (void)what;
 
-      // controller disconnected from receiver
-      unregister_ldd_controller(unit);
-    }
-    report = (XBOX360W_IN_REPORT *)p;
-    if ((p[1] == 0x01) && (report->header.command == inReport) && (report->header.size == sizeof(XBOX360W_IN_REPORT))) {
-      xpadw_read_report(unit->number, p);
-    }
-    unit->rblen--;
-  } else {
-    *p++ = 0; /* count */
-    memset(p, 0, unit->payload);
-  }
-  unblock(ringbuf_mutex);
+  // no out endpoint is used, the led is dropped
   return(0);
 }
+// end of hid controller specific methods
+
+// start of dualshock controller specific methods
+static void ds3_enable(XPAD_UNIT_t *unit) {
+  UsbDeviceRequest req;
+
+  // a DualShock 3 on usb only sends input reports once feature 0xF2 was read
+  req.bmRequestType = 0xA1;
+  req.bRequest = 0x01;
+  req.wValue = SWAP16(0x03F2);
+  req.wIndex = SWAP16(unit->conf.ifnum);
+  req.wLength = SWAP16(DS3_FEATURE_LEN);
+  cellUsbdControlTransfer(unit->conf.c_pipe, &req, unit->data, hid_start, unit);
+}
 
-static int32_t xpadw_set_led(int32_t id, uint8_t led) {
-  uint8_t out[4] = {0x00, 0x00, 0x08, led | 0x40};
+static void ds3_read_report(int32_t id, uint8_t *readBuf) {
+  uint32_t buttons, i;
+  uint16_t press[10], sensor[4];
+  uint8_t lx, ly, rx, ry;
 
-  if (write_xpad(id, out, 4) < 0) {
-    return(-1);
+  // DIGITAL1 and DIGITAL2 bytes are already in pad order, PS is bit 0 of byte 4
+  buttons = PAD_D1(readBuf[2]) | PAD_D2(readBuf[3]) | ((readBuf[4] & 0x01) ? PAD_PS : 0);
+  for (i = 0; i < 10; i++) {
+    press[i] = readBuf[ds3_press[i]];
   }
-  return(CELL_OK);
+
+  // sixaxis values are big endian 10 bit centered on 0x200, as pad data wants them
+  sensor[0] = ((readBuf[41] << 8) | readBuf[42]) & 0x3FF;
+  sensor[1] = ((readBuf[43] << 8) | readBuf[44]) & 0x3FF;
+  sensor[2] = ((readBuf[45] << 8) | readBuf[46]) & 0x3FF;
+  sensor[3] = ((readBuf[47] << 8) | readBuf[48]) & 0x3FF;
+  stick_convert8(readBuf[6], readBuf[7], &lx, &ly);
+  stick_convert8(readBuf[8], readBuf[9], &rx, &ry);
+  pad_insert(id, buttons, readBuf[18], readBuf[19], lx, ly, rx, ry, press, sensor);
+}
+
+static void ds4_read_report(int32_t id, uint8_t *readBuf) {
+  uint32_t buttons;
+  int32_t v;
+  uint16_t sensor[4];
+  uint8_t lx, ly, rx, ry;
+
+  // buttons follow the HID gamepad order the hid tables use, the hat is the low nibble of byte 5
+  buttons = hid_lut[0][(readBuf[5] >> 4) | ((readBuf[6] << 4) & 0xF0)] | hid_lut[1][(readBuf[6] >> 4) | ((readBuf[7] & 0x03) << 4)];
+  if ((readBuf[5] & 0x0F) < 8) {
+    buttons |= hid_hat[readBuf[5] & 0x0F];
+  }
+
+  // little endian 16 bit accelerometer and yaw gyro, inverted and scaled to sixaxis counts
+  v = (int16_t)(readBuf[19] | (readBuf[20] << 8));
+  sensor[0] = sensor_clamp(-((v * DS4_ACCEL_SCALE) >> 16));
+  v = (int16_t)(readBuf[21] | (readBuf[22] << 8));
+  sensor[1] = sensor_clamp(-((v * DS4_ACCEL_SCALE) >> 16));
+  v = (int16_t)(readBuf[23] | (readBuf[24] << 8));
+  sensor[2] = sensor_clamp(-((v * DS4_ACCEL_SCALE) >> 16));
+  v = (int16_t)(readBuf[15] | (readBuf[16] << 8));
+  sensor[3] = sensor_clamp(-((v * DS4_GYRO_SCALE) >> 16));
+  stick_convert8(readBuf[1], readBuf[2], &lx, &ly);
+  stick_convert8(readBuf[3], readBuf[4], &rx, &ry);
+  pad_insert(id, buttons, readBuf[8], readBuf[9], lx, ly, rx, ry, NULL, sensor);
 }
 
-static int32_t xpadw_set_rumble(int32_t id, uint8_t lval, uint8_t rval) {
-  uint8_t out[7] = {0x00, 0x01, 0x0f, 0xc0, 0x00, lval, rval};
+static int32_t ds_read_input(int32_t id, void *data) {
+  unsigned char *p;
+  int32_t count;
+  XPAD_UNIT_t *unit;
 
-  if (write_xpad(id, out, 7) < 0) {
+  p = (unsigned char *)data;
+  if (id > MAX_XPAD_NUM) {
     return(-1);
   }
-  return(CELL_OK);
+  if ((unit = XPAD.con_unit[id]) == NULL) {
+    return(-1);
+  }
+
+  // get the next report, data holds count and size followed by the payload
+  if (report_get(unit, p) == 0) {
+    return(0);
+  }
+  count = p[1];
+  p += 2;
+  if (p[0] != 0x01) {
+    return(1);
+  }
+  if (unit->xtype == PTYPE_PS3 && count >= DS3_REPORT_LEN) {
+    ds3_read_report(unit->number, p);
+  } else if (unit->xtype == PTYPE_PS4 && count >= DS4_REPORT_LEN) {
+    ds4_read_report(unit->number, p);
+  }
+  return(1);
 }
-// end of wireless controller specific methods
+// end of dualshock controller specific methods
 
 static int32_t check_pad_status(void) {
   int32_t i, cr, port, pad;
+  uint32_t live;
   XPAD_UNIT_t *unit;
   CellPadInfo2 pad_info2;
 
@@ -1032,12 +3793,16 @@ static int32_t check_pad_status(void) {
     if (pad_info2.port_status[pad] & CELL_PAD_STATUS_ASSIGN_CHANGES) {
 
       // controller port changed, assign new led's to all controllers
-      for (i = 0; i < MAX_XPAD_NUM; i++) {
-        if (XPAD.is_connected[i] > 0) {
-          unit = XPAD.con_unit[i];
-          port = cellPadLddGetPortNo(handle[i]);
-          unit->set_led(unit->number, xpad_led[port%4]);
+      live = XPAD.connected;
+      while (live) {
+        i = slot_next(&live);
+        block(slot_mutex[i]);
+        unit = XPAD.con_unit[i];
+        port = cellPadLddGetPortNo(handle[i]);
+        if (unit != NULL && port >= 0) {
+          out_set_led(unit, xpad_led[port%4]);
         }
+        unblock(slot_mutex[i]);
       }
     }
   }
@@ -1046,42 +3811,65 @@ static int32_t check_pad_status(void) {
 
 static int32_t init_usb(void) {
   int32_t r, i;
-  sys_mutex_attribute_t mutex_attr1;
-  sys_mutex_attribute_t mutex_attr2;
+  sys_mutex_attribute_t mutex_attr;
+  sys_event_flag_attribute_t event_attr;
 
-  sys_mutex_attribute_initialize(mutex_attr1);
-  sys_mutex_attribute_initialize(mutex_attr2);
-  if ((r = sys_mutex_create(&ringbuf_mutex, &mutex_attr1)) != CELL_OK) {
+  sys_mutex_attribute_initialize(mutex_attr);
+  sys_event_flag_attribute_initialize(event_attr);
+  if ((r = sys_mutex_create(&xpad_mutex, &mutex_attr)) != CELL_OK) {
+    return(r);
+  }
+  if ((r = sys_mutex_create(&receiver_mutex, &mutex_attr)) != CELL_OK) {
     return(r);
   }
-  if ((r = sys_mutex_create(&xpad_mutex, &mutex_attr2)) != CELL_OK) {
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    if ((r = sys_mutex_create(&slot_mutex[i], &mutex_attr)) != CELL_OK) {
+      return(r);
+    }
+  }
+  if ((r = sys_event_flag_create(&xpad_event, &event_attr, 0)) != CELL_OK) {
     return(r);
   }
 
+  // settings override the defaults before anything uses them
+  config_errors = 0;
+  config_read(SETTINGS_FILE, settings_parse_line);
+  remap_load();
+  title_load();
+
   // initialize all controller handlers
   memset(handle, -1, sizeof(int32_t) * CELL_PAD_MAX_PORT_NUM);
+  build_pad_tables();
+  tb_per_ms = sys_time_get_timebase_frequency() / 1000;
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    pad_image_reset(i);
+  }
+  for (i = 0; i < MAX_XPADW_RECEIVERS; i++) {
+    receiver[i].dev_id = -1;
+  }
+#ifdef XPAD_LATENCY
+  memset(&latency, 0, sizeof(latency));
+  latency.since = __mftb();
+#endif
 
-  // register wired Xbox controller device types
-  memset(&XPAD, 0, sizeof(XPAD));
-  for (i = 0; i < MAX_XPAD_DEV_NUM; i++) {
-    xpad_ops.name = xpad_info[i].name;
-    if ((r = cellUsbdRegisterExtraLdd(&xpad_ops, xpad_info[i].vid, xpad_info[i].pid)) != CELL_OK) {
-      return(r);
-    }
+  // unit memory for every port and receiver endpoint, taken before any device can attach
+  if ((r = unit_pool_init()) != CELL_OK) {
+    return(r);
   }
 
-  // register wireless Xbox controller device types
-  for (i = 0; i < MAX_XPADW_DEV_NUM; i++) {
-    xpadw_ops.name = xpadw_info[i].name;
-    if ((r = cellUsbdRegisterExtraLdd(&xpadw_ops, xpadw_info[i].vid, xpadw_info[i].pid)) != CELL_OK) {
-      return(r);
-    }
+  // load device types and register them by product id range
+  xpad_ops.name = "XPAD Wired Controller";
+  xpadw_ops.name = "XPAD Wireless Receiver";
+  hid_ops.name = "XPAD HID Gamepad";
+  device_load();
+  if ((r = device_register()) != CELL_OK) {
+    return(r);
   }
   return(CELL_OK);
 }
 
 static int32_t shutdown_usb(void) {
-  int32_t r;
+  int32_t r, i;
 
   if (( r = cellUsbdUnregisterExtraLdd(&xpad_ops)) != CELL_OK) {
     return(r);
@@ -1089,46 +3877,182 @@ static int32_t shutdown_usb(void) {
   if (( r = cellUsbdUnregisterExtraLdd(&xpadw_ops)) != CELL_OK) {
     return(r);
   }
-  if ((r = sys_mutex_destroy(ringbuf_mutex)) != CELL_OK) {
+
+  // only registered when xpad_devices.txt lists a HID device
+  cellUsbdUnregisterExtraLdd(&hid_ops);
+  if ((r = sys_mutex_destroy(xpad_mutex)) != CELL_OK) {
     return(r);
   }
-  if ((r = sys_mutex_destroy(xpad_mutex)) != CELL_OK) {
+  if ((r = sys_mutex_destroy(receiver_mutex)) != CELL_OK) {
+    return(r);
+  }
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    if ((r = sys_mutex_destroy(slot_mutex[i])) != CELL_OK) {
+      return(r);
+    }
+  }
+  if ((r = sys_event_flag_destroy(xpad_event)) != CELL_OK) {
     return(r);
   }
   return(CELL_OK);
 }
 
+static void poll_adapt(void) {
+  int32_t i;
+  uint32_t fast, slow, period, live;
+  XPAD_UNIT_t *unit;
+
+  // the fastest endpoint sets the period while input changes,
+  // queued reports limit how far it backs off once every pad is idle
+  fast = POLL_IDLE_MAX;
+  slow = POLL_IDLE_MAX;
+  live = XPAD.connected;
+  while (live) {
+    i = slot_next(&live);
+    if ((unit = XPAD.con_unit[i]) == NULL) {
+      continue;
+    }
+    period = (unit->conf.interval > 0) ? unit->conf.interval : 1;
+    fast = (period < fast) ? period : fast;
+    if (unit->rmode == REPORT_MODE_QUEUE) {
+      period *= unit->depth - 2;
+      slow = (period < slow) ? period : slow;
+    }
+  }
+  if (input_changed) {
+    poll_idle = 0;
+    input_changed = 0;
+  } else if (poll_idle < POLL_IDLE_PASSES * 8) {
+    poll_idle++;
+  }
+  period = fast << (poll_idle / POLL_IDLE_PASSES);
+  poll_period = (period < slow) ? period : slow;
+  stats.poll_period = (XPAD.n > 0) ? poll_period : 0;
+}
+
+static void rate_update(system_time_t elapsed) {
+  int32_t i;
+
+  // elapsed is in us
+  for (i = 0; i < MAX_XPAD_NUM; i++) {
+    stats.read_rate[i] = (uint32_t)((uint64_t)stats.reads[i] * 1000000 / elapsed);
+    stats.reads[i] = 0;
+  }
+}
+
+static uint64_t wait_input(void) {
+  uint64_t bits;
+  usecond_t timeout;
+
+  // poll mode reads every port on the adapted period, or parks until a pad attaches
+  // and no registration is left to finish, a link change is cleared once taken
+  // like in event mode so the receivers are only walked when one happened
+  if (input_mode == INPUT_MODE_POLL) {
+    bits = 0;
+    timeout = (XPAD.n == 0 && reg_pending == 0) ? 0 : 1000 * ((reg_pending & ~reg_late) ? REG_POLL_INTERVAL : poll_period);
+    sys_event_flag_wait(xpad_event, XPAD_EVENT_WAKE | XPAD_EVENT_LINK, SYS_EVENT_FLAG_WAIT_OR | SYS_EVENT_FLAG_WAIT_CLEAR, &bits, timeout);
+    return((XPAD_EVENT_ALL & ~XPAD_EVENT_LINK) | (bits & XPAD_EVENT_LINK));
+  }
+
+  // sleep until a report arrives, or forever if nothing is connected
+  // a connected pad still wakes us periodically for pad status checks
+  bits = 0;
+  timeout = (XPAD.n > 0) ? 1000 * HOUSEKEEPING_INTERVAL : 0;
+  if (reg_pending & ~reg_late) {
+    timeout = 1000 * REG_POLL_INTERVAL;
+  } else if (reg_pending && (timeout == 0 || timeout > 1000 * REG_LATE_INTERVAL)) {
+    timeout = 1000 * REG_LATE_INTERVAL;
+  }
+  if (sys_event_flag_wait(xpad_event, XPAD_EVENT_ALL, SYS_EVENT_FLAG_WAIT_OR | SYS_EVENT_FLAG_WAIT_CLEAR, &bits, timeout) != CELL_OK) {
+    return(0);
+  }
+  return(bits);
+}
+
 static int xpadd_thread(uint64_t arg) {
-  unsigned char xpad_data[MAX_XPAD_DATA_LEN];
+  unsigned char xpad_data[MAX_XPAD_PAYLOAD + 2 + HID_READ_PAD];
   int32_t i, r;
+  uint32_t bits;
+  uint64_t events;
+  system_time_t now, last_check = 0, last_rate = 0;
   XPAD_UNIT_t *unit;
 
   r = init_usb();
   if (r < 0) {
     sys_ppu_thread_exit(0);
   }
+  capture_start();
 
   // wait until we're back in xmb
   sys_timer_sleep(10);
+  vsh_retry();
   show_msg((char *)"XPAD Loaded!");
+  if (config_errors > 0) {
+    show_msg(config_msg);
+  }
   running = 1;
   while (running) {
-    sys_timer_usleep(1000 * 10);
-    block(xpad_mutex);
-    for (i = 0; i < MAX_XPAD_NUM; i++) {
-      if (XPAD.is_connected[i] > 0) {
-        unit = XPAD.con_unit[i];
-        unit->read_input(i, xpad_data);
+    events = wait_input();
+    if (events & XPAD_EVENT_LINK) {
+      xpadw_links();
+    }
+    bits = (events & XPAD.connected) | reg_pending;
+
+    // only slots with input or registration pending are visited, each is
+    // locked only while it is read so attach and detach elsewhere never hold it up
+    while (bits) {
+      i = slot_next(&bits);
+      block(slot_mutex[i]);
+      unit = (XPAD.connected & (1 << i)) ? XPAD.con_unit[i] : NULL;
+      if (reg_pending & (1 << i)) {
+        register_poll(i, unit);
+      }
+
+      // reports wait in the unit's queue until registration completes,
+      // then everything queued since the last wake up or poll is drained
+      if (unit != NULL) {
+        while (reg_state[i] != REG_PENDING && unit->read_input(i, xpad_data) > 0) {
+          stats.reads[i]++;
+        }
       }
+      unblock(slot_mutex[i]);
     }
-    check_pad_status();
-    unblock(xpad_mutex);
+
+    // event mode can wake once per report, don't query pad status that often
+    now = sys_time_get_system_time();
+    if (input_mode == INPUT_MODE_POLL || now - last_check >= 1000 * HOUSEKEEPING_INTERVAL) {
+      check_pad_status();
+      last_check = now;
+    }
+    if (now - last_rate >= 1000 * RATE_INTERVAL) {
+      rate_update(now - last_rate);
+      title_check();
+      last_rate = now;
+    }
+    if (input_mode == INPUT_MODE_POLL) {
+      poll_adapt();
+    }
+    if (stats_pending) {
+      stats_pending = 0;
+      stats_report();
+    }
+#ifdef XPAD_LATENCY
+    if (latency_pending) {
+      latency_pending = 0;
+      latency_report();
+    }
+#endif
   }
 
   // exiting...
   xpad_detach_all();
   xpadw_detach_all();
+  hid_detach_all();
   shutdown_usb();
+  unit_pool_destroy();
+  remap_free();
+  title_free();
+  capture_stop();
   sys_ppu_thread_exit(0);
   return(0);
 }
@@ -1143,6 +4067,7 @@ static void xpadd_stop_thread(uint64_t arg) {
   uint64_t exit_code;
 
   running = 0;
+  sys_event_flag_set(xpad_event, XPAD_EVENT_WAKE);
   sys_timer_usleep(500000);
   if (thread_id != (sys_ppu_thread_t)-1) {
     sys_ppu_thread_join(thread_id, &exit_code);